@@ -19,57 +19,20 @@
 
 #include "XBeeNG.h"
 
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#endif
+
 XBeeApiFrame::XBeeApiFrame() { _cmdData = nullptr; }
 XBeeApiFrame::~XBeeApiFrame() {
     if (_cmdData != nullptr) delete[] _cmdData;
     _cmdData = nullptr;
 }
 
-uint8_t
-XBeeApiFrame::getMsbLength() { return _msbLength; }
-void
-XBeeApiFrame::setMsbLength(const uint8_t& msbLength) { _msbLength = msbLength; }
-
-uint8_t
-XBeeApiFrame::getLsbLength() { return _lsbLength; }
-void
-XBeeApiFrame::setLsbLength(const uint8_t& lsbLength) { _lsbLength = lsbLength; }
-
-uint16_t
-XBeeApiFrame::getFrameDataLength() {
-    return ((_msbLength << 8) & 0xffff) + (_lsbLength & 0xff);
-}
-void
-XBeeApiFrame::setFrameDataLength(const uint16_t& frameDataLength) {
-    _msbLength = 0xff & (frameDataLength >> 8);
-    _lsbLength = 0xff & frameDataLength;
-}
-
-uint8_t
-XBeeApiFrame::getCmdId() { return _cmdId; }
-void
-XBeeApiFrame::setCmdId(const uint8_t& cmdId) { _cmdId = cmdId; }
-
-uint16_t
-XBeeApiFrame::getCmdDataLength() {
-    uint16_t frameDataLength = getFrameDataLength();
-    if (frameDataLength == 0) return 0;
-    return frameDataLength - 1;
-}
-void
-XBeeApiFrame::setCmdDataLength(const uint16_t& cmdDataLength) {
-    setFrameDataLength(cmdDataLength + 1);
-}
-
-uint8_t*
-XBeeApiFrame::getCmdData() { return _cmdData; }
-void
-XBeeApiFrame::setCmdData(uint8_t* cmdData) { _cmdData = cmdData; }
 
-uint8_t
-XBeeApiFrame::getChecksum() { return _checksum; }
-void
-XBeeApiFrame::setChecksum(const uint8_t& checksum) { _checksum = checksum; }
 void
 XBeeApiFrame::setChecksum() {
     uint8_t checksum = 0;
@@ -86,17 +49,17 @@ XBeeApiFrame::setChecksum() {
     setChecksum(checksum);
 }
 
-bool
-XBeeApiFrame::isReady() { return _ready; }
 void
-XBeeApiFrame::setReady(const bool& ready) { _ready = ready; }
+XBeeApiFrame::resizeTail(const uint16_t& headLength, const uint16_t& tailLength) {
+    if (getCmdDataLength() - headLength == tailLength) return;
+
+    uint8_t* cmdData = new uint8_t[headLength+tailLength];
+    for (uint16_t i = 0; i < headLength; i++) cmdData[i] = _cmdData[i];
+    delete[] _cmdData;
+    _cmdData = cmdData;
+    setCmdDataLength(headLength+tailLength);
+}
 
-bool
-XBeeApiFrame::hasErrors() { return _errorCode > 0; }
-uint8_t
-XBeeApiFrame::getErrorCode() { return _errorCode; }
-void
-XBeeApiFrame::setErrorCode(const uint8_t& errorCode) { _errorCode = errorCode; }
 
 #ifdef XBEENG_WITH_EXTRAS
 void
@@ -109,24 +72,27 @@ XBeeApiFrame::printSummary(Stream& strm) {
         _cmdId == AT_COMMAND || _cmdId == AT_QUEUE_COMMAND ||
         _cmdId == TX_REQUEST || _cmdId == EXPLICIT_TX_REQUEST ||
         _cmdId == REMOTE_AT_COMMAND || _cmdId == CREATE_SOURCE_ROUTE ||
+        _cmdId == REGISTER_JOINING_DEVICE ||
         _cmdId == AT_COMMAND_RESPONSE || _cmdId == TX_STATUS_RESPONSE ||
-        _cmdId == TX_STATUS || _cmdId == REMOTE_AT_COMMAND_RESPONSE) {
+        _cmdId == TX_STATUS || _cmdId == REMOTE_AT_COMMAND_RESPONSE ||
+        _cmdId == REGISTER_JOINING_DEVICE_STATUS) {
         FrameIdDescription* pt = static_cast<FrameIdDescription*>(this);
         strm.print(F("Frame ID: ")); printHex(strm, pt->getFrameId()); strm.print('\r');
         // All TxRxFrameIdDescription descendants:
         if (_cmdId == TX_64_REQUEST || _cmdId == TX_REQUEST ||
             _cmdId == EXPLICIT_TX_REQUEST || _cmdId == REMOTE_AT_COMMAND ||
-            _cmdId == CREATE_SOURCE_ROUTE || _cmdId == REMOTE_AT_COMMAND_RESPONSE) {
+            _cmdId == CREATE_SOURCE_ROUTE || _cmdId == REGISTER_JOINING_DEVICE ||
+            _cmdId == REMOTE_AT_COMMAND_RESPONSE) {
             TxRxFrameIdDescription* xpt = static_cast<TxRxFrameIdDescription*>(this);
             strm.print(F("Address64Msb: "));
-            uint32_t address64Msb = xpt->getAddress64Msb(); uint8_t* address64MsbPtr = (uint8_t*)&address64Msb;
+            uint32_t address64Msb = xpt->getAddress64Msb(); uint8_t address64MsbPtr[4]; setBigEndian32(address64MsbPtr, address64Msb);
             for (uint8_t i = 0; i < 4; i++) {
                 printHex(strm, address64MsbPtr[i]);
                 if (i != 3) strm.print(F(" "));
                 else strm.print('\r');
             }
             strm.print(F("Address64Lsb: "));
-            uint32_t address64Lsb = xpt->getAddress64Lsb(); uint8_t* address64LsbPtr = (uint8_t*)&address64Lsb;
+            uint32_t address64Lsb = xpt->getAddress64Lsb(); uint8_t address64LsbPtr[4]; setBigEndian32(address64LsbPtr, address64Lsb);
             for (uint8_t i = 0; i < 4; i++) {
                 printHex(strm, address64LsbPtr[i]);
                 if (i != 3) strm.print(F(" "));
@@ -134,7 +100,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
             }
             if (_cmdId != TX_64_REQUEST) {
                 strm.print(F("Address16: "));
-                uint16_t address16 = xpt->getAddress16(); uint8_t* address16Ptr = (uint8_t*)&address16;
+                uint16_t address16 = xpt->getAddress16(); uint8_t address16Ptr[2]; setBigEndian16(address16Ptr, address16);
                 for (uint8_t i = 0; i < 2; i++) {
                     printHex(strm, address16Ptr[i]);
                     if (i != 1) strm.print(F(" "));
@@ -145,17 +111,19 @@ XBeeApiFrame::printSummary(Stream& strm) {
     }
     // All TxRxXBeeApiFrame descendants
     if (_cmdId == RX_64_RESPONSE || _cmdId == RX_RESPONSE || _cmdId == EXPLICIT_RX_RESPONSE ||
-        _cmdId == RX_DATA_SAMPLE || _cmdId == RX_SENSOR_READ || _cmdId == RX_NODE_ID) {
+        _cmdId == RX_DATA_SAMPLE || _cmdId == RX_SENSOR_READ || _cmdId == RX_NODE_ID ||
+        _cmdId == RX_ROUTE_RECORD || _cmdId == RX_MTO_ROUTE_REQUEST ||
+        _cmdId == OTA_FIRMWARE_UPDATE_STATUS || _cmdId == RX_DEVICE_AUTHENTICATED) {
         TxRxXBeeApiFrame* pt = static_cast<TxRxXBeeApiFrame*>(this);
         strm.print(F("Address64Msb: "));
-        uint32_t address64Msb = pt->getAddress64Msb(); uint8_t* address64MsbPtr = (uint8_t*)&address64Msb;
+        uint32_t address64Msb = pt->getAddress64Msb(); uint8_t address64MsbPtr[4]; setBigEndian32(address64MsbPtr, address64Msb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, address64MsbPtr[i]);
             if (i != 3) strm.print(F(" "));
             else strm.print('\r');
         }
         strm.print(F("Address64Lsb: "));
-        uint32_t address64Lsb = pt->getAddress64Lsb(); uint8_t* address64LsbPtr = (uint8_t*)&address64Lsb;
+        uint32_t address64Lsb = pt->getAddress64Lsb(); uint8_t address64LsbPtr[4]; setBigEndian32(address64LsbPtr, address64Lsb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, address64LsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -163,7 +131,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         if (_cmdId != RX_64_RESPONSE) {
             strm.print(F("Address16: "));
-            uint16_t address16 = pt->getAddress16(); uint8_t* address16Ptr = (uint8_t*)&address16;
+            uint16_t address16 = pt->getAddress16(); uint8_t address16Ptr[2]; setBigEndian16(address16Ptr, address16);
             for (uint8_t i = 0; i < 2; i++) {
                 printHex(strm, address16Ptr[i]);
                if (i != 1) strm.print(F(" "));
@@ -190,7 +158,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
     case TX_16_REQUEST: {
         Tx16Request* pt = static_cast<Tx16Request*>(this);
         strm.print(F("Address16: "));
-        uint16_t address16 = pt->getAddress16(); uint8_t* address16Ptr = (uint8_t*)&address16;
+        uint16_t address16 = pt->getAddress16(); uint8_t address16Ptr[2]; setBigEndian16(address16Ptr, address16);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, address16Ptr[i]);
             if (i != 1) strm.print(F(" "));
@@ -212,7 +180,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
     case AT_QUEUE_COMMAND: {
         AtQueueCommand* pt = static_cast<AtQueueCommand*>(this);
         strm.print(F("Command: "));
-        uint16_t cmd = pt->getCmd(); uint8_t* cmdPtr = (uint8_t*)&cmd;
+        uint16_t cmd = pt->getCmd(); uint8_t cmdPtr[2]; setBigEndian16(cmdPtr, cmd);
         for (uint8_t i = 0; i < 2; i++) {
             strm.print((char)cmdPtr[i]);
         } strm.print('\r');
@@ -247,14 +215,14 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("Source Endpoint: ")); printHex(strm, pt->getSourceEndpoint()); strm.print('\r');
         strm.print(F("Destination Endpoint: ")); printHex(strm, pt->getDestinationEndpoint()); strm.print('\r');
         strm.print(F("Cluster ID: "));
-        uint16_t clusterId = pt->getClusterId(); uint8_t* clusterIdPtr = (uint8_t*)&clusterId;
+        uint16_t clusterId = pt->getClusterId(); uint8_t clusterIdPtr[2]; setBigEndian16(clusterIdPtr, clusterId);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, clusterIdPtr[i]);
             if (i != 1) strm.print(F(" "));
             else strm.print('\r');
         }
         strm.print(F("Profile ID: "));
-        uint16_t profileId = pt->getProfileId(); uint8_t* profileIdPtr = (uint8_t*)&profileId;
+        uint16_t profileId = pt->getProfileId(); uint8_t profileIdPtr[2]; setBigEndian16(profileIdPtr, profileId);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, profileIdPtr[i]);
             if (i != 1) strm.print(F(" "));
@@ -277,7 +245,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         RemoteAtCommand* pt = static_cast<RemoteAtCommand*>(this);
         strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
         strm.print(F("Command: "));
-        uint16_t cmd = pt->getCmd(); uint8_t* cmdPtr = (uint8_t*)&cmd;
+        uint16_t cmd = pt->getCmd(); uint8_t cmdPtr[2]; setBigEndian16(cmdPtr, cmd);
         for (uint8_t i = 0; i < 2; i++) {
             strm.print((char)cmdPtr[i]);
         } strm.print('\r');
@@ -296,18 +264,32 @@ XBeeApiFrame::printSummary(Stream& strm) {
         CreateSourceRoute* pt = static_cast<CreateSourceRoute*>(this);
         strm.print(F("Number of Addresses: ")); printHex(strm, pt->getNAddresses()); strm.print('\r');
 
-        uint16_t* addresses = pt->getAddresses();
+        const uint8_t* addresses = pt->getAddresses();
         uint8_t nAddresses = pt->getNAddresses();
         if (nAddresses > 0) strm.print(F("Addresses: "));
         for (uint8_t i = 0; i < nAddresses; i++) {
-            printHex(strm, (addresses[i]>>8) & 0xFF);
+            printHex(strm, addresses[2*i]);
             strm.print(F(" "));
-            printHex(strm, addresses[i] & 0xFF);
+            printHex(strm, addresses[2*i+1]);
             if (i != (nAddresses-1)) strm.print(F("  "));
             else strm.print('\r');
         }
         strm.print('\r');
     } break;
+    case REGISTER_JOINING_DEVICE: {
+        RegisterJoiningDevice* pt = static_cast<RegisterJoiningDevice*>(this);
+        strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
+
+        uint8_t* key = pt->getKey();
+        uint16_t keyLength = pt->getKeyLength();
+        if (keyLength > 0) strm.print(F("Key: "));
+        for (uint16_t i = 0; i < keyLength; i++) {
+            printHex(strm, key[i]);
+            if (i != (keyLength-1)) strm.print(F(" "));
+            else strm.print('\r');
+        }
+        strm.print('\r');
+    } break;
     case RX_64_RESPONSE: {
         Rx64Response* pt = static_cast<Rx64Response*>(this);
         strm.print(F("Rssi: ")); printHex(strm, pt->getRssi()); strm.print('\r');
@@ -326,7 +308,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
     case RX_16_RESPONSE: {
         Rx16Response* pt = static_cast<Rx16Response*>(this);
         strm.print(F("Address16: "));
-        uint16_t address16 = pt->getAddress16(); uint8_t* address16Ptr = (uint8_t*)&address16;
+        uint16_t address16 = pt->getAddress16(); uint8_t address16Ptr[2]; setBigEndian16(address16Ptr, address16);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, address16Ptr[i]);
             if (i != 1) strm.print(F(" "));
@@ -350,7 +332,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("Rssi: ")); printHex(strm, pt->getRssi()); strm.print('\r');
         strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
         strm.print(F("Number of Samples: ")); printHex(strm, pt->getNSamples()); strm.print('\r');
-        uint16_t digitalMask = pt->getDigitalMask(); uint8_t* digitalMaskPtr = (uint8_t*)&digitalMask;
+        uint16_t digitalMask = pt->getDigitalMask(); uint8_t digitalMaskPtr[2]; setBigEndian16(digitalMaskPtr, digitalMask);
         strm.print(F("Digital Mask: "));
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, digitalMaskPtr[i]);
@@ -361,7 +343,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
 
         if (digitalMask > 0) {
             strm.print(F("Digital Samples: "));
-            uint16_t digitalSamples = pt->getDigitalSamples(); uint8_t* digitalSamplesPtr = (uint8_t*)&digitalSamples;
+            uint16_t digitalSamples = pt->getDigitalSamples(); uint8_t digitalSamplesPtr[2]; setBigEndian16(digitalSamplesPtr, digitalSamples);
             for (uint8_t i = 0; i < 2; i++) {
                 printHex(strm, digitalSamplesPtr[i]);
              if (i != 1) strm.print(F(" "));
@@ -370,11 +352,11 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
 
         if (pt->getAnalogMask() > 0) {
-            uint16_t* analogSamples = pt->getAnalogSamples();
+            const uint8_t* analogSamples = pt->getAnalogSamples();
             uint16_t analogSamplesLength = pt->getAnalogSamplesLength();
             if (analogSamplesLength > 0) strm.print(F("Analog Samples: "));
             for (uint16_t i = 0; i < analogSamplesLength; i++) {
-                uint8_t* analogSample = (uint8_t*)&(analogSamples[i]);
+                const uint8_t* analogSample = &(analogSamples[2*i]);
                 for (uint8_t j = 0; j < 2; j++) {
                     printHex(strm, analogSample[j]);
                     if (j != 1) strm.print(F(" "));
@@ -389,7 +371,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
     case RX_16_DATA_SAMPLE: {
         Rx16DataSample* pt = static_cast<Rx16DataSample*>(this);
         strm.print(F("Address16: "));
-        uint16_t address16 = pt->getAddress16(); uint8_t* address16Ptr = (uint8_t*)&address16;
+        uint16_t address16 = pt->getAddress16(); uint8_t address16Ptr[2]; setBigEndian16(address16Ptr, address16);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, address16Ptr[i]);
             if (i != 1) strm.print(F(" "));
@@ -398,7 +380,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("Rssi: ")); printHex(strm, pt->getRssi()); strm.print('\r');
         strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
         strm.print(F("Number of Samples: ")); printHex(strm, pt->getNSamples()); strm.print('\r');
-        uint16_t digitalMask = pt->getDigitalMask(); uint8_t* digitalMaskPtr = (uint8_t*)&digitalMask;
+        uint16_t digitalMask = pt->getDigitalMask(); uint8_t digitalMaskPtr[2]; setBigEndian16(digitalMaskPtr, digitalMask);
         strm.print(F("Digital Mask: "));
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, digitalMaskPtr[i]);
@@ -409,7 +391,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
 
         if (digitalMask > 0) {
             strm.print(F("Digital Samples: "));
-            uint16_t digitalSamples = pt->getDigitalSamples(); uint8_t* digitalSamplesPtr = (uint8_t*)&digitalSamples;
+            uint16_t digitalSamples = pt->getDigitalSamples(); uint8_t digitalSamplesPtr[2]; setBigEndian16(digitalSamplesPtr, digitalSamples);
             for (uint8_t i = 0; i < 2; i++) {
                 printHex(strm, digitalSamplesPtr[i]);
              if (i != 1) strm.print(F(" "));
@@ -418,11 +400,11 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
 
         if (pt->getAnalogMask() > 0) {
-            uint16_t* analogSamples = pt->getAnalogSamples();
+            const uint8_t* analogSamples = pt->getAnalogSamples();
             uint16_t analogSamplesLength = pt->getAnalogSamplesLength();
             if (analogSamplesLength > 0) strm.print(F("Analog Samples: "));
             for (uint16_t i = 0; i < analogSamplesLength; i++) {
-                uint8_t* analogSample = (uint8_t*)&(analogSamples[i]);
+                const uint8_t* analogSample = &(analogSamples[2*i]);
                 for (uint8_t j = 0; j < 2; j++) {
                     printHex(strm, analogSample[j]);
                     if (j != 1) strm.print(F(" "));
@@ -437,7 +419,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
     case AT_COMMAND_RESPONSE: {
         AtCommandResponse* pt = static_cast<AtCommandResponse*>(this);
         strm.print(F("Command: "));
-        uint16_t cmd = pt->getCmd(); uint8_t* cmdPtr = (uint8_t*)&cmd;
+        uint16_t cmd = pt->getCmd(); uint8_t cmdPtr[2]; setBigEndian16(cmdPtr, cmd);
         for (uint8_t i = 0; i < 2; i++) {
             strm.print((char)cmdPtr[i]);
         } strm.print('\r');
@@ -466,7 +448,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
     case TX_STATUS: {
         TxStatus* pt = static_cast<TxStatus*>(this);
         strm.print(F("Address16: "));
-        uint16_t address16 = pt->getAddress16(); uint8_t* address16Ptr = (uint8_t*)&address16;
+        uint16_t address16 = pt->getAddress16(); uint8_t address16Ptr[2]; setBigEndian16(address16Ptr, address16);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, address16Ptr[i]);
             if (i != 1) strm.print(F(" "));
@@ -482,7 +464,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("Source Event: ")); printHex(strm, pt->getSourceEvent()); strm.print('\r');
         strm.print(F("Length: ")); printHex(strm, pt->getLength()); strm.print('\r');
         strm.print(F("Timestamp: "));
-        uint32_t timestamp = pt->getTimestamp(); uint8_t* timestampPtr = (uint8_t*)&timestamp;
+        uint32_t timestamp = pt->getTimestamp(); uint8_t timestampPtr[4]; setBigEndian32(timestampPtr, timestamp);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, timestampPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -491,7 +473,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("ACK Timout Count: ")); printHex(strm, pt->getAckTimoutCount()); strm.print('\r');
         strm.print(F("Destination Address64Msb: "));
         uint32_t destinationAddress64Msb = pt->getDestinationAddress64Msb();
-        uint8_t* destinationAddress64MsbPtr = (uint8_t*)&destinationAddress64Msb;
+        uint8_t destinationAddress64MsbPtr[4]; setBigEndian32(destinationAddress64MsbPtr, destinationAddress64Msb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, destinationAddress64MsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -499,7 +481,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Destination Address64Lsb: "));
         uint32_t destinationAddress64Lsb = pt->getDestinationAddress64Lsb();
-        uint8_t* destinationAddress64LsbPtr = (uint8_t*)&destinationAddress64Lsb;
+        uint8_t destinationAddress64LsbPtr[4]; setBigEndian32(destinationAddress64LsbPtr, destinationAddress64Lsb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, destinationAddress64LsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -507,7 +489,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Source Address64Msb: "));
         uint32_t sourceAddress64Msb = pt->getSourceAddress64Msb();
-        uint8_t* sourceAddress64MsbPtr = (uint8_t*)&sourceAddress64Msb;
+        uint8_t sourceAddress64MsbPtr[4]; setBigEndian32(sourceAddress64MsbPtr, sourceAddress64Msb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, sourceAddress64MsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -515,7 +497,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Source Address64Lsb: "));
         uint32_t sourceAddress64Lsb = pt->getSourceAddress64Lsb();
-        uint8_t* sourceAddress64LsbPtr = (uint8_t*)&sourceAddress64Lsb;
+        uint8_t sourceAddress64LsbPtr[4]; setBigEndian32(sourceAddress64LsbPtr, sourceAddress64Lsb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, sourceAddress64LsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -523,7 +505,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Responder Address64Msb: "));
         uint32_t responderAddress64Msb = pt->getResponderAddress64Msb();
-        uint8_t* responderAddress64MsbPtr = (uint8_t*)&responderAddress64Msb;
+        uint8_t responderAddress64MsbPtr[4]; setBigEndian32(responderAddress64MsbPtr, responderAddress64Msb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, responderAddress64MsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -531,7 +513,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Responder Address64Lsb: "));
         uint32_t responderAddress64Lsb = pt->getResponderAddress64Lsb();
-        uint8_t* responderAddress64LsbPtr = (uint8_t*)&responderAddress64Lsb;
+        uint8_t responderAddress64LsbPtr[4]; setBigEndian32(responderAddress64LsbPtr, responderAddress64Lsb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, responderAddress64LsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -539,7 +521,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Receiver Address64Msb: "));
         uint32_t receiverAddress64Msb = pt->getReceiverAddress64Msb();
-        uint8_t* receiverAddress64MsbPtr = (uint8_t*)&receiverAddress64Msb;
+        uint8_t receiverAddress64MsbPtr[4]; setBigEndian32(receiverAddress64MsbPtr, receiverAddress64Msb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, receiverAddress64MsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -547,7 +529,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Receiver Address64Lsb: "));
         uint32_t receiverAddress64Lsb = pt->getReceiverAddress64Lsb();
-        uint8_t* receiverAddress64LsbPtr = (uint8_t*)&receiverAddress64Lsb;
+        uint8_t receiverAddress64LsbPtr[4]; setBigEndian32(receiverAddress64LsbPtr, receiverAddress64Lsb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, receiverAddress64LsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -560,7 +542,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("Format ID: ")); printHex(strm, pt->getFormatId()); strm.print('\r');
         strm.print(F("New Address64Msb: "));
         uint32_t newAddress64Msb = pt->getNewAddress64Msb();
-        uint8_t* newAddress64MsbPtr = (uint8_t*)&newAddress64Msb;
+        uint8_t newAddress64MsbPtr[4]; setBigEndian32(newAddress64MsbPtr, newAddress64Msb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, newAddress64MsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -568,7 +550,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("New Address64Lsb: "));
         uint32_t newAddress64Lsb = pt->getNewAddress64Lsb();
-        uint8_t* newAddress64LsbPtr = (uint8_t*)&newAddress64Lsb;
+        uint8_t newAddress64LsbPtr[4]; setBigEndian32(newAddress64LsbPtr, newAddress64Lsb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, newAddress64LsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -576,7 +558,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Old Address64Msb: "));
         uint32_t oldAddress64Msb = pt->getOldAddress64Msb();
-        uint8_t* oldAddress64MsbPtr = (uint8_t*)&oldAddress64Msb;
+        uint8_t oldAddress64MsbPtr[4]; setBigEndian32(oldAddress64MsbPtr, oldAddress64Msb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, oldAddress64MsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -584,7 +566,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("Old Address64Lsb: "));
         uint32_t oldAddress64Lsb = pt->getOldAddress64Lsb();
-        uint8_t* oldAddress64LsbPtr = (uint8_t*)&oldAddress64Lsb;
+        uint8_t oldAddress64LsbPtr[4]; setBigEndian32(oldAddress64LsbPtr, oldAddress64Lsb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, oldAddress64LsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -611,14 +593,14 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("Source Endpoint: ")); printHex(strm, pt->getSourceEndpoint()); strm.print('\r');
         strm.print(F("Destination Endpoint: ")); printHex(strm, pt->getDestinationEndpoint()); strm.print('\r');
         strm.print(F("Cluster ID: "));
-        uint16_t clusterId = pt->getClusterId(); uint8_t* clusterIdPtr = (uint8_t*)&clusterId;
+        uint16_t clusterId = pt->getClusterId(); uint8_t clusterIdPtr[2]; setBigEndian16(clusterIdPtr, clusterId);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, clusterIdPtr[i]);
             if (i != 1) strm.print(F(" "));
             else strm.print('\r');
         }
         strm.print(F("Profile ID: "));
-        uint16_t profileId = pt->getProfileId(); uint8_t* profileIdPtr = (uint8_t*)&profileId;
+        uint16_t profileId = pt->getProfileId(); uint8_t profileIdPtr[2]; setBigEndian16(profileIdPtr, profileId);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, profileIdPtr[i]);
             if (i != 1) strm.print(F(" "));
@@ -640,7 +622,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         RxDataSample* pt = static_cast<RxDataSample*>(this);
         strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
         strm.print(F("Number of Samples: ")); printHex(strm, pt->getNSamples()); strm.print('\r');
-        uint16_t digitalMask = pt->getDigitalMask(); uint8_t* digitalMaskPtr = (uint8_t*)&digitalMask;
+        uint16_t digitalMask = pt->getDigitalMask(); uint8_t digitalMaskPtr[2]; setBigEndian16(digitalMaskPtr, digitalMask);
         strm.print(F("Digital Mask: "));
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, digitalMaskPtr[i]);
@@ -651,7 +633,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
 
         if (digitalMask > 0) {
             strm.print(F("Digital Samples: "));
-            uint16_t digitalSamples = pt->getDigitalSamples(); uint8_t* digitalSamplesPtr = (uint8_t*)&digitalSamples;
+            uint16_t digitalSamples = pt->getDigitalSamples(); uint8_t digitalSamplesPtr[2]; setBigEndian16(digitalSamplesPtr, digitalSamples);
             for (uint8_t i = 0; i < 2; i++) {
                 printHex(strm, digitalSamplesPtr[i]);
              if (i != 1) strm.print(F(" "));
@@ -660,11 +642,11 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
 
         if (pt->getAnalogMask() > 0) {
-            uint16_t* analogSamples = pt->getAnalogSamples();
+            const uint8_t* analogSamples = pt->getAnalogSamples();
             uint16_t analogSamplesLength = pt->getAnalogSamplesLength();
             if (analogSamplesLength > 0) strm.print(F("Analog Samples: "));
             for (uint16_t i = 0; i < analogSamplesLength; i++) {
-                uint8_t* analogSample = (uint8_t*)&(analogSamples[i]);
+                const uint8_t* analogSample = &(analogSamples[2*i]);
                 for (uint8_t j = 0; j < 2; j++) {
                     printHex(strm, analogSample[j]);
                     if (j != 1) strm.print(F(" "));
@@ -681,37 +663,43 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
         strm.print(F("1-Wire Sensors: ")); printHex(strm, pt->get1WireSensors()); strm.print('\r');
         strm.print(F("A/D Values: "));
-        uint8_t* aDValues = (uint8_t*)pt->getADValues();
+        const uint8_t* aDValues = pt->getADValues();
         for (uint8_t i = 0; i < 4; i++) {
-          printHex(strm, aDValues[i]);
+          printHex(strm, aDValues[2*i]);
           strm.print(F(" "));
-          printHex(strm, aDValues[i+1]);
+          printHex(strm, aDValues[2*i+1]);
           if (i != 3) strm.print(F("  "));
           else strm.print('\r');
         }
-        uint16_t temp = pt->getTemp(); uint8_t* tempPtr = (uint8_t*)&temp;
+        uint16_t temp = pt->getTemp(); uint8_t tempPtr[2]; setBigEndian16(tempPtr, temp);
         printHex(strm, tempPtr[0]); strm.print(F(" ")); printHex(strm, tempPtr[1]); strm.print('\r');
         strm.print('\r');
     } break;
     case RX_NODE_ID: {
-        RxNodeId* pt = static_cast<RxNodeId*>(this);
+        RxNodeIdView view;
+        RxNodeIdView* pt = &view;
+        if (!view.parse(*this)) {
+            strm.print(F("Truncated")); strm.print('\r');
+            strm.print('\r');
+            break;
+        }
         strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
         strm.print(F("Source Address16: "));
-        uint16_t sourceAddress16 = pt->getSourceAddress16(); uint8_t* sourceAddress16Ptr = (uint8_t*)&sourceAddress16;
+        uint16_t sourceAddress16 = pt->getSourceAddress16(); uint8_t sourceAddress16Ptr[2]; setBigEndian16(sourceAddress16Ptr, sourceAddress16);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, sourceAddress16Ptr[i]);
             if (i != 1) strm.print(F(" "));
             else strm.print('\r');
         }
         strm.print(F("Network Address64Msb: "));
-        uint32_t networkAddress64Msb = pt->getNetworkAddress64Msb(); uint8_t* networkAddress64MsbPtr = (uint8_t*)&networkAddress64Msb;
+        uint32_t networkAddress64Msb = pt->getNetworkAddress64Msb(); uint8_t networkAddress64MsbPtr[4]; setBigEndian32(networkAddress64MsbPtr, networkAddress64Msb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, networkAddress64MsbPtr[i]);
             if (i != 3) strm.print(F(" "));
             else strm.print('\r');
         }
         strm.print(F("Network Address64Lsb: "));
-        uint32_t networkAddress64Lsb = pt->getNetworkAddress64Lsb(); uint8_t* networkAddress64LsbPtr = (uint8_t*)&networkAddress64Lsb;
+        uint32_t networkAddress64Lsb = pt->getNetworkAddress64Lsb(); uint8_t networkAddress64LsbPtr[4]; setBigEndian32(networkAddress64LsbPtr, networkAddress64Lsb);
         for (uint8_t i = 0; i < 4; i++) {
             printHex(strm, networkAddress64LsbPtr[i]);
             if (i != 3) strm.print(F(" "));
@@ -719,7 +707,7 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print(F("NI: ")); strm.print((char*)(pt->getNi())); strm.print('\r');
         strm.print(F("Parent Address16: "));
-        uint16_t parentAddress16 = pt->getParentAddress16(); uint8_t* parentAddress16Ptr = (uint8_t*)&parentAddress16;
+        uint16_t parentAddress16 = pt->getParentAddress16(); uint8_t parentAddress16Ptr[2]; setBigEndian16(parentAddress16Ptr, parentAddress16);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, parentAddress16Ptr[i]);
             if (i != 1) strm.print(F(" "));
@@ -728,23 +716,23 @@ XBeeApiFrame::printSummary(Stream& strm) {
         strm.print(F("Device Type: ")); printHex(strm, pt->getType()); strm.print('\r');
         strm.print(F("Source Event: ")); printHex(strm, pt->getSourceEvent()); strm.print('\r');
         strm.print(F("Digi Profile ID: "));
-        uint16_t digiProfileId = pt->getDigiProfileId(); uint8_t* digiProfileIdPtr = (uint8_t*)&digiProfileId;
+        uint16_t digiProfileId = pt->getDigiProfileId(); uint8_t digiProfileIdPtr[2]; setBigEndian16(digiProfileIdPtr, digiProfileId);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, digiProfileIdPtr[i]);
             if (i != 1) strm.print(F(" "));
             else strm.print('\r');
         }
         strm.print(F("Digi Manufacturer ID: "));
-        uint16_t digiManufacturerId = pt->getDigiManufacturerId(); uint8_t* digiManufacturerIdPtr = (uint8_t*)&digiManufacturerId;
+        uint16_t digiManufacturerId = pt->getDigiManufacturerId(); uint8_t digiManufacturerIdPtr[2]; setBigEndian16(digiManufacturerIdPtr, digiManufacturerId);
         for (uint8_t i = 0; i < 2; i++) {
             printHex(strm, digiManufacturerIdPtr[i]);
             if (i != 1) strm.print(F(" "));
             else strm.print('\r');
         }
 
-        uint32_t dd = pt->getDigiDd();
-        if (dd > 0) {
-            uint8_t* ddPtr = (uint8_t*)&dd;
+        if (pt->hasDigiDd()) {
+            uint32_t dd = pt->getDigiDd();
+            uint8_t ddPtr[4]; setBigEndian32(ddPtr, dd);
             strm.print(F("Digi DD Value: "));
             for (uint8_t i = 0; i < 4; i++) {
                 printHex(strm, ddPtr[i]);
@@ -752,16 +740,15 @@ XBeeApiFrame::printSummary(Stream& strm) {
                 else strm.print('\r');
             }
         }
-        uint8_t rssi = pt->getRssi();
-        if (rssi > 0) {
-            strm.print(F("Rssi: ")); printHex(strm, rssi); strm.print('\r');
+        if (pt->hasRssi()) {
+            strm.print(F("Rssi: ")); printHex(strm, pt->getRssi()); strm.print('\r');
         }
         strm.print('\r');
     } break;
     case REMOTE_AT_COMMAND_RESPONSE: {
         RemoteAtCommandResponse* pt = static_cast<RemoteAtCommandResponse*>(this);
         strm.print(F("Command: "));
-        uint16_t cmd = pt->getCmd(); uint8_t* cmdPtr = (uint8_t*)&cmd;
+        uint16_t cmd = pt->getCmd(); uint8_t cmdPtr[2]; setBigEndian16(cmdPtr, cmd);
         for (uint8_t i = 0; i < 2; i++) {
             strm.print((char)cmdPtr[i]);
         } strm.print('\r');
@@ -777,6 +764,61 @@ XBeeApiFrame::printSummary(Stream& strm) {
         }
         strm.print('\r');
     } break;
+    case RX_ROUTE_RECORD: {
+        RxRouteRecord* pt = static_cast<RxRouteRecord*>(this);
+        strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
+        strm.print(F("Number of Addresses: ")); printHex(strm, pt->getNAddresses()); strm.print('\r');
+
+        const uint8_t* addresses = pt->getAddresses();
+        uint8_t nAddresses = pt->getNAddresses();
+        if (nAddresses > 0) strm.print(F("Addresses: "));
+        for (uint8_t i = 0; i < nAddresses; i++) {
+            printHex(strm, addresses[2*i]);
+            strm.print(F(" "));
+            printHex(strm, addresses[2*i+1]);
+            if (i != (nAddresses-1)) strm.print(F("  "));
+            else strm.print('\r');
+        }
+        strm.print('\r');
+    } break;
+    case RX_MTO_ROUTE_REQUEST: {
+        RxMtoRouteRequest* pt = static_cast<RxMtoRouteRequest*>(this);
+        strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
+        strm.print('\r');
+    } break;
+    case RX_DEVICE_AUTHENTICATED: {
+        RxDeviceAuthenticated* pt = static_cast<RxDeviceAuthenticated*>(this);
+        strm.print(F("Status: ")); printHex(strm, pt->getStatus()); strm.print('\r');
+        strm.print('\r');
+    } break;
+    case REGISTER_JOINING_DEVICE_STATUS: {
+        RegisterJoiningDeviceStatus* pt = static_cast<RegisterJoiningDeviceStatus*>(this);
+        strm.print(F("Status: ")); printHex(strm, pt->getStatus()); strm.print('\r');
+        strm.print('\r');
+    } break;
+    case OTA_FIRMWARE_UPDATE_STATUS: {
+        OtaFirmwareUpdateStatus* pt = static_cast<OtaFirmwareUpdateStatus*>(this);
+        strm.print(F("Options: ")); printHex(strm, pt->getOptions()); strm.print('\r');
+        strm.print(F("Message Type: ")); printHex(strm, pt->getMessageType()); strm.print('\r');
+        strm.print(F("Block Number: ")); printHex(strm, pt->getBlockNumber()); strm.print('\r');
+        strm.print(F("Target Address64Msb: "));
+        uint32_t targetAddress64Msb = pt->getTargetAddress64Msb();
+        uint8_t targetAddress64MsbPtr[4]; setBigEndian32(targetAddress64MsbPtr, targetAddress64Msb);
+        for (uint8_t i = 0; i < 4; i++) {
+            printHex(strm, targetAddress64MsbPtr[i]);
+            if (i != 3) strm.print(F(" "));
+            else strm.print('\r');
+        }
+        strm.print(F("Target Address64Lsb: "));
+        uint32_t targetAddress64Lsb = pt->getTargetAddress64Lsb();
+        uint8_t targetAddress64LsbPtr[4]; setBigEndian32(targetAddress64LsbPtr, targetAddress64Lsb);
+        for (uint8_t i = 0; i < 4; i++) {
+            printHex(strm, targetAddress64LsbPtr[i]);
+            if (i != 3) strm.print(F(" "));
+            else strm.print('\r');
+        }
+        strm.print('\r');
+    } break;
     }
 }
 
@@ -788,36 +830,11 @@ XBeeApiFrame::printHex(Stream& strm, const uint8_t& hex) {
 #endif
 
 
-uint32_t
-TxRxXBeeApiFrame::getAddress64Msb() { return *((uint32_t*)&(_cmdData[4-CMD_DATA_OFFSET])); }
-uint32_t
-TxRxXBeeApiFrame::getAddress64Lsb() { return *((uint32_t*)&(_cmdData[8-CMD_DATA_OFFSET])); }
-uint16_t
-TxRxXBeeApiFrame::getAddress16() { return *((uint16_t*)&(_cmdData[12-CMD_DATA_OFFSET])); }
-
-
-uint8_t
-FrameIdDescription::getFrameId() { return _cmdData[0]; }
-void
-FrameIdDescription::setFrameId(const uint8_t& frameId) { _cmdData[0] = frameId; }
-
-
-uint32_t
-TxRxFrameIdDescription::getAddress64Msb() { return *((uint32_t*)&(_cmdData[5-CMD_DATA_OFFSET])); }
-uint32_t
-TxRxFrameIdDescription::getAddress64Lsb() { return *((uint32_t*)&(_cmdData[9-CMD_DATA_OFFSET])); }
 void
 TxRxFrameIdDescription::setAddress64(const uint32_t& address64Msb, const uint32_t& address64Lsb,
     bool performChecksum) {
-    uint8_t* address64 = &(_cmdData[5-CMD_DATA_OFFSET]);
-    address64[0] = (address64Msb >> 24) & 0xff;
-    address64[1] = (address64Msb >> 16) & 0xff;
-    address64[2] = (address64Msb >> 8) & 0xff;
-    address64[3] = address64Msb & 0xff;
-    address64[4] = (address64Lsb >> 24) & 0xff;
-    address64[5] = (address64Lsb >> 16) & 0xff;
-    address64[6] = (address64Lsb >> 8) & 0xff;
-    address64[7] = address64Lsb & 0xff;
+    set<TxRxFrameIdDescriptionSchema::address64Msb>(address64Msb);
+    set<TxRxFrameIdDescriptionSchema::address64Lsb>(address64Lsb);
 
     if (performChecksum) setChecksum();
 }
@@ -826,13 +843,9 @@ TxRxFrameIdDescription::setAddress64(const uint32_t& address64Msb, const uint32_
     setAddress64(address64Msb, address64Lsb, true);
 }
 
-uint16_t
-TxRxFrameIdDescription::getAddress16() { return *((uint16_t*)&(_cmdData[13-CMD_DATA_OFFSET])); }
 void
 TxRxFrameIdDescription::setAddress16(const uint16_t& address16, bool performChecksum) {
-    uint8_t* address16ptr = &(_cmdData[13-CMD_DATA_OFFSET]);
-    address16ptr[0] = (address16 >> 8) & 0xff;
-    address16ptr[1] = address16 & 0xff;
+    set<TxRxFrameIdDescriptionSchema::address16>(address16);
 
     if (performChecksum) setChecksum();
 }
@@ -910,11 +923,9 @@ Tx64Request::Tx64Request(const uint8_t& frameId,
     Tx64Request(frameId, address64Msb, address64Lsb, 0, data) {}
 #endif
 
-uint8_t
-Tx64Request::getOptions() { return _cmdData[13-CMD_DATA_OFFSET]; }
 void
 Tx64Request::setOptions(const uint8_t& options, const bool& performChecksum) {
-    _cmdData[13-CMD_DATA_OFFSET] = options;
+    set<Tx64RequestSchema::options>(options);
 
     if (performChecksum) setChecksum();
 }
@@ -923,20 +934,9 @@ Tx64Request::setOptions(const uint8_t& options) {
     setOptions(options, true);
 }
 
-uint8_t*
-Tx64Request::getData() { return &(_cmdData[14-CMD_DATA_OFFSET]); }
 void
 Tx64Request::setData(const uint8_t* data, const uint16_t& dataLength, const bool& performChecksum) {
-    if ((getCmdDataLength() - TX_64_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_64_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_64_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_64_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_64_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_64_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_64_REQUEST_HEAD, dataLength);
 
     for (uint16_t i = 0; i < dataLength; i++)
         _cmdData[TX_64_REQUEST_HEAD+i] = data[i];
@@ -952,16 +952,7 @@ Tx64Request::setData(const char* data, const bool& performChecksum) {
     uint16_t dataLength = 0;
     for (; data[dataLength]!='\0'; dataLength++);
 
-    if ((getCmdDataLength() - TX_64_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_64_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_64_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_64_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_64_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_64_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_64_REQUEST_HEAD, dataLength);
 
     for (uint16_t i = 0; i < dataLength; i++) _cmdData[TX_64_REQUEST_HEAD+i] = data[i];
 
@@ -976,16 +967,7 @@ void
 Tx64Request::setData(const std::initializer_list<uint8_t>& data, const bool& performChecksum) {
     uint16_t dataLength = data.size();
 
-    if ((getCmdDataLength() - TX_64_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_64_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_64_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_64_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_64_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_64_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_64_REQUEST_HEAD, dataLength);
 
 
     uint16_t i = 0;
@@ -998,8 +980,6 @@ Tx64Request::setData(const std::initializer_list<uint8_t>& data) {
     setData(data, true);
 }
 #endif
-uint16_t
-Tx64Request::getDataLength() { return getCmdDataLength() - TX_64_REQUEST_HEAD; }
 
 
 Tx16Request::Tx16Request(const uint8_t& frameId,
@@ -1066,13 +1046,9 @@ Tx16Request::Tx16Request(const uint8_t& frameId,
     Tx16Request(frameId, address16, 0, data) {}
 #endif
 
-uint16_t
-Tx16Request::getAddress16() { return *((uint16_t*)&(_cmdData[8-CMD_DATA_OFFSET])); }
 void
 Tx16Request::setAddress16(const uint16_t& address16, const bool& performChecksum) {
-    uint8_t* address16ptr = &(_cmdData[5-CMD_DATA_OFFSET]);
-    address16ptr[0] = (address16 >> 8) & 0xff;
-    address16ptr[1] = address16 & 0xff;
+    set<Tx16RequestSchema::address16>(address16);
 
     if (performChecksum) setChecksum();
 }
@@ -1081,11 +1057,9 @@ Tx16Request::setAddress16(const uint16_t& address16) {
     setAddress16(address16, true);
 }
 
-uint8_t
-Tx16Request::getOptions() { return _cmdData[7-CMD_DATA_OFFSET]; }
 void
 Tx16Request::setOptions(const uint8_t& options, const bool& performChecksum) {
-    _cmdData[7-CMD_DATA_OFFSET] = options;
+    set<Tx16RequestSchema::options>(options);
 
     if (performChecksum) setChecksum();
 }
@@ -1094,20 +1068,9 @@ Tx16Request::setOptions(const uint8_t& options) {
     setOptions(options, true);
 }
 
-uint8_t*
-Tx16Request::getData() { return &(_cmdData[8-CMD_DATA_OFFSET]); }
 void
 Tx16Request::setData(const uint8_t* data, const uint16_t& dataLength, const bool& performChecksum) {
-    if ((getCmdDataLength() - TX_16_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_16_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_16_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_16_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_16_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_16_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_16_REQUEST_HEAD, dataLength);
 
     for (uint16_t i = 0; i < dataLength; i++)
         _cmdData[TX_16_REQUEST_HEAD+i] = data[i];
@@ -1123,16 +1086,7 @@ Tx16Request::setData(const char* data, const bool& performChecksum) {
     uint16_t dataLength = 0;
     for (; data[dataLength]!='\0'; dataLength++);
 
-    if ((getCmdDataLength() - TX_16_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_16_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_16_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_16_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_16_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_16_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_16_REQUEST_HEAD, dataLength);
 
     for (uint16_t i = 0; i < dataLength; i++)
         _cmdData[TX_16_REQUEST_HEAD+i] = data[i];
@@ -1148,16 +1102,7 @@ void
 Tx16Request::setData(const std::initializer_list<uint8_t>& data, const bool& performChecksum) {
     uint16_t dataLength = data.size();
 
-    if ((getCmdDataLength() - TX_16_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_16_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_16_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_16_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_16_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_16_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_16_REQUEST_HEAD, dataLength);
 
 
     uint16_t i = 0;
@@ -1170,8 +1115,6 @@ Tx16Request::setData(const std::initializer_list<uint8_t>& data) {
     setData(data, true);
 }
 #endif
-uint16_t
-Tx16Request::getDataLength() { return getCmdDataLength() - TX_16_REQUEST_HEAD; }
 
 
 AtCommand::AtCommand(const uint8_t& frameId, const uint8_t* data, const uint16_t& dataLength) {
@@ -1205,7 +1148,7 @@ AtCommand::AtCommand(const uint8_t& frameId, const char* data) {
 }
 
 AtCommand::AtCommand(const uint8_t& frameId, const uint16_t& cmd):
-    AtCommand(frameId, (uint8_t*)(&cmd), 2) {}
+    AtCommand(frameId, cmd, nullptr, 0) {}
 AtCommand::AtCommand(const uint8_t& frameId, const uint16_t& cmd,
     const uint8_t* param, const uint16_t& paramLength) {
     _cmdId = AT_COMMAND;
@@ -1250,12 +1193,9 @@ AtCommand::AtCommand(const uint8_t& frameId, const char (&cmd)[3], const std::in
 }
 #endif
 
-uint16_t
-AtCommand::getCmd() { return *((uint16_t*)&(_cmdData[1])); }
 void
 AtCommand::setCmd(const uint16_t& cmd, const bool& performChecksum) {
-    _cmdData[1] = ((uint8_t*)&cmd)[0];
-    _cmdData[2] = ((uint8_t*)&cmd)[1];
+    set<AtCommandSchema::cmd>(cmd);
 
     if (performChecksum) setChecksum();
 }
@@ -1265,8 +1205,8 @@ AtCommand::setCmd(const uint16_t& cmd) {
 }
 void
 AtCommand::setCmd(const char (&cmd)[3], const bool& performChecksum) {
-    _cmdData[1] = cmd[0];
-    _cmdData[2] = cmd[1];
+    _cmdData[AtCommandSchema::cmd::index] = cmd[0];
+    _cmdData[AtCommandSchema::cmd::index+1] = cmd[1];
 
     if (performChecksum) setChecksum();
 }
@@ -1289,21 +1229,10 @@ AtCommand::setCmd(const char (&cmd)[3], const std::initializer_list<uint8_t>& pa
 }
 #endif
 
-uint8_t*
-AtCommand::getParam() { return &(_cmdData[3]); }
 void
 AtCommand::setParam(const uint8_t* param, const uint16_t& paramLength,
     const bool& performChecksum) {
-    if ((getCmdDataLength() - AT_COMMAND_HEAD) != paramLength) {
-        uint8_t head[AT_COMMAND_HEAD];
-        for (uint16_t i = 0; i < AT_COMMAND_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[AT_COMMAND_HEAD+paramLength];
-        setCmdDataLength(AT_COMMAND_HEAD+paramLength);
-
-        for (uint16_t i = 0; i < AT_COMMAND_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(AT_COMMAND_HEAD, paramLength);
 
     for (uint16_t i = 0; i < paramLength; i++) _cmdData[AT_COMMAND_HEAD+i] = param[i];
 
@@ -1318,16 +1247,7 @@ AtCommand::setParam(const char* param, const bool& performChecksum) {
     uint16_t paramLength = 0;
     for (; param[paramLength]!='\0'; paramLength++);
 
-    if ((getCmdDataLength() - AT_COMMAND_HEAD) != paramLength) {
-        uint8_t head[AT_COMMAND_HEAD];
-        for (uint16_t i = 0; i < AT_COMMAND_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[AT_COMMAND_HEAD+paramLength];
-        setCmdDataLength(AT_COMMAND_HEAD+paramLength);
-
-        for (uint16_t i = 0; i < AT_COMMAND_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(AT_COMMAND_HEAD, paramLength);
 
     for (uint16_t i = 0; i < paramLength; i++) _cmdData[AT_COMMAND_HEAD+i] = param[i];
 
@@ -1342,16 +1262,7 @@ void AtCommand::setParam(const std::initializer_list<uint8_t>& param,
     const bool& performChecksum) {
     uint16_t paramLength = param.size();
 
-    if ((getCmdDataLength() - AT_COMMAND_HEAD) != paramLength) {
-        uint8_t head[AT_COMMAND_HEAD];
-        for (uint16_t i = 0; i < AT_COMMAND_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[AT_COMMAND_HEAD+paramLength];
-        setCmdDataLength(AT_COMMAND_HEAD+paramLength);
-
-        for (uint16_t i = 0; i < AT_COMMAND_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(AT_COMMAND_HEAD, paramLength);
 
 
     uint16_t i = 0;
@@ -1363,8 +1274,6 @@ void AtCommand::setParam(const std::initializer_list<uint8_t>& param) {
     setParam(param, true);
 }
 #endif
-uint16_t
-AtCommand::getParamLength() { return getCmdDataLength() - AT_COMMAND_HEAD; }
 
 
 AtQueueCommand::AtQueueCommand(const uint8_t& frameId,
@@ -1380,7 +1289,7 @@ AtQueueCommand::AtQueueCommand(const uint8_t& frameId, const char* data):
 }
 AtQueueCommand::AtQueueCommand(const uint8_t& frameId,
     const uint16_t& cmd):
-    AtQueueCommand(frameId, (uint8_t*)(&cmd), 2) {}
+    AtQueueCommand(frameId, cmd, nullptr, 0) {}
 AtQueueCommand::AtQueueCommand(const uint8_t& frameId, const uint16_t& cmd,
     const uint8_t* param, const uint16_t& paramLength):
     AtCommand(frameId, cmd, param, paramLength) {
@@ -1483,11 +1392,9 @@ TxRequest::TxRequest(const uint8_t& frameId,
     TxRequest(frameId, 0, BROADCAST_ADDRESS64, data) {}
 #endif
 
-uint8_t
-TxRequest::getBroadcast() { return _cmdData[15-CMD_DATA_OFFSET]; }
 void
 TxRequest::setBroadcast(const uint8_t& broadcast, const bool& performChecksum) {
-    _cmdData[15-CMD_DATA_OFFSET] = broadcast;
+    set<TxRequestSchema::broadcast>(broadcast);
 
     if (performChecksum) setChecksum();
 }
@@ -1496,11 +1403,9 @@ TxRequest::setBroadcast(const uint8_t& broadcast) {
     setBroadcast(broadcast, true);
 }
 
-uint8_t
-TxRequest::getOptions() { return _cmdData[16-CMD_DATA_OFFSET]; }
 void
 TxRequest::setOptions(const uint8_t& options, const bool& performChecksum) {
-    _cmdData[16-CMD_DATA_OFFSET] = options;
+    set<TxRequestSchema::options>(options);
 
     if (performChecksum) setChecksum();
 }
@@ -1509,20 +1414,9 @@ TxRequest::setOptions(const uint8_t& options) {
     setOptions(options, true);
 }
 
-uint8_t*
-TxRequest::getData() { return &(_cmdData[17-CMD_DATA_OFFSET]); }
 void
 TxRequest::setData(const uint8_t* data, const uint16_t& dataLength, const bool& performChecksum) {
-    if ((getCmdDataLength() - TX_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_REQUEST_HEAD, dataLength);
 
     for (uint16_t i = 0; i < dataLength; i++)
         _cmdData[TX_REQUEST_HEAD+i] = data[i];
@@ -1538,16 +1432,7 @@ void
 TxRequest::setData(const std::initializer_list<uint8_t>& data, const bool& performChecksum) {
     uint16_t dataLength = data.size();
 
-    if ((getCmdDataLength() - TX_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_REQUEST_HEAD, dataLength);
 
 
     uint16_t i = 0;
@@ -1560,24 +1445,13 @@ TxRequest::setData(const std::initializer_list<uint8_t>& data) {
     setData(data, true);
 }
 #endif
-uint16_t
-TxRequest::getDataLength() { return getCmdDataLength() - TX_REQUEST_HEAD; }
 
 void
 TxRequest::setData(const char* data, const bool& performChecksum) {
     uint16_t dataLength = 0;
     for (; data[dataLength]!='\0'; dataLength++);
 
-    if ((getCmdDataLength() - TX_REQUEST_HEAD) != dataLength) {
-        uint8_t head[TX_REQUEST_HEAD];
-        for (uint16_t i = 0; i < TX_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[TX_REQUEST_HEAD+dataLength];
-        setCmdDataLength(TX_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < TX_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(TX_REQUEST_HEAD, dataLength);
 
     for (uint16_t i = 0; i < dataLength; i++) _cmdData[TX_REQUEST_HEAD+i] = data[i];
 
@@ -1740,11 +1614,9 @@ ExplicitTxRequest::ExplicitTxRequest(const uint8_t& frameId,
         data) {}
 #endif
 
-uint8_t
-ExplicitTxRequest::getSourceEndpoint() { return _cmdData[15-CMD_DATA_OFFSET]; }
 void
 ExplicitTxRequest::setSourceEndpoint(const uint8_t& sourceEndpoint, const bool& performChecksum) {
-    _cmdData[15-CMD_DATA_OFFSET] = sourceEndpoint;
+    set<ExplicitTxRequestSchema::sourceEndpoint>(sourceEndpoint);
 
     if (performChecksum) setChecksum();
 }
@@ -1753,11 +1625,9 @@ ExplicitTxRequest::setSourceEndpoint(const uint8_t& sourceEndpoint) {
     setSourceEndpoint(sourceEndpoint, true);
 }
 
-uint8_t
-ExplicitTxRequest::getDestinationEndpoint() { return _cmdData[16-CMD_DATA_OFFSET]; }
 void
 ExplicitTxRequest::setDestinationEndpoint(const uint8_t& destinationEndpoint, const bool& performChecksum) {
-    _cmdData[16-CMD_DATA_OFFSET] = destinationEndpoint;
+    set<ExplicitTxRequestSchema::destinationEndpoint>(destinationEndpoint);
 
     if (performChecksum) setChecksum();
 }
@@ -1766,13 +1636,9 @@ ExplicitTxRequest::setDestinationEndpoint(const uint8_t& destinationEndpoint) {
     setDestinationEndpoint(destinationEndpoint, true);
 }
 
-uint16_t
-ExplicitTxRequest::getClusterId() { return *((uint16_t*)&(_cmdData[17-CMD_DATA_OFFSET])); }
 void
 ExplicitTxRequest::setClusterId(const uint16_t& clusterId, const bool& performChecksum) {
-    uint8_t* clusterIdptr = &(_cmdData[17-CMD_DATA_OFFSET]);
-    clusterIdptr[0] = (clusterId >> 8) & 0xff;
-    clusterIdptr[1] = clusterId & 0xff;
+    set<ExplicitTxRequestSchema::clusterId>(clusterId);
 
     if (performChecksum) setChecksum();
 }
@@ -1781,13 +1647,9 @@ ExplicitTxRequest::setClusterId(const uint16_t& clusterId) {
     setClusterId(clusterId, true);
 }
 
-uint16_t
-ExplicitTxRequest::getProfileId() { return *((uint16_t*)&(_cmdData[19-CMD_DATA_OFFSET])); }
 void
 ExplicitTxRequest::setProfileId(const uint16_t& profileId, const bool& performChecksum) {
-    uint8_t* profileIdptr = &(_cmdData[19-CMD_DATA_OFFSET]);
-    profileIdptr[0] = (profileId >> 8) & 0xff;
-    profileIdptr[1] = profileId & 0xff;
+    set<ExplicitTxRequestSchema::profileId>(profileId);
 
     if (performChecksum) setChecksum();
 }
@@ -1796,11 +1658,9 @@ ExplicitTxRequest::setProfileId(const uint16_t& profileId) {
     setProfileId(profileId, true);
 }
 
-uint8_t
-ExplicitTxRequest::getBroadcast() { return _cmdData[21-CMD_DATA_OFFSET]; }
 void
 ExplicitTxRequest::setBroadcast(const uint8_t& broadcast, const bool& performChecksum) {
-    _cmdData[21-CMD_DATA_OFFSET] = broadcast;
+    set<ExplicitTxRequestSchema::broadcast>(broadcast);
 
     if (performChecksum) setChecksum();
 }
@@ -1809,11 +1669,9 @@ ExplicitTxRequest::setBroadcast(const uint8_t& broadcast) {
     setBroadcast(broadcast, true);
 }
 
-uint8_t
-ExplicitTxRequest::getOptions() { return _cmdData[22-CMD_DATA_OFFSET]; }
 void
 ExplicitTxRequest::setOptions(const uint8_t& options, const bool& performChecksum) {
-    _cmdData[22-CMD_DATA_OFFSET] = options;
+    set<ExplicitTxRequestSchema::options>(options);
 
     if (performChecksum) setChecksum();
 }
@@ -1822,22 +1680,9 @@ ExplicitTxRequest::setOptions(const uint8_t& options) {
     setOptions(options, true);
 }
 
-uint8_t*
-ExplicitTxRequest::getData() { return &_cmdData[23-CMD_DATA_OFFSET]; }
-uint16_t
-ExplicitTxRequest::getDataLength() { return getCmdDataLength() - EXPLICIT_TX_REQUEST_HEAD; }
 void
 ExplicitTxRequest::setData(const uint8_t* data, const uint16_t& dataLength, const bool& performChecksum) {
-    if ((getCmdDataLength() - EXPLICIT_TX_REQUEST_HEAD) != dataLength) {
-        uint8_t head[EXPLICIT_TX_REQUEST_HEAD];
-        for (uint16_t i = 0; i < EXPLICIT_TX_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[EXPLICIT_TX_REQUEST_HEAD+dataLength];
-        setCmdDataLength(EXPLICIT_TX_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < EXPLICIT_TX_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(EXPLICIT_TX_REQUEST_HEAD, dataLength);
 
     for (uint16_t i = 0; i < dataLength; i++)
         _cmdData[EXPLICIT_TX_REQUEST_HEAD+i] = data[i];
@@ -1854,16 +1699,7 @@ ExplicitTxRequest::setData(const char* data, const bool& performChecksum) {
     uint16_t dataLength = 0;
     for (; data[dataLength]!='\0'; dataLength++);
 
-    if ((getCmdDataLength() - EXPLICIT_TX_REQUEST_HEAD) != dataLength) {
-        uint8_t head[EXPLICIT_TX_REQUEST_HEAD];
-        for (uint16_t i = 0; i < EXPLICIT_TX_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[EXPLICIT_TX_REQUEST_HEAD+dataLength];
-        setCmdDataLength(EXPLICIT_TX_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < EXPLICIT_TX_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(EXPLICIT_TX_REQUEST_HEAD, dataLength);
 
     for (uint16_t i = 0; i < dataLength; i++) _cmdData[EXPLICIT_TX_REQUEST_HEAD+i] = data[i];
 
@@ -1880,16 +1716,7 @@ ExplicitTxRequest::setData(const std::initializer_list<uint8_t>& data,
     const bool& performChecksum) {
     uint16_t dataLength = data.size();
 
-    if ((getCmdDataLength() - EXPLICIT_TX_REQUEST_HEAD) != dataLength) {
-        uint8_t head[EXPLICIT_TX_REQUEST_HEAD];
-        for (uint16_t i = 0; i < EXPLICIT_TX_REQUEST_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[EXPLICIT_TX_REQUEST_HEAD+dataLength];
-        setCmdDataLength(EXPLICIT_TX_REQUEST_HEAD+dataLength);
-
-        for (uint16_t i = 0; i < EXPLICIT_TX_REQUEST_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(EXPLICIT_TX_REQUEST_HEAD, dataLength);
 
 
     uint16_t i = 0;
@@ -1946,7 +1773,7 @@ RemoteAtCommand::RemoteAtCommand(const uint8_t& frameId,
     setAddress64(address64Msb, address64Lsb, false);
     setAddress16(address16, false);
     setOptions(options, false);
-    setCmd(((uint16_t*)data)[0], false);
+    setCmd(getBigEndian16(data), false);
     setParam(&(data[2]), dataLength-2, false);
 
     setChecksum();
@@ -1961,7 +1788,7 @@ RemoteAtCommand::RemoteAtCommand(const uint8_t& frameId,
     const uint16_t& address16, const uint8_t& options,
     const uint16_t& cmd):
     RemoteAtCommand(frameId, address64Msb, address64Lsb,
-        address16, options, (uint8_t*)&cmd, 2) {}
+        address16, options, cmd, nullptr, 0) {}
 RemoteAtCommand::RemoteAtCommand(const uint8_t& frameId,
     const uint32_t& address64Msb, const uint32_t& address64Lsb,
     const uint8_t& options, const uint16_t& cmd):
@@ -1995,7 +1822,7 @@ RemoteAtCommand::RemoteAtCommand(const uint8_t& frameId,
     const uint16_t& address16, const uint8_t& options,
     const char (&cmd)[3], const uint8_t* param, const uint16_t& paramLength):
     RemoteAtCommand(frameId, address64Msb, address64Lsb,
-        address16, options, ((uint16_t*)cmd)[0], param, paramLength) {} // warning: insecure cast
+        address16, options, getBigEndian16((const uint8_t*)cmd), param, paramLength) {}
 RemoteAtCommand::RemoteAtCommand(const uint8_t& frameId,
     const uint32_t& address64Msb, const uint32_t& address64Lsb,
     const uint8_t& options,
@@ -2003,11 +1830,9 @@ RemoteAtCommand::RemoteAtCommand(const uint8_t& frameId,
     RemoteAtCommand(frameId, address64Msb, address64Lsb,
         BROADCAST_ADDRESS16, options, cmd, param, paramLength) {}
 
-uint8_t
-RemoteAtCommand::getOptions() { return _cmdData[15-CMD_DATA_OFFSET]; }
 void
 RemoteAtCommand::setOptions(const uint8_t& options, const bool& performChecksum) {
-    _cmdData[15-CMD_DATA_OFFSET] = options;
+    set<RemoteAtCommandSchema::options>(options);
 
     if (performChecksum) setChecksum();
 }
@@ -2016,12 +1841,9 @@ RemoteAtCommand::setOptions(const uint8_t& options) {
     setOptions(options, true);
 }
 
-uint16_t
-RemoteAtCommand::getCmd() { return *((uint16_t*)&(_cmdData[16-CMD_DATA_OFFSET])); }
 void
 RemoteAtCommand::setCmd(const uint16_t& cmd, const bool& performChecksum) {
-    uint16_t* cmdptr = (uint16_t*)&(_cmdData[16-CMD_DATA_OFFSET]);
-    cmdptr[0] = cmd;
+    set<RemoteAtCommandSchema::cmd>(cmd);
 
     if (performChecksum) setChecksum();
 }
@@ -2034,18 +1856,9 @@ RemoteAtCommand::setCmd(const char* cmd, const bool& performChecksum) {
     uint16_t cmdLength = 0;
     for (; cmd[cmdLength]!='\0'; cmdLength++);
 
-    if (cmdLength!=2 && (getCmdDataLength() - (REMOTE_AT_COMMAND_HEAD-2)) != cmdLength) {
-        uint8_t head[REMOTE_AT_COMMAND_HEAD-2];
-        for (uint16_t i = 0; i < REMOTE_AT_COMMAND_HEAD-2; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[(REMOTE_AT_COMMAND_HEAD-2)+cmdLength];
-        setCmdDataLength((REMOTE_AT_COMMAND_HEAD-2)+cmdLength);
+    if (cmdLength != 2) resizeTail(RemoteAtCommandSchema::cmd::index, cmdLength);
 
-        for (uint16_t i = 0; i < REMOTE_AT_COMMAND_HEAD-2; i++) _cmdData[i] = head[i];
-    }
-
-    for (uint16_t i = 0; i < cmdLength; i++) _cmdData[(REMOTE_AT_COMMAND_HEAD-2)+i] = cmd[i];
+    for (uint16_t i = 0; i < cmdLength; i++) _cmdData[RemoteAtCommandSchema::cmd::index+i] = cmd[i];
 
     if (performChecksum) setChecksum();
 }
@@ -2054,21 +1867,10 @@ RemoteAtCommand::setCmd(const char* cmd) {
     setCmd(cmd, true);
 }
 
-uint8_t*
-RemoteAtCommand::getParam() { return &(_cmdData[18-CMD_DATA_OFFSET]); }
 void
 RemoteAtCommand::setParam(const uint8_t* param, const uint16_t& paramLength,
     const bool& performChecksum) {
-    if ((getCmdDataLength() - REMOTE_AT_COMMAND_HEAD) != paramLength) {
-        uint8_t head[REMOTE_AT_COMMAND_HEAD];
-        for (uint16_t i = 0; i < REMOTE_AT_COMMAND_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[REMOTE_AT_COMMAND_HEAD+paramLength];
-        setCmdDataLength(REMOTE_AT_COMMAND_HEAD+paramLength);
-
-        for (uint16_t i = 0; i < REMOTE_AT_COMMAND_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(REMOTE_AT_COMMAND_HEAD, paramLength);
 
     for (uint16_t i = 0; i < paramLength; i++)
         _cmdData[REMOTE_AT_COMMAND_HEAD+i] = param[i];
@@ -2079,8 +1881,6 @@ void
 RemoteAtCommand::setParam(const uint8_t* param, const uint16_t& paramLength) {
     setParam(param, paramLength, true);
 }
-uint16_t
-RemoteAtCommand::getParamLength() { return getCmdDataLength() - REMOTE_AT_COMMAND_HEAD; }
 
 
 CreateSourceRoute::CreateSourceRoute(const uint8_t& frameId,
@@ -2135,27 +1935,15 @@ CreateSourceRoute::CreateSourceRoute(const uint8_t& frameId,
     CreateSourceRoute(frameId, 0, BROADCAST_ADDRESS64, addresses) {}
 #endif
 
-uint16_t*
-CreateSourceRoute::getAddresses() { return (uint16_t*)&(_cmdData[17-CMD_DATA_OFFSET]); }
 void
 CreateSourceRoute::setAddresses(const uint16_t* addresses, const uint8_t& nAddresses,
     const bool& performChecksum) {
-    if ((getCmdDataLength() - CREATE_SOURCE_ROUTE_HEAD) != 2*nAddresses) {
-        uint8_t head[CREATE_SOURCE_ROUTE_HEAD];
-        for (uint16_t i = 0; i < CREATE_SOURCE_ROUTE_HEAD; i++) head[i] = _cmdData[i];
+    resizeTail(CREATE_SOURCE_ROUTE_HEAD, 2*nAddresses);
 
-        delete[] _cmdData;
-        _cmdData = new uint8_t[CREATE_SOURCE_ROUTE_HEAD+2*nAddresses];
-        setCmdDataLength(CREATE_SOURCE_ROUTE_HEAD+2*nAddresses);
-
-        for (uint16_t i = 0; i < CREATE_SOURCE_ROUTE_HEAD; i++) _cmdData[i] = head[i];
-    }
-
-    _cmdData[16-CMD_DATA_OFFSET] = nAddresses;
+    set<CreateSourceRouteSchema::nAddresses>(nAddresses);
 
     for (uint16_t i = 0; i < nAddresses; i++) {
-        _cmdData[CREATE_SOURCE_ROUTE_HEAD+2*i] = (addresses[i] >> 8) & 0xFF;
-        _cmdData[CREATE_SOURCE_ROUTE_HEAD+2*i+1] = addresses[i] & 0xFF;
+        setBigEndian16(&(_cmdData[CREATE_SOURCE_ROUTE_HEAD+2*i]), addresses[i]);
     }
 
     if (performChecksum) setChecksum();
@@ -2169,23 +1957,14 @@ CreateSourceRoute::setAddresses(const std::initializer_list<uint16_t>& addresses
     const bool& performChecksum) {
     uint8_t nAddresses = addresses.size();
 
-    if ((getCmdDataLength() - CREATE_SOURCE_ROUTE_HEAD) != 2*nAddresses) {
-        uint8_t head[CREATE_SOURCE_ROUTE_HEAD];
-        for (uint16_t i = 0; i < CREATE_SOURCE_ROUTE_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[CREATE_SOURCE_ROUTE_HEAD+2*nAddresses];
-        setCmdDataLength(CREATE_SOURCE_ROUTE_HEAD+2*nAddresses);
+    resizeTail(CREATE_SOURCE_ROUTE_HEAD, 2*nAddresses);
 
-        for (uint16_t i = 0; i < CREATE_SOURCE_ROUTE_HEAD; i++) _cmdData[i] = head[i];
-    }
-
-    _cmdData[16-CMD_DATA_OFFSET] = nAddresses;
+    set<CreateSourceRouteSchema::nAddresses>(nAddresses);
 
     uint16_t i = 0;
     for (uint16_t address : addresses) {
-        _cmdData[CREATE_SOURCE_ROUTE_HEAD+(i++)] = (address >> 8) & 0xFF;
-        _cmdData[CREATE_SOURCE_ROUTE_HEAD+(i++)] = address & 0xFF;
+        setBigEndian16(&(_cmdData[CREATE_SOURCE_ROUTE_HEAD+i]), address);
+        i += 2;
     }
 
     if (performChecksum) setChecksum();
@@ -2194,8 +1973,6 @@ void
 CreateSourceRoute::setAddresses(const std::initializer_list<uint16_t>& addresses) {
     setAddresses(addresses, true);
 }
-uint8_t
-CreateSourceRoute::getNAddresses() { return _cmdData[16-CMD_DATA_OFFSET]; }
 
 
                 
@@ -2236,12 +2013,10 @@ RegisterJoiningDevice::RegisterJoiningDevice(const uint8_t& frameId,
 }
 #endif
 
-uint8_t
-RegisterJoiningDevice::getOptions() { return _cmdData[15-CMD_DATA_OFFSET]; }
 void
 RegisterJoiningDevice::setOptions(const uint8_t& options,
     const bool& performChecksum) {
-    _cmdData[15-CMD_DATA_OFFSET] = options;
+    set<RegisterJoiningDeviceSchema::options>(options);
     if (performChecksum) setChecksum();
 }
 void
@@ -2249,19 +2024,11 @@ RegisterJoiningDevice::setOptions(const uint8_t& options) {
     setOptions(options, true);
 }
 
+
 void
 RegisterJoiningDevice::setKey(const uint8_t* key, const uint8_t& keyLength,
     const bool& performChecksum) {
-    if ((getCmdDataLength() - REGISTER_JOINING_DEVICE_HEAD) != keyLength) {
-        uint8_t head[REGISTER_JOINING_DEVICE_HEAD];
-        for (uint16_t i = 0; i < REGISTER_JOINING_DEVICE_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[REGISTER_JOINING_DEVICE_HEAD+keyLength];
-        setCmdDataLength(REGISTER_JOINING_DEVICE_HEAD+keyLength);
-
-        for (uint16_t i = 0; i < REGISTER_JOINING_DEVICE_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(REGISTER_JOINING_DEVICE_HEAD, keyLength);
 
     for (uint16_t i = 0; i < keyLength; i++)
         _cmdData[REGISTER_JOINING_DEVICE_HEAD+i] = key[i];
@@ -2270,7 +2037,7 @@ RegisterJoiningDevice::setKey(const uint8_t* key, const uint8_t& keyLength,
 }
 void
 RegisterJoiningDevice::setKey(const uint8_t* key, const uint8_t& keyLength) {
-    setKey(key, true);
+    setKey(key, keyLength, true);
 }
 #ifdef XBEENG_WITH_EXTRAS
 void
@@ -2278,16 +2045,7 @@ RegisterJoiningDevice::setKey(const std::initializer_list<uint16_t>& key,
     const bool& performChecksum) {
     uint16_t keyLength = key.size();
 
-    if ((getCmdDataLength() - REGISTER_JOINING_DEVICE_HEAD) != keyLength) {
-        uint8_t head[REGISTER_JOINING_DEVICE_HEAD];
-        for (uint16_t i = 0; i < REGISTER_JOINING_DEVICE_HEAD; i++) head[i] = _cmdData[i];
-
-        delete[] _cmdData;
-        _cmdData = new uint8_t[REGISTER_JOINING_DEVICE_HEAD+keyLength];
-        setCmdDataLength(REGISTER_JOINING_DEVICE_HEAD+keyLength);
-
-        for (uint16_t i = 0; i < REGISTER_JOINING_DEVICE_HEAD; i++) _cmdData[i] = head[i];
-    }
+    resizeTail(REGISTER_JOINING_DEVICE_HEAD, keyLength);
 
 
     uint16_t i = 0;
@@ -2303,45 +2061,15 @@ RegisterJoiningDevice::setKey(const std::initializer_list<uint16_t>& key) {
                 
 
 
-uint8_t
-Rx64Response::getRssi() { return _cmdData[12-CMD_DATA_OFFSET]; }
-uint8_t
-Rx64Response::getOptions() { return _cmdData[13-CMD_DATA_OFFSET]; }
-
-uint8_t*
-Rx64Response::getData() { return &(_cmdData[14-CMD_DATA_OFFSET]); }
-uint16_t
-Rx64Response::getDataLength() { return getCmdDataLength() - RX_64_RESPONSE_HEAD; }
-
-
-uint16_t
-Rx16Response::getAddress16() { return *((uint16_t*)&(_cmdData[4-CMD_DATA_OFFSET])); }
-uint8_t
-Rx16Response::getRssi() { return _cmdData[6-CMD_DATA_OFFSET]; }
-uint8_t
-Rx16Response::getOptions() { return _cmdData[7-CMD_DATA_OFFSET]; }
-
-uint8_t*
-Rx16Response::getData() { return &(_cmdData[8-CMD_DATA_OFFSET]); }
-uint16_t
-Rx16Response::getDataLength() { return getCmdDataLength() - RX_16_RESPONSE_HEAD; }
-
-
-uint8_t
-Rx64DataSample::getNSamples() { return _cmdData[14-CMD_DATA_OFFSET]; }
-uint16_t
-Rx64DataSample::getDigitalMask() { return (*((uint16_t*)&(_cmdData[15-CMD_DATA_OFFSET]))) & 0x1FF; }
-uint8_t
-Rx64DataSample::getAnalogMask() { return (_cmdData[15-CMD_DATA_OFFSET] >> 1) & 0x3F; }
 uint16_t
 Rx64DataSample::getDigitalSamples() {
-    if (getDigitalMask() > 0) return *((uint16_t*)&(_cmdData[17-CMD_DATA_OFFSET]));
+    if (getDigitalMask() > 0) return get<Rx64DataSampleSchema::digitalSamples>();
     return 0;
 }
-uint16_t*
+const uint8_t*
 Rx64DataSample::getAnalogSamples() {
-    if (getDigitalMask() > 0) return ((uint16_t*)&(_cmdData[19-CMD_DATA_OFFSET]));
-    return ((uint16_t*)&(_cmdData[17-CMD_DATA_OFFSET]));
+    if (getDigitalMask() > 0) return &(_cmdData[Rx64DataSampleSchema::digitalSamples::end]);
+    return &(_cmdData[Rx64DataSampleSchema::digitalSamples::index]);
 }
 uint16_t
 Rx64DataSample::getAnalogSamplesLength() {
@@ -2350,21 +2078,15 @@ Rx64DataSample::getAnalogSamplesLength() {
 }
 
 
-uint8_t
-Rx16DataSample::getNSamples() { return _cmdData[8-CMD_DATA_OFFSET]; }
-uint16_t
-Rx16DataSample::getDigitalMask() { return (*((uint16_t*)&(_cmdData[9-CMD_DATA_OFFSET]))) & 0x1FF; }
-uint8_t
-Rx16DataSample::getAnalogMask() { return (_cmdData[9-CMD_DATA_OFFSET] >> 1) & 0x3F; }
 uint16_t
 Rx16DataSample::getDigitalSamples() {
-    if (getDigitalMask() > 0) return *((uint16_t*)&(_cmdData[11-CMD_DATA_OFFSET]));
+    if (getDigitalMask() > 0) return get<Rx16DataSampleSchema::digitalSamples>();
     return 0;
 }
-uint16_t*
+const uint8_t*
 Rx16DataSample::getAnalogSamples() {
-    if (getDigitalMask() > 0) return ((uint16_t*)&(_cmdData[13-CMD_DATA_OFFSET]));
-    return ((uint16_t*)&(_cmdData[11-CMD_DATA_OFFSET]));
+    if (getDigitalMask() > 0) return &(_cmdData[Rx16DataSampleSchema::digitalSamples::end]);
+    return &(_cmdData[Rx16DataSampleSchema::digitalSamples::index]);
 }
 uint16_t
 Rx16DataSample::getAnalogSamplesLength() {
@@ -2373,199 +2095,836 @@ Rx16DataSample::getAnalogSamplesLength() {
 }
 
 
+uint8_t
+TxStatus::getDeliveryStatus() {
+    if (_cmdId == TX_STATUS_RESPONSE) // 802.15.4 case!
+        return get<TxStatusResponseSchema::status>();
+    return get<TxStatusSchema::deliveryStatus>();
+}
+
+
+uint16_t
+RxDataSample::getDigitalSamples() {
+    if (getDigitalMask() > 0) return get<RxDataSampleSchema::digitalSamples>();
+    return 0;
+}
+const uint8_t*
+RxDataSample::getAnalogSamples() {
+    if (getDigitalMask() > 0) return &(_cmdData[RxDataSampleSchema::digitalSamples::end]);
+    return &(_cmdData[RxDataSampleSchema::digitalSamples::index]);
+}
 uint16_t
-AtCommandResponse::getCmd() { return *((uint16_t*)&(_cmdData[5-CMD_DATA_OFFSET])); }
+RxDataSample::getAnalogSamplesLength() {
+    if (getDigitalMask() > 0) return (getCmdDataLength() - RX_DATA_SAMPLE_HEAD)/2;
+    return (2 + getCmdDataLength() - RX_DATA_SAMPLE_HEAD)/2;
+}
 
-uint8_t
-AtCommandResponse::getStatus() { return _cmdData[7-CMD_DATA_OFFSET]; }
 
-uint8_t*
-AtCommandResponse::getData() { return &(_cmdData[8-CMD_DATA_OFFSET]); }
 uint16_t
-AtCommandResponse::getDataLength() { return getCmdDataLength() - AT_COMMAND_RESPONSE_HEAD; }
+RxNodeId::getNiLength() {
+    uint16_t cmdDataLength = getCmdDataLength();
+    if (cmdDataLength <= RxNodeIdSchema::ni::index) return 0;
+
+    // an unterminated NI stops at the end of the frame
+    uint8_t* ni = getNi();
+    uint8_t* end = (uint8_t*) memchr(ni, '\0', cmdDataLength - RxNodeIdSchema::ni::index);
+    if (end == nullptr) return cmdDataLength - RxNodeIdSchema::ni::index;
+    return end - ni;
+}
 
 
+uint32_t
+RxNodeId::getDigiDd() {
+    uint16_t niLength = getNiLength();
+    if (getCmdDataLength() >= RxNodeIdSchema::digiDd::end+niLength)
+        return getField<RxNodeIdSchema::digiDd>(_cmdData+niLength);
+    return 0;
+}
 uint8_t
-TxStatusResponse::getStatus() { return _cmdData[5-CMD_DATA_OFFSET]; }
+RxNodeId::getRssi() {
+    uint16_t niLength = getNiLength();
+    if (getCmdDataLength() >= RxNodeIdSchema::rssi::end+niLength)
+        return getField<RxNodeIdSchema::rssi>(_cmdData+niLength);
+    return 0;
+}
 
 
-uint8_t
-ModemStatus::getStatus() { return _cmdData[4-CMD_DATA_OFFSET]; }
+RxNodeIdView::RxNodeIdView() {
+    _cmdData = nullptr;
+    _niLength = 0;
+    _hasDigiDd = false;
+    _hasRssi = false;
+}
+
+bool
+RxNodeIdView::parse(XBeeApiFrame& frame) {
+    _cmdData = nullptr;
+    if (frame.getCmdId() != RX_NODE_ID) return false;
 
+    uint16_t cmdDataLength = frame.getCmdDataLength();
+    if (cmdDataLength < RxNodeIdSchema::digiManufacturerId::end) return false;
 
-uint16_t
-TxStatus::getAddress16() { return *((uint16_t*)&(_cmdData[5-CMD_DATA_OFFSET])); }
+    uint8_t* cmdData = frame.getCmdData();
+    uint8_t* ni = &(cmdData[RxNodeIdSchema::ni::index]);
+    uint8_t* end = (uint8_t*) memchr(ni, '\0', cmdDataLength - RxNodeIdSchema::ni::index);
+    if (end == nullptr) return false;
 
-uint8_t
-TxStatus::getRetryCount() { return _cmdData[7-CMD_DATA_OFFSET]; }
+    uint16_t niLength = end - ni;
+    if (cmdDataLength < RxNodeIdSchema::digiManufacturerId::end+niLength) return false;
 
-uint8_t
-TxStatus::getDeliveryStatus() {
-    if (_cmdId == TX_STATUS_RESPONSE) // 802.15.4 case!
-        return _cmdData[5-CMD_DATA_OFFSET];
-    return _cmdData[8-CMD_DATA_OFFSET];
+    _cmdData = cmdData;
+    _niLength = niLength;
+    _hasDigiDd = cmdDataLength >= RxNodeIdSchema::digiDd::end+niLength;
+    _hasRssi = cmdDataLength >= RxNodeIdSchema::rssi::end+niLength;
+    return true;
 }
 
-uint8_t
-TxStatus::getDiscoveryStatus() { return _cmdData[9-CMD_DATA_OFFSET]; }
 
+AddressCache::AddressCache() { clear(); }
 
-uint8_t
-RouteInformation::getSourceEvent() { return _cmdData[4-CMD_DATA_OFFSET]; }
-uint8_t
-RouteInformation::getLength() { return _cmdData[5-CMD_DATA_OFFSET]; }
-uint32_t
-RouteInformation::getTimestamp() { return *((uint32_t*)&(_cmdData[6-CMD_DATA_OFFSET])); }
-uint8_t
-RouteInformation::getAckTimoutCount() { return _cmdData[10-CMD_DATA_OFFSET]; }
+void
+AddressCache::learn(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+    const uint16_t& address16) {
+    if (address16 == BROADCAST_ADDRESS16) return;
+
+    uint8_t home = getHomeSlot(address64Msb, address64Lsb);
+    uint8_t i = home;
+    uint8_t n = 0;
+    for (; n < ADDRESS_CACHE_SIZE; n++) {
+        if (_address16[i] == BROADCAST_ADDRESS16) {
+            _size++;
+            break;
+        }
+        if (_address64Msb[i] == address64Msb && _address64Lsb[i] == address64Lsb) break;
+        i = (i+1) & (ADDRESS_CACHE_SIZE-1);
+    }
+    // table full: the entry at the home slot is replaced
+    if (n == ADDRESS_CACHE_SIZE) i = home;
 
-uint32_t
-RouteInformation::getDestinationAddress64Msb() { return *((uint32_t*)&(_cmdData[13-CMD_DATA_OFFSET])); }
-uint32_t
-RouteInformation::getDestinationAddress64Lsb() { return *((uint32_t*)&(_cmdData[17-CMD_DATA_OFFSET])); }
+    _address64Msb[i] = address64Msb;
+    _address64Lsb[i] = address64Lsb;
+    _address16[i] = address16;
+}
 
-uint32_t
-RouteInformation::getSourceAddress64Msb() { return *((uint32_t*)&(_cmdData[21-CMD_DATA_OFFSET])); }
-uint32_t
-RouteInformation::getSourceAddress64Lsb() { return *((uint32_t*)&(_cmdData[25-CMD_DATA_OFFSET])); }
+bool
+AddressCache::lookup(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+    uint16_t& address16) {
+    int16_t i = find(address64Msb, address64Lsb);
+    if (i < 0) return false;
 
-uint32_t
-RouteInformation::getResponderAddress64Msb() { return *((uint32_t*)&(_cmdData[29-CMD_DATA_OFFSET])); }
-uint32_t
-RouteInformation::getResponderAddress64Lsb() { return *((uint32_t*)&(_cmdData[33-CMD_DATA_OFFSET])); }
+    address16 = _address16[i];
+    return true;
+}
 
-uint32_t
-RouteInformation::getReceiverAddress64Msb() { return *((uint32_t*)&(_cmdData[37-CMD_DATA_OFFSET])); }
-uint32_t
-RouteInformation::getReceiverAddress64Lsb() { return *((uint32_t*)&(_cmdData[41-CMD_DATA_OFFSET])); }
+void
+AddressCache::invalidate(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    int16_t i = find(address64Msb, address64Lsb);
+    if (i < 0) return;
+
+    // backward shift deletion: pull back the entries of the probe
+    // sequence that would become unreachable through the hole
+    uint8_t hole = i;
+    uint8_t j = i;
+    for (uint8_t n = 1; n < ADDRESS_CACHE_SIZE; n++) {
+        j = (j+1) & (ADDRESS_CACHE_SIZE-1);
+        if (_address16[j] == BROADCAST_ADDRESS16) break;
+
+        uint8_t home = getHomeSlot(_address64Msb[j], _address64Lsb[j]);
+        if (((j-home) & (ADDRESS_CACHE_SIZE-1)) >= ((j-hole) & (ADDRESS_CACHE_SIZE-1))) {
+            _address64Msb[hole] = _address64Msb[j];
+            _address64Lsb[hole] = _address64Lsb[j];
+            _address16[hole] = _address16[j];
+            hole = j;
+        }
+    }
+
+    _address16[hole] = BROADCAST_ADDRESS16;
+    _size--;
+}
+
+void
+AddressCache::clear() {
+    for (uint8_t i = 0; i < ADDRESS_CACHE_SIZE; i++) _address16[i] = BROADCAST_ADDRESS16;
+    _size = 0;
+}
 
+uint8_t
+AddressCache::getSize() { return _size; }
 
 uint8_t
-AggregateAddressing::getFormatId() { return _cmdData[4-CMD_DATA_OFFSET]; }
+AddressCache::getHomeSlot(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    // the serial numbers of Digi modules differ mostly in the low word
+    uint32_t h = address64Lsb ^ address64Msb;
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return h & (ADDRESS_CACHE_SIZE-1);
+}
+
+int16_t
+AddressCache::find(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    uint8_t i = getHomeSlot(address64Msb, address64Lsb);
+    for (uint8_t n = 0; n < ADDRESS_CACHE_SIZE; n++) {
+        if (_address16[i] == BROADCAST_ADDRESS16) return -1;
+        if (_address64Msb[i] == address64Msb && _address64Lsb[i] == address64Lsb) return i;
+        i = (i+1) & (ADDRESS_CACHE_SIZE-1);
+    }
+    return -1;
+}
 
-uint32_t
-AggregateAddressing::getNewAddress64Msb() { return *((uint32_t*)&(_cmdData[5-CMD_DATA_OFFSET])); }
-uint32_t
-AggregateAddressing::getNewAddress64Lsb() { return *((uint32_t*)&(_cmdData[9-CMD_DATA_OFFSET])); }
+
+UnreachableCache::UnreachableCache() { clear(); }
+
+void
+UnreachableCache::markUnreachable(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    int8_t i = find(address64Msb, address64Lsb);
+    if (i < 0) {
+        // a free slot, or else the oldest failure
+        i = 0;
+        for (uint8_t j = 0; j < UNREACHABLE_CACHE_SIZE; j++) {
+            if (_failures[j] == 0) {
+                i = j;
+                break;
+            }
+            if ((int32_t)(_since[j] - _since[i]) < 0) i = j;
+        }
+        _address64Msb[i] = address64Msb;
+        _address64Lsb[i] = address64Lsb;
+        _failures[i] = 0;
+        _holdDown[i] = UNREACHABLE_HOLD_DOWN/2;
+    }
+
+    if (_failures[i] < 0xff) _failures[i]++;
+    _holdDown[i] *= 2;
+    if (_holdDown[i] > UNREACHABLE_MAX_HOLD_DOWN) _holdDown[i] = UNREACHABLE_MAX_HOLD_DOWN;
+    _since[i] = millis();
+}
+
+void
+UnreachableCache::markReachable(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    int8_t i = find(address64Msb, address64Lsb);
+    if (i >= 0) _failures[i] = 0;
+}
+
+bool
+UnreachableCache::isUnreachable(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    return getHoldDown(address64Msb, address64Lsb) > 0;
+}
 
 uint32_t
-AggregateAddressing::getOldAddress64Msb() { return *((uint32_t*)&(_cmdData[13-CMD_DATA_OFFSET])); }
-uint32_t
-AggregateAddressing::getOldAddress64Lsb() { return *((uint32_t*)&(_cmdData[17-CMD_DATA_OFFSET])); }
+UnreachableCache::getHoldDown(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    int8_t i = find(address64Msb, address64Lsb);
+    if (i < 0) return 0;
+
+    uint32_t elapsed = millis() - _since[i];
+    if (elapsed >= _holdDown[i]) return 0;
+    return _holdDown[i] - elapsed;
+}
 
+void
+UnreachableCache::clear() {
+    for (uint8_t i = 0; i < UNREACHABLE_CACHE_SIZE; i++) _failures[i] = 0;
+}
 
 uint8_t
-RxResponse::getOptions() { return _cmdData[14-CMD_DATA_OFFSET]; }
+UnreachableCache::getSize() {
+    uint8_t size = 0;
+    for (uint8_t i = 0; i < UNREACHABLE_CACHE_SIZE; i++) if (_failures[i] > 0) size++;
+    return size;
+}
 
-uint8_t*
-RxResponse::getData() { return &(_cmdData[15-CMD_DATA_OFFSET]); }
-uint16_t
-RxResponse::getDataLength() { return getCmdDataLength() - RX_RESPONSE_HEAD; }
+int8_t
+UnreachableCache::find(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    for (uint8_t i = 0; i < UNREACHABLE_CACHE_SIZE; i++) {
+        if (_failures[i] > 0 &&
+            _address64Msb[i] == address64Msb && _address64Lsb[i] == address64Lsb) return i;
+    }
+    return -1;
+}
+
+
+SourceRouteCache::SourceRouteCache() {
+    clear();
+    _hits = 0;
+    _misses = 0;
+}
+
+bool
+SourceRouteCache::learn(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+    const uint16_t& address16, const uint16_t* addresses, const uint8_t& nAddresses) {
+    int8_t i = find(address64Msb, address64Lsb);
+    if (nAddresses > MAX_SOURCE_ROUTE_HOPS) {
+        if (i >= 0) _nAddresses[i] = 0xff;
+        return false;
+    }
+
+    if (i < 0) {
+        // a free slot, or else the least recently used route
+        i = 0;
+        for (uint8_t j = 0; j < SOURCE_ROUTE_CACHE_SIZE; j++) {
+            if (_nAddresses[j] == 0xff) {
+                i = j;
+                break;
+            }
+            if ((int32_t)(_lastUsed[j] - _lastUsed[i]) < 0) i = j;
+        }
+        _address64Msb[i] = address64Msb;
+        _address64Lsb[i] = address64Lsb;
+    }
+
+    _address16[i] = address16;
+    for (uint8_t j = 0; j < nAddresses; j++) _addresses[i][j] = addresses[j];
+    _nAddresses[i] = nAddresses;
+    _lastUsed[i] = millis();
+    return true;
+}
+
+bool
+SourceRouteCache::lookup(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+    uint16_t& address16, const uint16_t*& addresses, uint8_t& nAddresses) {
+    int8_t i = find(address64Msb, address64Lsb);
+    if (i < 0) {
+        _misses++;
+        return false;
+    }
+    _hits++;
+
+    address16 = _address16[i];
+    addresses = _addresses[i];
+    nAddresses = _nAddresses[i];
+    _lastUsed[i] = millis();
+    return true;
+}
 
+void
+SourceRouteCache::invalidate(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    int8_t i = find(address64Msb, address64Lsb);
+    if (i >= 0) _nAddresses[i] = 0xff;
+}
+
+void
+SourceRouteCache::clear() {
+    for (uint8_t i = 0; i < SOURCE_ROUTE_CACHE_SIZE; i++) _nAddresses[i] = 0xff;
+}
 
 uint8_t
-ExplicitRxResponse::getSourceEndpoint() { return _cmdData[14-CMD_DATA_OFFSET]; }
+SourceRouteCache::getSize() {
+    uint8_t size = 0;
+    for (uint8_t i = 0; i < SOURCE_ROUTE_CACHE_SIZE; i++) if (_nAddresses[i] != 0xff) size++;
+    return size;
+}
+uint32_t
+SourceRouteCache::getHits() { return _hits; }
+uint32_t
+SourceRouteCache::getMisses() { return _misses; }
+
+int8_t
+SourceRouteCache::find(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    for (uint8_t i = 0; i < SOURCE_ROUTE_CACHE_SIZE; i++) {
+        if (_nAddresses[i] != 0xff &&
+            _address64Msb[i] == address64Msb && _address64Lsb[i] == address64Lsb) return i;
+    }
+    return -1;
+}
+
+
+// TxRequest, ExplicitTxRequest and RemoteAtCommand to a single node
+static bool
+isUnicastRequest(const uint8_t& cmdId, const uint8_t* cmdData) {
+    if (cmdId != TX_REQUEST && cmdId != EXPLICIT_TX_REQUEST && cmdId != REMOTE_AT_COMMAND)
+        return false;
+
+    return getField<TxRxFrameIdDescriptionSchema::address64Msb>(cmdData) != 0 ||
+        getField<TxRxFrameIdDescriptionSchema::address64Lsb>(cmdData) != BROADCAST_ADDRESS64;
+}
+static bool
+isUnicastRequest(XBeeApiFrame& request) {
+    return isUnicastRequest(request.getCmdId(), request.getCmdData());
+}
+
+// cmdId of the status answering a request with a frame id, 0 if none
+static uint8_t
+getStatusCmdId(const uint8_t& requestCmdId) {
+    switch (requestCmdId) {
+    case AT_COMMAND:
+    case AT_QUEUE_COMMAND:
+        return AT_COMMAND_RESPONSE;
+    case REMOTE_AT_COMMAND:
+        return REMOTE_AT_COMMAND_RESPONSE;
+    case TX_64_REQUEST:
+    case TX_16_REQUEST:
+        return TX_STATUS_RESPONSE;
+    case TX_REQUEST:
+    case EXPLICIT_TX_REQUEST:
+        return TX_STATUS;
+    case REGISTER_JOINING_DEVICE:
+        return REGISTER_JOINING_DEVICE_STATUS;
+    default:
+        return 0;
+    }
+}
+
+
+/*
+ * Converts n big-endian 16-bit values to host order: eight at a time
+ * in a 128-bit register with SSE2 or NEON (little-endian hosts), then
+ * two at a time in a 32-bit word (SWAR)
+ */
+static void
+decodeBigEndian16(const uint8_t* src, uint16_t* dst, const uint8_t& n) {
+    uint8_t i = 0;
+#if defined(__SSE2__)
+    for (; i+8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*) &(src[2*i]));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i*) &(dst[i]), v);
+    }
+#elif defined(__ARM_NEON) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i+8 <= n; i += 8)
+        vst1q_u8((uint8_t*) &(dst[i]), vrev16q_u8(vld1q_u8(&(src[2*i]))));
+#endif
+    for (; i+1 < n; i += 2) {
+        uint32_t w;
+        memcpy(&w, &(src[2*i]), 4);
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+        w = ((w & 0x00ff00ffUL) << 8) | ((w >> 8) & 0x00ff00ffUL);
+#endif
+        memcpy(&(dst[i]), &w, 4);
+    }
+    if (i < n) dst[i] = getBigEndian16(&(src[2*i]));
+}
+
+
+IoSampleColumns::IoSampleColumns() { clear(); }
+
 uint8_t
-ExplicitRxResponse::getDestinationEndpoint() { return _cmdData[15-CMD_DATA_OFFSET]; }
+IoSampleColumns::decode(XBeeApiFrame& frame) {
+    uint8_t* cmdData = frame.getCmdData();
+    uint16_t length = frame.getCmdDataLength();
+
+    uint32_t address64Msb = 0;
+    uint32_t address64Lsb = 0;
+    uint16_t address16 = BROADCAST_ADDRESS16;
+    uint8_t nSamples;
+    uint16_t digitalMask;
+    uint8_t analogMask;
+    uint16_t pos;
+
+    switch (frame.getCmdId()) {
+    case RX_64_DATA_SAMPLE: {
+        if (!frame.has<Rx64DataSampleSchema::digitalMask>()) return 0;
+        address64Msb = frame.get<Rx64DataSampleSchema::address64Msb>();
+        address64Lsb = frame.get<Rx64DataSampleSchema::address64Lsb>();
+
+        // 802.15.4: A0-A5 and D8 in the first byte, D0-D7 in the second
+        nSamples = frame.get<Rx64DataSampleSchema::nSamples>();
+        uint16_t mask = frame.get<Rx64DataSampleSchema::digitalMask>();
+        digitalMask = mask & 0x1ff;
+        analogMask = (mask >> 9) & 0x3f;
+        pos = Rx64DataSampleSchema::digitalSamples::index;
+    } break;
+    case RX_16_DATA_SAMPLE: {
+        if (!frame.has<Rx16DataSampleSchema::digitalMask>()) return 0;
+        address16 = frame.get<Rx16DataSampleSchema::address16>();
+
+        nSamples = frame.get<Rx16DataSampleSchema::nSamples>();
+        uint16_t mask = frame.get<Rx16DataSampleSchema::digitalMask>();
+        digitalMask = mask & 0x1ff;
+        analogMask = (mask >> 9) & 0x3f;
+        pos = Rx16DataSampleSchema::digitalSamples::index;
+    } break;
+    case RX_DATA_SAMPLE: {
+        if (!frame.has<RxDataSampleSchema::analogMask>()) return 0;
+        address64Msb = frame.get<RxDataSampleSchema::address64Msb>();
+        address64Lsb = frame.get<RxDataSampleSchema::address64Lsb>();
+        address16 = frame.get<RxDataSampleSchema::address16>();
+
+        nSamples = frame.get<RxDataSampleSchema::nSamples>();
+        digitalMask = frame.get<RxDataSampleSchema::digitalMask>();
+        analogMask = frame.get<RxDataSampleSchema::analogMask>();
+        pos = RxDataSampleSchema::digitalSamples::index;
+    } break;
+    default: return 0;
+    }
+
+    // the channels of the mask, in the order of the values
+    uint8_t channels[IO_SAMPLE_ANALOG_CHANNELS];
+    uint8_t nChannels = 0;
+    for (uint8_t c = 0; c < IO_SAMPLE_ANALOG_CHANNELS; c++)
+        if ((analogMask >> c) & 1) channels[nChannels++] = c;
+
+    // every field of the samples is a big-endian 16-bit word
+    uint16_t words[MAX_CMD_DATA_SIZE/2];
+    uint16_t nWords = (length - pos)/2;
+    if (nWords > MAX_CMD_DATA_SIZE/2) nWords = MAX_CMD_DATA_SIZE/2;
+    decodeBigEndian16(&(cmdData[pos]), words, nWords);
+    uint8_t sampleWords = ((digitalMask != 0) ? 1 : 0) + nChannels;
+
+    uint8_t added = 0;
+    uint16_t w = 0;
+    for (uint8_t n = 0; n < nSamples && _rows < IO_SAMPLE_MAX_ROWS; n++) {
+        if (w + sampleWords > nWords) break;
+
+        uint16_t row = _rows++;
+        _address64Msb[row] = address64Msb;
+        _address64Lsb[row] = address64Lsb;
+        _address16[row] = address16;
+        _digitalMasks[row] = digitalMask;
+        _analogMasks[row] = analogMask;
+
+        uint16_t digital = 0;
+        if (digitalMask != 0) digital = words[w++] & digitalMask;
+        _digital[row] = digital;
+        for (uint8_t l = 0; l < IO_SAMPLE_DIGITAL_LINES; l++)
+            _digitalLines[l][row] = (digital >> l) & 1;
+
+        for (uint8_t c = 0; c < IO_SAMPLE_ANALOG_CHANNELS; c++) _analog[c][row] = 0;
+        for (uint8_t k = 0; k < nChannels; k++) _analog[channels[k]][row] = words[w+k];
+        w += nChannels;
+
+        added++;
+    }
+
+    if (added > 0) {
+        _digitalMask |= digitalMask;
+        _analogMask |= analogMask;
+    }
+    return added;
+}
+
+void
+IoSampleColumns::clear() {
+    _rows = 0;
+    _digitalMask = 0;
+    _analogMask = 0;
+}
+
 uint16_t
-ExplicitRxResponse::getClusterId() { return *((uint16_t*)&(_cmdData[16-CMD_DATA_OFFSET])); }
+IoSampleColumns::getRows() { return _rows; }
 uint16_t
-ExplicitRxResponse::getProfileId() { return *((uint16_t*)&(_cmdData[18-CMD_DATA_OFFSET])); }
-
+IoSampleColumns::getDigitalMask() { return _digitalMask; }
 uint8_t
-ExplicitRxResponse::getOptions() { return _cmdData[20-CMD_DATA_OFFSET]; }
+IoSampleColumns::getAnalogMask() { return _analogMask; }
 
+uint16_t*
+IoSampleColumns::getAnalog(const uint8_t& channel) { return _analog[channel]; }
 uint8_t*
-ExplicitRxResponse::getData() { return &(_cmdData[21-CMD_DATA_OFFSET]); }
-uint16_t
-ExplicitRxResponse::getDataLength() { return getCmdDataLength() - EXPLICIT_RX_RESPONSE_HEAD; }
+IoSampleColumns::getDigitalLine(const uint8_t& line) { return _digitalLines[line]; }
+uint16_t*
+IoSampleColumns::getDigital() { return _digital; }
+uint16_t*
+IoSampleColumns::getDigitalMasks() { return _digitalMasks; }
+uint8_t*
+IoSampleColumns::getAnalogMasks() { return _analogMasks; }
 
+uint32_t*
+IoSampleColumns::getAddress64Msb() { return _address64Msb; }
+uint32_t*
+IoSampleColumns::getAddress64Lsb() { return _address64Lsb; }
+uint16_t*
+IoSampleColumns::getAddress16() { return _address16; }
+
+
+static const uint32_t timeSeriesResolutions[TIME_SERIES_RESOLUTIONS] = TIME_SERIES_RESOLUTION_MS;
+
+TimeSeriesStore::TimeSeriesStore() { clear(); }
 
-uint8_t
-RxDataSample::getNSamples() { return _cmdData[15-CMD_DATA_OFFSET]; }
-uint16_t
-RxDataSample::getDigitalMask() { return *((uint16_t*)&(_cmdData[16-CMD_DATA_OFFSET])); }
-uint8_t
-RxDataSample::getAnalogMask() { return _cmdData[18-CMD_DATA_OFFSET]; }
 uint16_t
-RxDataSample::getDigitalSamples() {
-    if (getDigitalMask() > 0) return *((uint16_t*)&(_cmdData[19-CMD_DATA_OFFSET]));
-    return 0;
+TimeSeriesStore::add(IoSampleColumns& samples) {
+    uint32_t now = millis();
+    uint16_t rows = samples.getRows();
+
+    uint16_t values[TIME_SERIES_CHANNELS];
+    for (uint16_t row = 0; row < rows; row++) {
+        for (uint8_t c = 0; c < TIME_SERIES_CHANNELS && c < IO_SAMPLE_ANALOG_CHANNELS; c++)
+            values[c] = samples.getAnalog(c)[row];
+
+        uint32_t address64Msb = samples.getAddress64Msb()[row];
+        uint32_t address64Lsb = samples.getAddress64Lsb()[row];
+        if (address64Msb == 0 && address64Lsb == 0) address64Lsb = samples.getAddress16()[row];
+        add(address64Msb, address64Lsb, samples.getAnalogMasks()[row], values, now);
+    }
+    return rows;
 }
-uint16_t*
-RxDataSample::getAnalogSamples() {
-    if (getDigitalMask() > 0) return ((uint16_t*)&(_cmdData[21-CMD_DATA_OFFSET]));
-    return ((uint16_t*)&(_cmdData[19-CMD_DATA_OFFSET]));
+
+void
+TimeSeriesStore::add(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+    const uint8_t& analogMask, const uint16_t* values, const uint32_t& time) {
+    uint16_t node = getNode(address64Msb, address64Lsb);
+    _updatedAt[node] = time;
+
+    uint8_t sample = _sampleHead[node];
+    _sampleHead[node] = (sample+1) % TIME_SERIES_RING_SIZE;
+    if (_sampleCount[node] < TIME_SERIES_RING_SIZE) _sampleCount[node]++;
+    _sampleTime[node][sample] = time;
+    _sampleMask[node][sample] = analogMask;
+
+    for (uint8_t r = 0; r < TIME_SERIES_RESOLUTIONS; r++) {
+        uint32_t start = time - (time % timeSeriesResolutions[r]);
+        uint8_t period = _periodHead[node][r];
+
+        // a new period: the oldest one is forgotten
+        if (_periodCount[node][r] == 0 || _periodStart[node][r][period] != start) {
+            if (_periodCount[node][r] > 0) period = (period+1) % TIME_SERIES_PERIODS;
+            if (_periodCount[node][r] < TIME_SERIES_PERIODS) _periodCount[node][r]++;
+            _periodHead[node][r] = period;
+            _periodStart[node][r][period] = start;
+            for (uint8_t c = 0; c < TIME_SERIES_CHANNELS; c++) _count[node][c][r][period] = 0;
+        }
+    }
+
+    for (uint8_t c = 0; c < TIME_SERIES_CHANNELS; c++) {
+        if (!((analogMask >> c) & 1)) continue;
+        uint16_t value = values[c];
+        _samples[node][c][sample] = value;
+
+        for (uint8_t r = 0; r < TIME_SERIES_RESOLUTIONS; r++) {
+            uint8_t period = _periodHead[node][r];
+            if (_count[node][c][r][period] == 0) {
+                _min[node][c][r][period] = value;
+                _max[node][c][r][period] = value;
+                _sum[node][c][r][period] = 0;
+            } else {
+                if (value < _min[node][c][r][period]) _min[node][c][r][period] = value;
+                if (value > _max[node][c][r][period]) _max[node][c][r][period] = value;
+            }
+            _last[node][c][r][period] = value;
+            _sum[node][c][r][period] += value;
+            if (_count[node][c][r][period] != 0xffff) _count[node][c][r][period]++;
+        }
+    }
 }
-uint16_t
-RxDataSample::getAnalogSamplesLength() {
-    if (getDigitalMask() > 0) return (getCmdDataLength() - RX_DATA_SAMPLE_HEAD)/2;
-    return (2 + getCmdDataLength() - RX_DATA_SAMPLE_HEAD)/2;
+
+void
+TimeSeriesStore::clear() {
+    for (uint16_t i = 0; i < 2*TIME_SERIES_NODES; i++) _slots[i] = -1;
+    _nodes = 0;
 }
 
+int16_t
+TimeSeriesStore::findNode(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    int16_t slot = findSlot(address64Msb, address64Lsb);
+    if (slot < 0) return -1;
+    return _slots[slot];
+}
 
 uint8_t
-RxSensorRead::getOptions() { return _cmdData[14-CMD_DATA_OFFSET]; }
-uint8_t
-RxSensorRead::get1WireSensors() { return _cmdData[15-CMD_DATA_OFFSET]; }
+TimeSeriesStore::getSamples(const uint16_t& node) {
+    if (node >= _nodes) return 0;
+    return _sampleCount[node];
+}
 
-uint16_t*
-RxSensorRead::getADValues() { return ((uint16_t*)&(_cmdData[16-CMD_DATA_OFFSET])); }
-uint16_t
-RxSensorRead::getTemp() { return *((uint16_t*)&(_cmdData[24-CMD_DATA_OFFSET])); }
+bool
+TimeSeriesStore::getSample(const uint16_t& node, const uint8_t& channel, const uint8_t& age,
+    uint16_t& value, uint32_t& time) {
+    if (channel >= TIME_SERIES_CHANNELS || age >= getSamples(node)) return false;
 
+    uint8_t sample = (_sampleHead[node] + TIME_SERIES_RING_SIZE - 1 - age) % TIME_SERIES_RING_SIZE;
+    if (!((_sampleMask[node][sample] >> channel) & 1)) return false;
 
-uint16_t
-RxNodeId::getSourceAddress16() { return *((uint16_t*)&(_cmdData[15-CMD_DATA_OFFSET])); }
-uint32_t
-RxNodeId::getNetworkAddress64Msb() { return *((uint32_t*)&(_cmdData[17-CMD_DATA_OFFSET])); }
-uint32_t
-RxNodeId::getNetworkAddress64Lsb() { return *((uint32_t*)&(_cmdData[21-CMD_DATA_OFFSET])); }
+    value = _samples[node][channel][sample];
+    time = _sampleTime[node][sample];
+    return true;
+}
 
-uint8_t*
-RxNodeId::getNi() { return &(_cmdData[25-CMD_DATA_OFFSET]); }
-uint16_t
-RxNodeId::getNiLength() {
-    uint8_t* ni = getNi();
-    uint16_t niLength = 0;
-    for (; ni[niLength]!='\0'; niLength++);
+bool
+TimeSeriesStore::getAggregate(const uint16_t& node, const uint8_t& channel,
+    const uint8_t& resolution, const uint8_t& age, TimeSeriesAggregate& aggregate) {
+    if (node >= _nodes || channel >= TIME_SERIES_CHANNELS ||
+        resolution >= TIME_SERIES_RESOLUTIONS || age >= _periodCount[node][resolution]) return false;
 
-    return niLength;
+    uint8_t period = (_periodHead[node][resolution] + TIME_SERIES_PERIODS - age) % TIME_SERIES_PERIODS;
+    uint16_t count = _count[node][channel][resolution][period];
+    if (count == 0) return false;
+
+    aggregate.start = _periodStart[node][resolution][period];
+    aggregate.count = count;
+    aggregate.min = _min[node][channel][resolution][period];
+    aggregate.max = _max[node][channel][resolution][period];
+    aggregate.mean = _sum[node][channel][resolution][period] / count;
+    aggregate.last = _last[node][channel][resolution][period];
+    return true;
 }
 
 uint16_t
-RxNodeId::getParentAddress16() { return *((uint16_t*)&(_cmdData[27+(getNiLength()-1)-CMD_DATA_OFFSET])); }
-uint8_t
-RxNodeId::getType() { return _cmdData[29+(getNiLength()-1)-CMD_DATA_OFFSET]; }
-uint8_t
-RxNodeId::getSourceEvent() { return _cmdData[30+(getNiLength()-1)-CMD_DATA_OFFSET]; }
-uint16_t
-RxNodeId::getDigiProfileId() { return *((uint16_t*)&(_cmdData[31+(getNiLength()-1)-CMD_DATA_OFFSET])); }
+TimeSeriesStore::getNode(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    int16_t found = findNode(address64Msb, address64Lsb);
+    if (found >= 0) return found;
+
+    // a free node, or else the one updated the least recently
+    uint16_t node;
+    if (_nodes < TIME_SERIES_NODES) node = _nodes++;
+    else {
+        node = 0;
+        for (uint16_t i = 1; i < TIME_SERIES_NODES; i++)
+            if ((int32_t)(_updatedAt[i] - _updatedAt[node]) < 0) node = i;
+        removeSlot(findSlot(_address64Msb[node], _address64Lsb[node]));
+    }
+
+    // the index is at most half full, a free slot is always found
+    uint16_t slot = getHomeSlot(address64Msb, address64Lsb);
+    while (_slots[slot] >= 0) slot = (slot+1) & (2*TIME_SERIES_NODES-1);
+    _slots[slot] = node;
+
+    _address64Msb[node] = address64Msb;
+    _address64Lsb[node] = address64Lsb;
+    _sampleHead[node] = 0;
+    _sampleCount[node] = 0;
+    for (uint8_t r = 0; r < TIME_SERIES_RESOLUTIONS; r++) {
+        _periodHead[node][r] = 0;
+        _periodCount[node][r] = 0;
+    }
+    return node;
+}
+
 uint16_t
-RxNodeId::getDigiManufacturerId() { return *((uint16_t*)&(_cmdData[33+(getNiLength()-1)-CMD_DATA_OFFSET])); }
+TimeSeriesStore::getHomeSlot(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    // the serial numbers of Digi modules differ mostly in the low word
+    uint32_t h = address64Lsb ^ address64Msb;
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return h & (2*TIME_SERIES_NODES-1);
+}
+
+int16_t
+TimeSeriesStore::findSlot(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    uint16_t i = getHomeSlot(address64Msb, address64Lsb);
+    for (uint16_t n = 0; n < 2*TIME_SERIES_NODES; n++) {
+        int16_t node = _slots[i];
+        if (node < 0) return -1;
+        if (_address64Msb[node] == address64Msb && _address64Lsb[node] == address64Lsb) return i;
+        i = (i+1) & (2*TIME_SERIES_NODES-1);
+    }
+    return -1;
+}
 
-uint32_t
-RxNodeId::getDigiDd() {
-    if (getCmdDataLength() >= (RX_NODE_ID_HEAD+getNiLength()+4))
-        return *((uint32_t*)&(_cmdData[35+(getNiLength()-1)-CMD_DATA_OFFSET]));
-    return 0;
+void
+TimeSeriesStore::removeSlot(const uint16_t& slot) {
+    // backward shift deletion, as in AddressCache::invalidate(...)
+    uint16_t hole = slot;
+    uint16_t j = slot;
+    for (uint16_t n = 1; n < 2*TIME_SERIES_NODES; n++) {
+        j = (j+1) & (2*TIME_SERIES_NODES-1);
+        if (_slots[j] < 0) break;
+
+        uint16_t home = getHomeSlot(_address64Msb[_slots[j]], _address64Lsb[_slots[j]]);
+        if (((j-home) & (2*TIME_SERIES_NODES-1)) >= ((j-hole) & (2*TIME_SERIES_NODES-1))) {
+            _slots[hole] = _slots[j];
+            hole = j;
+        }
+    }
+    _slots[hole] = -1;
 }
-uint8_t
-RxNodeId::getRssi() {
-    if (getCmdDataLength() >= (RX_NODE_ID_HEAD+getNiLength()+5))
-        return _cmdData[39+(getNiLength()-1)-CMD_DATA_OFFSET];
-    return 0;
+
+
+DuplicateFilter::DuplicateFilter() {
+    _sequenceOffset = 0;
+    _sequenceLength = 0;
+    clear();
 }
 
+void
+DuplicateFilter::setSequenceNumber(const uint8_t& offset, const uint8_t& length) {
+    _sequenceOffset = offset;
+    _sequenceLength = length;
+}
 
-uint16_t
-RemoteAtCommandResponse::getCmd() { return *((uint16_t*)&(_cmdData[15-CMD_DATA_OFFSET])); }
-uint8_t
-RemoteAtCommandResponse::getStatus() { return _cmdData[17-CMD_DATA_OFFSET]; }
-uint8_t*
-RemoteAtCommandResponse::getData() { return &(_cmdData[18-CMD_DATA_OFFSET]); }
-uint16_t
-RemoteAtCommandResponse::getDataLength() { return getCmdDataLength() - REMOTE_AT_COMMAND_RESPONSE_HEAD; }
+bool
+DuplicateFilter::isDuplicate(XBeeApiFrame& frame) {
+    // where the source address, the key and the payload start, and
+    // a byte within the key to leave out (the options)
+    uint8_t sourceLength, keyStart, dataStart;
+    uint8_t skip = 0xff;
+    switch (frame.getCmdId()) {
+    case RX_64_RESPONSE:
+    case RX_64_DATA_SAMPLE:
+        sourceLength = Rx64ResponseSchema::address64Lsb::end;
+        keyStart = dataStart = Rx64ResponseSchema::data::index;
+        break;
+    case RX_16_RESPONSE:
+    case RX_16_DATA_SAMPLE:
+        sourceLength = Rx16ResponseSchema::address16::end;
+        keyStart = dataStart = Rx16ResponseSchema::data::index;
+        break;
+    case RX_RESPONSE:
+    case RX_DATA_SAMPLE:
+        sourceLength = RxResponseSchema::address64Lsb::end;
+        keyStart = dataStart = RxResponseSchema::data::index;
+        break;
+    case EXPLICIT_RX_RESPONSE:
+        sourceLength = ExplicitRxResponseSchema::address64Lsb::end;
+        keyStart = ExplicitRxResponseSchema::sourceEndpoint::index;
+        dataStart = ExplicitRxResponseSchema::data::index;
+        skip = ExplicitRxResponseSchema::options::index;
+        break;
+    default: return false;
+    }
+
+    uint16_t length = frame.getCmdDataLength();
+    if (length < dataStart) return false;
+
+    uint16_t keyEnd = length;
+    if (_sequenceLength > 0) {
+        keyStart = dataStart + _sequenceOffset;
+        keyEnd = keyStart + _sequenceLength;
+        if (keyEnd > length) return false;
+    }
+
+    // FNV-1a
+    uint8_t* cmdData = frame.getCmdData();
+    uint32_t h = 2166136261UL;
+    for (uint8_t i = 0; i < sourceLength; i++) h = (h ^ cmdData[i]) * 16777619UL;
+    for (uint16_t i = keyStart; i < keyEnd; i++)
+        if (i != skip) h = (h ^ cmdData[i]) * 16777619UL;
+
+    uint32_t elapsed = millis() - _rotatedAt;
+    if (elapsed >= DUPLICATE_FILTER_WINDOW) {
+        // the previous window is forgotten, and after a gap of two
+        // windows or more the current one too
+        _current ^= 1;
+        for (uint16_t i = 0; i < DUPLICATE_FILTER_BITS/8; i++) _bits[_current][i] = 0;
+        if (elapsed >= 2*DUPLICATE_FILTER_WINDOW)
+            for (uint16_t i = 0; i < DUPLICATE_FILTER_BITS/8; i++) _bits[_current ^ 1][i] = 0;
+        // on whole windows, so a frame is remembered one to two of them
+        _rotatedAt += elapsed - elapsed % DUPLICATE_FILTER_WINDOW;
+    }
+
+    // double hashing: bit i is h + i*h2
+    uint32_t h2 = ((h >> 16) | (h << 16)) | 1;
+    bool inCurrent = true;
+    bool inPrevious = true;
+    for (uint8_t i = 0; i < DUPLICATE_FILTER_HASHES; i++) {
+        uint16_t bit = (h + i*h2) & (DUPLICATE_FILTER_BITS-1);
+        uint8_t mask = 1 << (bit & 7);
+        if (!(_bits[_current][bit >> 3] & mask)) inCurrent = false;
+        if (!(_bits[_current^1][bit >> 3] & mask)) inPrevious = false;
+    }
+    if (inCurrent || inPrevious) {
+        _dropped++;
+        return true;
+    }
+
+    // only the first copy is recorded, so that a payload repeated
+    // on purpose passes again once its window is over
+    for (uint8_t i = 0; i < DUPLICATE_FILTER_HASHES; i++) {
+        uint16_t bit = (h + i*h2) & (DUPLICATE_FILTER_BITS-1);
+        _bits[_current][bit >> 3] |= 1 << (bit & 7);
+    }
+    return false;
+}
+
+void
+DuplicateFilter::clear() {
+    for (uint16_t i = 0; i < DUPLICATE_FILTER_BITS/8; i++) {
+        _bits[0][i] = 0;
+        _bits[1][i] = 0;
+    }
+    _current = 0;
+    _rotatedAt = millis();
+    _dropped = 0;
+}
+
+uint32_t
+DuplicateFilter::getDropped() { return _dropped; }
 
 
 XBee::XBee(): _response(XBeeApiFrame()) {
@@ -2577,120 +2936,71 @@ XBee::XBee(): _response(XBeeApiFrame()) {
 
     _response.setCmdData(_responseCmdData);
 
+    for (uint8_t i = 0; i < MAX_PENDING_TX; i++) _pendingTxFrameId[i] = 0;
+    _pendingTxNext = 0;
+
+    _addressCache = nullptr;
+    _unreachableCache = nullptr;
+    _sourceRouteCache = nullptr;
+    _sourceRouteSent = false;
+    _duplicateFilter = nullptr;
+
+    for (uint8_t i = 0; i < MAX_AGGREGATOR_REWRITES; i++) _rewriteUsed[i] = false;
+    _rewriteNext = 0;
+    _aggregatorCallback = nullptr;
+
 #if defined(__AVR_ATmega32U4__) || defined(__MK20DX128__) || defined(__MK20DX256__)
     _serial = &Serial1;
 #else
     _serial = &Serial;
 #endif
+#ifdef XBEENG_POSIX
+    _waitable = nullptr;
+
+    // recursive: send(...) sends the source routes, and the aggregator
+    // callback may send
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&_routingMutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+#endif
 }
 
-void
-XBee::readPacket() {
-    // reset previous complete response
-    if (_response.isReady() || _response.hasErrors()) {
-        // discard previous packet and start over
-        resetStateVariables();
-
-        _response.setMsbLength(0);
-        _response.setLsbLength(0);
-        _response.setCmdId(0);
-        _response.setChecksum(0);
-
-        _response.setReady(false);
-        _response.setErrorCode(NO_ERROR);
-    }
-
-    while (available()) {
-        uint8_t c = read();
-        if (_pos > 0 && c == XB_START) {
-            _response.setErrorCode(UNEXPECTED_START);
-            return;
-        }
-        if (_pos > MAX_CMD_DATA_SIZE) {
-            _response.setErrorCode(PACKET_EXCEEDS_CMD_DATA_LENGTH);
-            return;
-        }
-        if (_pos > 0 && c == XB_ESCAPE) {
-            _escape = true;
-            continue;
-        }
-        if (_escape) {
-            c ^= 0x20;
-            _escape = false;
-        }
-
-        if (_pos >= 3) {
-            _checksumTotal += c;
-        }
-
-        switch (_pos) {
-            case 0: {
-                if (c == XB_START) {
-                    _pos++;
-                }
-            } break;
-            case 1: {
-                _response.setMsbLength(c);
-                _pos++;
-            } break;
-            case 2: {
-                _response.setLsbLength(c);
-                _pos++;
-            } break;
-            case 3: {
-                _response.setCmdId(c);
-                _pos++;
-            } break;
-            default: {
-                // check if we're at the end of the packet.
-                // Frame Data length does not include
-                // start, msb, lsb, and checksum bytes, so add 3
-                if (_pos == (_response.getFrameDataLength() + 3)) {
-                    // verify checksum
-                    if (_checksumTotal == 0xff) {
-                        _response.setChecksum(c);
-                        _response.setReady(true);
-
-                        _response.setErrorCode(NO_ERROR);
-                    } else {
-                        _response.setErrorCode(CHECKSUM_FAILURE);
-                    }
-
-                    // reset state vars
-                    _pos = 0;
-                    _checksumTotal = 0;
-                    return;
-                } else {
-                    _response.getCmdData()[_pos - CMD_DATA_OFFSET] = c;
-                    _pos++;
-                }
-            }
-        }
-    }
+XBee::~XBee() {
+    // the buffer of the response is not on the heap
+    _response.setCmdData(nullptr);
+#ifdef XBEENG_POSIX
+    pthread_mutex_destroy(&_routingMutex);
+#endif
 }
+
+void
+XBee::readPacket() { readFrom(*_serial); }
 bool
 XBee::readPacket(const uint32_t& timeout) {
-    uint32_t start = millis();
-
-    while ((millis() - start) < timeout) {
-        readPacket();
-
-        if (getApiFrame().isReady()) {
-            return true;
-        } else if (getApiFrame().hasErrors()) {
-            return false;
-        }
-    }
-
-    // timed out
-    return false;
+#ifdef XBEENG_POSIX
+    if (_waitable != nullptr) return readFrom(*_waitable, timeout);
+#endif
+    return readFrom(*_serial, timeout);
 }
 void
 XBee::readPacketUntilAvailable() {
-    while (!(getApiFrame().isReady() || getApiFrame().hasErrors())) {
-        readPacket();
+#ifdef XBEENG_POSIX
+    if (_waitable != nullptr) {
+        readFromUntilAvailable(*_waitable);
+        return;
     }
+#endif
+    readFromUntilAvailable(*_serial);
 }
+#ifdef XBEENG_POSIX
+bool
+XBee::readPacketBefore(const uint64_t& deadline) {
+    if (_waitable != nullptr) return readFromBefore(*_waitable, deadline);
+    return readFromBefore(*_serial, deadline);
+}
+#endif
 
 void
 XBee::getApiFrame(XBeeApiFrame &response) {
@@ -2705,53 +3015,373 @@ XBee::getApiFrame(XBeeApiFrame &response) {
 XBeeApiFrame&
 XBee::getApiFrame() { return _response; }
 
-void
-XBee::send(XBeeApiFrame &request) {
-    // start
-    sendByte(XB_START, false);
+bool
+XBee::send(XBeeApiFrame &request) { return sendTo(*_serial, request); }
+bool
+XBee::prepareSend(XBeeApiFrame& request, uint8_t* head,
+    bool& rewriteAddress, uint8_t& checksum, uint8_t* route, uint8_t& routeLength) {
+    uint8_t* cmdData = request.getCmdData();
+    checksum = request.getChecksum();
+    routeLength = 0;
+
+    lockRouting();
+
+    // destination as sent: the new aggregator in place of the old one,
+    // and the 16-bit address learned by the address cache, changed on
+    // the wire only (the request is left untouched)
+    rewriteAddress = false;
+    if (isUnicastRequest(request)) {
+        memcpy(head, cmdData, TXRX_FRAME_ID_HEAD);
+        uint32_t address64Msb = getField<TxRxFrameIdDescriptionSchema::address64Msb>(head);
+        uint32_t address64Lsb = getField<TxRxFrameIdDescriptionSchema::address64Lsb>(head);
+        uint16_t address16 = getField<TxRxFrameIdDescriptionSchema::address16>(head);
+
+        if (findAggregatorRewrite(address64Msb, address64Lsb)) {
+            setField<TxRxFrameIdDescriptionSchema::address64Msb>(head, address64Msb);
+            setField<TxRxFrameIdDescriptionSchema::address64Lsb>(head, address64Lsb);
+            address16 = BROADCAST_ADDRESS16;
+            rewriteAddress = true;
+        }
 
-    // length
-    sendByte(request.getMsbLength(), true);
-    sendByte(request.getLsbLength(), true);
+        if (_unreachableCache != nullptr &&
+            _unreachableCache->isUnreachable(address64Msb, address64Lsb)) {
+            unlockRouting();
+            return false;
+        }
 
-    // cmdID
-    sendByte(request.getCmdId(), true);
+        addPendingTx(getField<FrameIdDescriptionSchema::frameId>(cmdData), address64Msb, address64Lsb);
+
+        // the module keeps one source route, hand it the route to
+        // this destination unless it is the last one sent
+        uint16_t routeAddress16;
+        const uint16_t* routeAddresses;
+        uint8_t routeNAddresses;
+        if (_sourceRouteCache != nullptr &&
+            _sourceRouteCache->lookup(address64Msb, address64Lsb,
+                routeAddress16, routeAddresses, routeNAddresses) &&
+            !(_sourceRouteSent && _sourceRouteAddress64Msb == address64Msb &&
+                _sourceRouteAddress64Lsb == address64Lsb)) {
+            // copied, the cache may change once unlocked
+            CreateSourceRoute routeRequest(0, address64Msb, address64Lsb,
+                routeAddress16, routeAddresses, routeNAddresses);
+            routeLength = routeRequest.getCmdDataLength();
+            memcpy(route, routeRequest.getCmdData(), routeLength);
+
+            _sourceRouteSent = true;
+            _sourceRouteAddress64Msb = address64Msb;
+            _sourceRouteAddress64Lsb = address64Lsb;
+        }
 
-    // cmdData
-    uint16_t length = request.getCmdDataLength();
-    uint8_t* cmdData = request.getCmdData();
-    for (uint16_t i = 0; i < length; i++) {
-        sendByte(cmdData[i], true);
-    }
+        if (_addressCache != nullptr && address16 == BROADCAST_ADDRESS16 &&
+            _addressCache->lookup(address64Msb, address64Lsb, address16))
+            rewriteAddress = true;
 
-    // checksum
-    sendByte(request.getChecksum(), true);
+        if (rewriteAddress) {
+            setField<TxRxFrameIdDescriptionSchema::address16>(head, address16);
+            for (uint8_t i = 0; i < TXRX_FRAME_ID_HEAD; i++) checksum += cmdData[i] - head[i];
+        }
+    }
 
-    // send packet
-    flush();
+    unlockRouting();
+    return true;
 }
 
-void
-XBee::begin(Stream &serial) { _serial = &serial; }
-void
-XBee::setSerial(Stream &serial) { _serial = &serial; }
-bool
-XBee::available() { return _serial->available(); }
 uint8_t
-XBee::read() { return _serial->read(); }
+XBee::gatherRemoteAtCommand(const uint8_t& frameId, const char (&cmd)[3],
+    const uint8_t* param, const uint16_t& paramLength,
+    RemoteAtGatherEntry* table, const uint8_t& tableSize,
+    const uint32_t& quiet, const uint32_t& deadline) {
+    RemoteAtCommand request(frameId, 0, BROADCAST_ADDRESS64, BROADCAST_ADDRESS16,
+        0, cmd, param, paramLength);
+    send(request);
+
+    uint8_t nEntries = 0;
+    uint32_t start = millis();
+    uint32_t last = start;
+
+    while (nEntries < tableSize) {
+        uint32_t now = millis();
+        if ((now - start) >= deadline || (now - last) >= quiet) break;
+
+        // wait for the next answer, until the quiet time or deadline
+        uint32_t wait = deadline - (now - start);
+        if (quiet - (now - last) < wait) wait = quiet - (now - last);
+        if (!readPacket(wait) || _response.getCmdId() != REMOTE_AT_COMMAND_RESPONSE)
+            continue;
+
+        RemoteAtCommandResponse* pt = static_cast<RemoteAtCommandResponse*>(&_response);
+        if (pt->getFrameId() != frameId) continue;
+        last = millis();
+
+        uint32_t address64Msb = pt->getAddress64Msb();
+        uint32_t address64Lsb = pt->getAddress64Lsb();
+
+        uint8_t i = 0;
+        for (; i < nEntries; i++) {
+            if (table[i].address64Msb == address64Msb &&
+                table[i].address64Lsb == address64Lsb) break;
+        }
+        if (i == nEntries) nEntries++;
+
+        RemoteAtGatherEntry& entry = table[i];
+        entry.address64Msb = address64Msb;
+        entry.address64Lsb = address64Lsb;
+        entry.address16 = pt->getAddress16();
+        entry.status = pt->getStatus();
+
+        uint16_t dataLength = pt->getDataLength();
+        if (dataLength > MAX_GATHER_DATA_SIZE) dataLength = MAX_GATHER_DATA_SIZE;
+        uint8_t* data = pt->getData();
+        for (uint16_t j = 0; j < dataLength; j++) entry.data[j] = data[j];
+        entry.dataLength = dataLength;
+    }
+
+    return nEntries;
+}
+uint8_t
+XBee::gatherRemoteAtCommand(const uint8_t& frameId, const char (&cmd)[3],
+    RemoteAtGatherEntry* table, const uint8_t& tableSize,
+    const uint32_t& quiet, const uint32_t& deadline) {
+    return gatherRemoteAtCommand(frameId, cmd, nullptr, 0,
+        table, tableSize, quiet, deadline);
+}
+
+void
+XBee::begin(Stream &serial) { setSerial(serial); }
+void
+XBee::setSerial(Stream &serial) {
+    _serial = &serial;
+#ifdef XBEENG_POSIX
+    _waitable = nullptr;
+#endif
+}
+#ifdef XBEENG_POSIX
+void
+XBee::begin(WaitableStream &serial) { setSerial(serial); }
+void
+XBee::setSerial(WaitableStream &serial) {
+    _serial = &serial;
+    _waitable = &serial;
+}
+#endif
+void
+XBee::setAddressCache(AddressCache& addressCache) { _addressCache = &addressCache; }
+void
+XBee::setUnreachableCache(UnreachableCache& unreachableCache) {
+    _unreachableCache = &unreachableCache;
+}
+void
+XBee::setSourceRouteCache(SourceRouteCache& sourceRouteCache) {
+    _sourceRouteCache = &sourceRouteCache;
+    _sourceRouteSent = false;
+}
+void
+XBee::setAggregatorCallback(AggregatorCallback aggregatorCallback) {
+    _aggregatorCallback = aggregatorCallback;
+}
+void
+XBee::setDuplicateFilter(DuplicateFilter& duplicateFilter) {
+    _duplicateFilter = &duplicateFilter;
+}
+uint8_t
+XBee::getReachability(const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    uint8_t reachability = REACHABILITY_UNKNOWN;
+    uint16_t address16;
+
+    lockRouting();
+    if (_unreachableCache != nullptr &&
+        _unreachableCache->isUnreachable(address64Msb, address64Lsb)) reachability = REACHABILITY_UNREACHABLE;
+    else if (_addressCache != nullptr &&
+        _addressCache->lookup(address64Msb, address64Lsb, address16)) reachability = REACHABILITY_KNOWN;
+    unlockRouting();
+
+    return reachability;
+}
 void
-XBee::flush() { _serial->flush(); }
+XBee::processApiFrame() {
+    lockRouting();
+
+    switch (_response.getCmdId()) {
+    case RX_RESPONSE:
+    case EXPLICIT_RX_RESPONSE:
+    case RX_DATA_SAMPLE:
+    case RX_SENSOR_READ:
+    case RX_NODE_ID:
+    case RX_ROUTE_RECORD:
+    case RX_DEVICE_AUTHENTICATED: {
+        if (!_response.has<TxRxXBeeApiFrameSchema::address16>()) break;
+        uint32_t address64Msb = _response.get<TxRxXBeeApiFrameSchema::address64Msb>();
+        uint32_t address64Lsb = _response.get<TxRxXBeeApiFrameSchema::address64Lsb>();
+        uint16_t address16 = _response.get<TxRxXBeeApiFrameSchema::address16>();
+
+        if (_addressCache != nullptr)
+            _addressCache->learn(address64Msb, address64Lsb, address16);
+        if (_unreachableCache != nullptr)
+            _unreachableCache->markReachable(address64Msb, address64Lsb);
+
+        if (_response.getCmdId() != RX_ROUTE_RECORD || _sourceRouteCache == nullptr ||
+            !_response.has<RxRouteRecordSchema::addresses>()) break;
+
+        RxRouteRecord* pt = static_cast<RxRouteRecord*>(&_response);
+        uint8_t nAddresses = pt->getNAddresses();
+        if (RX_ROUTE_RECORD_HEAD+2*nAddresses > _response.getCmdDataLength()) break;
+
+        uint16_t addresses[MAX_SOURCE_ROUTE_HOPS];
+        for (uint8_t i = 0; i < nAddresses && i < MAX_SOURCE_ROUTE_HOPS; i++)
+            addresses[i] = pt->getAddress(i);
+        _sourceRouteCache->learn(address64Msb, address64Lsb, address16, addresses, nAddresses);
+
+        // the route handed to the module may be outdated now
+        if (_sourceRouteSent && _sourceRouteAddress64Msb == address64Msb &&
+            _sourceRouteAddress64Lsb == address64Lsb) _sourceRouteSent = false;
+    } break;
+    case AGGREGATE_ADDRESSING: {
+        if (!_response.has<AggregateAddressingSchema::oldAddress64Lsb>()) break;
+        rewriteAggregator(
+            _response.get<AggregateAddressingSchema::oldAddress64Msb>(),
+            _response.get<AggregateAddressingSchema::oldAddress64Lsb>(),
+            _response.get<AggregateAddressingSchema::newAddress64Msb>(),
+            _response.get<AggregateAddressingSchema::newAddress64Lsb>());
+    } break;
+    case RX_MTO_ROUTE_REQUEST: {
+        // another concentrator is building routes, the module may
+        // have dropped the last source route
+        _sourceRouteSent = false;
+    } break;
+    case REMOTE_AT_COMMAND_RESPONSE: {
+        if (!_response.has<RemoteAtCommandResponseSchema::status>()) break;
+        RemoteAtCommandResponse* pt = static_cast<RemoteAtCommandResponse*>(&_response);
+        uint32_t address64Msb = pt->getAddress64Msb();
+        uint32_t address64Lsb = pt->getAddress64Lsb();
+
+        uint32_t pendingAddress64Msb, pendingAddress64Lsb;
+        takePendingTx(pt->getFrameId(), pendingAddress64Msb, pendingAddress64Lsb);
+
+        if (pt->getStatus() == AT_NO_RESPONSE) {
+            if (_addressCache != nullptr)
+                _addressCache->invalidate(address64Msb, address64Lsb);
+        } else {
+            if (_addressCache != nullptr)
+                _addressCache->learn(address64Msb, address64Lsb, pt->getAddress16());
+            if (_unreachableCache != nullptr)
+                _unreachableCache->markReachable(address64Msb, address64Lsb);
+        }
+    } break;
+    case TX_STATUS: {
+        if (!_response.has<TxStatusSchema::discoveryStatus>()) break;
+        TxStatus* pt = static_cast<TxStatus*>(&_response);
+        uint32_t address64Msb, address64Lsb;
+        if (!takePendingTx(pt->getFrameId(), address64Msb, address64Lsb)) break;
+
+        uint8_t deliveryStatus = pt->getDeliveryStatus();
+        if (deliveryStatus == SUCCESS || deliveryStatus == INVALID_DESTINATION_ENDPOINT_SUCCESS) {
+            if (_addressCache != nullptr)
+                _addressCache->learn(address64Msb, address64Lsb, pt->getAddress16());
+            if (_unreachableCache != nullptr)
+                _unreachableCache->markReachable(address64Msb, address64Lsb);
+        } else {
+            if (_addressCache != nullptr)
+                _addressCache->invalidate(address64Msb, address64Lsb);
+            if (_sourceRouteCache != nullptr)
+                _sourceRouteCache->invalidate(address64Msb, address64Lsb);
+            if (_unreachableCache != nullptr &&
+                (deliveryStatus == ADDRESS_NOT_FOUND || deliveryStatus == ROUTE_NOT_FOUND))
+                _unreachableCache->markUnreachable(address64Msb, address64Lsb);
+        }
+    } break;
+    }
+
+    unlockRouting();
+}
+
 void
-XBee::write(const uint8_t& val) { _serial->write(val); }
+XBee::addPendingTx(const uint8_t& frameId,
+    const uint32_t& address64Msb, const uint32_t& address64Lsb) {
+    if (frameId == 0) return; // frame id 0: no status will come
+
+    _pendingTxFrameId[_pendingTxNext] = frameId;
+    _pendingTxAddress64Msb[_pendingTxNext] = address64Msb;
+    _pendingTxAddress64Lsb[_pendingTxNext] = address64Lsb;
+    _pendingTxNext = (_pendingTxNext+1) % MAX_PENDING_TX;
+}
+bool
+XBee::takePendingTx(const uint8_t& frameId,
+    uint32_t& address64Msb, uint32_t& address64Lsb) {
+    if (frameId == 0) return false;
+
+    // oldest first, frame ids are often reused
+    for (uint8_t n = 0; n < MAX_PENDING_TX; n++) {
+        uint8_t i = (_pendingTxNext+n) % MAX_PENDING_TX;
+        if (_pendingTxFrameId[i] != frameId) continue;
+
+        address64Msb = _pendingTxAddress64Msb[i];
+        address64Lsb = _pendingTxAddress64Lsb[i];
+        _pendingTxFrameId[i] = 0;
+        return true;
+    }
+    return false;
+}
 
 void
-XBee::sendByte(const uint8_t& b, const bool& escape) {
-    if (escape && (b == XB_START || b == XB_ESCAPE || b == XB_ON || b == XB_OFF)) {
-        write(XB_ESCAPE);
-        write(b ^ 0x20);
-    } else {
-        write(b);
+XBee::rewriteAggregator(const uint32_t& oldAddress64Msb, const uint32_t& oldAddress64Lsb,
+    const uint32_t& newAddress64Msb, const uint32_t& newAddress64Lsb) {
+    if (oldAddress64Msb == newAddress64Msb && oldAddress64Lsb == newAddress64Lsb) return;
+
+    // earlier changes now lead to the new address, and a change back
+    // to an old address ends its rewrite
+    for (uint8_t i = 0; i < MAX_AGGREGATOR_REWRITES; i++) {
+        if (!_rewriteUsed[i]) continue;
+        if (_rewriteNewAddress64Msb[i] == oldAddress64Msb && _rewriteNewAddress64Lsb[i] == oldAddress64Lsb) {
+            _rewriteNewAddress64Msb[i] = newAddress64Msb;
+            _rewriteNewAddress64Lsb[i] = newAddress64Lsb;
+        }
+        if (_rewriteOldAddress64Msb[i] == newAddress64Msb && _rewriteOldAddress64Lsb[i] == newAddress64Lsb)
+            _rewriteUsed[i] = false;
     }
+    // no aggregator before
+    if (oldAddress64Msb == 0 && oldAddress64Lsb == 0) return;
+
+    _rewriteUsed[_rewriteNext] = true;
+    _rewriteOldAddress64Msb[_rewriteNext] = oldAddress64Msb;
+    _rewriteOldAddress64Lsb[_rewriteNext] = oldAddress64Lsb;
+    _rewriteNewAddress64Msb[_rewriteNext] = newAddress64Msb;
+    _rewriteNewAddress64Lsb[_rewriteNext] = newAddress64Lsb;
+    _rewriteNext = (_rewriteNext+1) % MAX_AGGREGATOR_REWRITES;
+
+    // the statuses still to come are for the new address
+    for (uint8_t i = 0; i < MAX_PENDING_TX; i++) {
+        if (_pendingTxFrameId[i] == 0 ||
+            _pendingTxAddress64Msb[i] != oldAddress64Msb || _pendingTxAddress64Lsb[i] != oldAddress64Lsb) continue;
+        _pendingTxAddress64Msb[i] = newAddress64Msb;
+        _pendingTxAddress64Lsb[i] = newAddress64Lsb;
+    }
+
+    // nothing learned about the old address holds for the new one
+    if (_addressCache != nullptr)
+        _addressCache->invalidate(oldAddress64Msb, oldAddress64Lsb);
+    if (_sourceRouteCache != nullptr)
+        _sourceRouteCache->invalidate(oldAddress64Msb, oldAddress64Lsb);
+    if (_sourceRouteSent && _sourceRouteAddress64Msb == oldAddress64Msb &&
+        _sourceRouteAddress64Lsb == oldAddress64Lsb) _sourceRouteSent = false;
+    if (_unreachableCache != nullptr) {
+        _unreachableCache->markReachable(oldAddress64Msb, oldAddress64Lsb);
+        _unreachableCache->markReachable(newAddress64Msb, newAddress64Lsb);
+    }
+
+    if (_aggregatorCallback != nullptr)
+        _aggregatorCallback(oldAddress64Msb, oldAddress64Lsb, newAddress64Msb, newAddress64Lsb);
+}
+bool
+XBee::findAggregatorRewrite(uint32_t& address64Msb, uint32_t& address64Lsb) {
+    for (uint8_t i = 0; i < MAX_AGGREGATOR_REWRITES; i++) {
+        if (!_rewriteUsed[i] ||
+            _rewriteOldAddress64Msb[i] != address64Msb || _rewriteOldAddress64Lsb[i] != address64Lsb) continue;
+
+        address64Msb = _rewriteNewAddress64Msb[i];
+        address64Lsb = _rewriteNewAddress64Lsb[i];
+        return true;
+    }
+    return false;
 }
 
 void
@@ -2760,3 +3390,2020 @@ XBee::resetStateVariables() {
     _escape = false;
     _checksumTotal = 0;
 }
+
+
+OtaUpdater::OtaUpdater(XBee& xbee) {
+    _xbee = &xbee;
+
+    for (uint8_t i = 0; i < OTA_MAX_SESSIONS; i++) _sessions[i].state = OTA_IDLE;
+    _nextSession = 0;
+
+    setMaxPayload(84);
+    setAirtimeBudget(0);
+}
+
+void
+OtaUpdater::setMaxPayload(const uint8_t& np) {
+    // one byte of every block carries its number
+    _blockSize = np - 1;
+    if (_blockSize > MAX_CMD_DATA_SIZE-EXPLICIT_TX_REQUEST_HEAD-1)
+        _blockSize = MAX_CMD_DATA_SIZE-EXPLICIT_TX_REQUEST_HEAD-1;
+}
+
+void
+OtaUpdater::setAirtimeBudget(const uint32_t& bytesPerSecond) {
+    _budget = bytesPerSecond;
+    _tokens = bytesPerSecond;
+    _tokensAt = millis();
+}
+
+int8_t
+OtaUpdater::start(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+    const uint8_t* image, const uint32_t& imageLength) {
+    if (_blockSize == 0) return -1;
+
+    for (uint8_t i = 0; i < OTA_MAX_SESSIONS; i++) {
+        OtaSession& session = _sessions[i];
+        if (session.state != OTA_IDLE) continue;
+
+        session.address64Msb = address64Msb;
+        session.address64Lsb = address64Lsb;
+        session.image = image;
+        session.imageLength = imageLength;
+        session.blockSize = _blockSize;
+        session.nBlocks = (imageLength + _blockSize - 1) / _blockSize;
+        session.base = 0;
+        session.next = 0;
+        session.acked = 0;
+        session.retries = 0;
+        session.state = (session.nBlocks > 0) ? OTA_RUNNING : OTA_DONE;
+        return i;
+    }
+    return -1;
+}
+
+void
+OtaUpdater::abort(const uint8_t& session) {
+    if (session < OTA_MAX_SESSIONS) _sessions[session].state = OTA_IDLE;
+}
+
+void
+OtaUpdater::poll() {
+    // round robin: every call starts with the next session
+    uint8_t first = _nextSession;
+    _nextSession = (_nextSession+1) % OTA_MAX_SESSIONS;
+
+    for (uint8_t n = 0; n < OTA_MAX_SESSIONS; n++) {
+        OtaSession& session = _sessions[(first+n) % OTA_MAX_SESSIONS];
+        if (session.state != OTA_RUNNING) continue;
+
+        // retransmissions due
+        for (uint32_t block = session.base; block < session.next; block++) {
+            uint8_t slot = block % OTA_WINDOW_SIZE;
+            if ((session.acked >> slot) & 1) continue;
+            if ((millis() - session.sentAt[slot]) < OTA_BLOCK_TIMEOUT) continue;
+
+            if (session.tries[slot] > OTA_MAX_RETRIES) {
+                session.state = OTA_FAILED;
+                break;
+            }
+            if (!takeBudget(session.blockSize+1)) return;
+
+            session.retries++;
+            if (!sendBlock(session, block)) break;
+        }
+        if (session.state != OTA_RUNNING) continue;
+
+        // new blocks, while the window has room
+        while (session.next < session.nBlocks && (session.next - session.base) < OTA_WINDOW_SIZE) {
+            if (!takeBudget(session.blockSize+1)) return;
+
+            uint8_t slot = session.next % OTA_WINDOW_SIZE;
+            session.acked &= ~(1 << slot);
+            session.tries[slot] = 0;
+            bool sent = sendBlock(session, session.next);
+            session.next++;
+            if (!sent) break;
+        }
+    }
+}
+
+bool
+OtaUpdater::process(XBeeApiFrame& frame) {
+    if (frame.getCmdId() != OTA_FIRMWARE_UPDATE_STATUS ||
+        !frame.has<OtaFirmwareUpdateStatusSchema::targetAddress64Lsb>()) return false;
+
+    uint32_t address64Msb = frame.get<OtaFirmwareUpdateStatusSchema::targetAddress64Msb>();
+    uint32_t address64Lsb = frame.get<OtaFirmwareUpdateStatusSchema::targetAddress64Lsb>();
+    uint8_t messageType = frame.get<OtaFirmwareUpdateStatusSchema::messageType>();
+    uint8_t blockNumber = frame.get<OtaFirmwareUpdateStatusSchema::blockNumber>();
+
+    for (uint8_t i = 0; i < OTA_MAX_SESSIONS; i++) {
+        OtaSession& session = _sessions[i];
+        if (session.state != OTA_RUNNING ||
+            session.address64Msb != address64Msb || session.address64Lsb != address64Lsb) continue;
+
+        // block numbers go modulo 256, find it in the window
+        uint8_t offset = blockNumber - (uint8_t)(session.base & 0xff);
+        if (offset >= (session.next - session.base)) return true;
+
+        uint32_t block = session.base + offset;
+        uint8_t slot = block % OTA_WINDOW_SIZE;
+
+        if (messageType == OTA_ACK) {
+            session.acked |= (1 << slot);
+            // slide the window over the acknowledged blocks
+            while (session.base < session.next && ((session.acked >> (session.base % OTA_WINDOW_SIZE)) & 1)) {
+                session.acked &= ~(1 << (session.base % OTA_WINDOW_SIZE));
+                session.base++;
+            }
+            if (session.base == session.nBlocks) session.state = OTA_DONE;
+        } else if (messageType == OTA_NACK || messageType == OTA_NO_MAC_ACK) {
+            // due now
+            session.sentAt[slot] = millis() - OTA_BLOCK_TIMEOUT;
+        }
+        return true;
+    }
+    return false;
+}
+
+uint8_t
+OtaUpdater::getState(const uint8_t& session) {
+    if (session >= OTA_MAX_SESSIONS) return OTA_IDLE;
+    return _sessions[session].state;
+}
+uint32_t
+OtaUpdater::getBlocksAcked(const uint8_t& session) {
+    if (session >= OTA_MAX_SESSIONS) return 0;
+    return _sessions[session].base;
+}
+uint32_t
+OtaUpdater::getBlocksTotal(const uint8_t& session) {
+    if (session >= OTA_MAX_SESSIONS) return 0;
+    return _sessions[session].nBlocks;
+}
+uint32_t
+OtaUpdater::getRetries(const uint8_t& session) {
+    if (session >= OTA_MAX_SESSIONS) return 0;
+    return _sessions[session].retries;
+}
+
+bool
+OtaUpdater::sendBlock(OtaSession& session, const uint32_t& block) {
+    uint32_t offset = block * session.blockSize;
+    uint16_t length = session.blockSize;
+    if (offset + length > session.imageLength) length = session.imageLength - offset;
+
+    uint8_t data[MAX_CMD_DATA_SIZE-EXPLICIT_TX_REQUEST_HEAD];
+    data[0] = block & 0xff;
+    for (uint16_t i = 0; i < length; i++) data[1+i] = session.image[offset+i];
+
+    ExplicitTxRequest request(0, session.address64Msb, session.address64Lsb,
+        OTA_ENDPOINT, OTA_ENDPOINT, OTA_CLUSTER_ID, OTA_PROFILE_ID, data, length+1);
+
+    // a refused block (destination held down) counts as a try lost on
+    // the air: it is retried after OTA_BLOCK_TIMEOUT, and the session
+    // fails after OTA_MAX_RETRIES like on any other loss
+    uint8_t slot = block % OTA_WINDOW_SIZE;
+    session.sentAt[slot] = millis();
+    session.tries[slot]++;
+    return _xbee->send(request);
+}
+
+bool
+OtaUpdater::takeBudget(const uint16_t& bytes) {
+    if (_budget == 0) return true;
+
+    // token bucket, refilled at _budget bytes per second with a
+    // burst of one second at most
+    uint32_t elapsed = millis() - _tokensAt;
+    if (elapsed >= 1000) {
+        _tokens = _budget;
+        _tokensAt += elapsed;
+    } else {
+        uint32_t gained = elapsed * _budget / 1000;
+        if (gained > 0) {
+            _tokens += gained;
+            _tokensAt += gained * 1000 / _budget;
+        }
+        if (_tokens > _budget) _tokens = _budget;
+    }
+
+    if (_tokens < bytes) return false;
+    _tokens -= bytes;
+    return true;
+}
+
+
+JoinProvisioner::JoinProvisioner(XBee& xbee) {
+    _xbee = &xbee;
+    _list = nullptr;
+    _lastFrameId = 0;
+}
+
+void
+JoinProvisioner::begin(Stream& list, const uint8_t& options) {
+    _list = &list;
+    _options = options;
+    _listDone = false;
+
+    _deviceReady = false;
+    _field = 0;
+    _nibbles = 0;
+    _malformed = false;
+
+    for (uint8_t i = 0; i < PROVISION_MAX_IN_FLIGHT; i++) _frameId[i] = 0;
+    for (uint8_t i = 0; i < PROVISION_MAX_AWAITING; i++) _awaiting[i] = false;
+    _awaitingNext = 0;
+
+    _sent = 0;
+    _registered = 0;
+    _failed = 0;
+    _joined = 0;
+    _startedAt = millis();
+    _elapsed = 0;
+    _finished = false;
+}
+
+void
+JoinProvisioner::poll() {
+    if (_list == nullptr) return;
+
+    for (uint8_t i = 0; i < PROVISION_MAX_IN_FLIGHT; i++) {
+        if (_frameId[i] == 0) continue;
+        if ((millis() - _sentAt[i]) < PROVISION_TIMEOUT) continue;
+
+        _frameId[i] = 0;
+        _failed++;
+    }
+
+    for (uint8_t i = 0; i < PROVISION_MAX_IN_FLIGHT; i++) {
+        if (_frameId[i] != 0) continue;
+        if (!readDevice()) break;
+
+        uint8_t frameId = nextFrameId();
+        RegisterJoiningDevice request(frameId, _address64Msb, _address64Lsb,
+            BROADCAST_ADDRESS16, _options, _key, _keyLength);
+        _xbee->send(request);
+
+        _frameId[i] = frameId;
+        _inFlightAddress64Msb[i] = _address64Msb;
+        _inFlightAddress64Lsb[i] = _address64Lsb;
+        _sentAt[i] = millis();
+        _sent++;
+        _deviceReady = false;
+    }
+
+    updateElapsed();
+}
+
+bool
+JoinProvisioner::process(XBeeApiFrame& frame) {
+    if (_list == nullptr) return false;
+
+    if (frame.getCmdId() == REGISTER_JOINING_DEVICE_STATUS &&
+        frame.has<RegisterJoiningDeviceStatusSchema::status>()) {
+        uint8_t frameId = frame.get<RegisterJoiningDeviceStatusSchema::frameId>();
+        if (frameId == 0) return false;
+
+        for (uint8_t i = 0; i < PROVISION_MAX_IN_FLIGHT; i++) {
+            if (_frameId[i] != frameId) continue;
+            _frameId[i] = 0;
+
+            if (frame.get<RegisterJoiningDeviceStatusSchema::status>() == REGISTER_SUCCESS) {
+                _registered++;
+                _awaitingAddress64Msb[_awaitingNext] = _inFlightAddress64Msb[i];
+                _awaitingAddress64Lsb[_awaitingNext] = _inFlightAddress64Lsb[i];
+                _awaiting[_awaitingNext] = true;
+                _awaitingNext = (_awaitingNext+1) % PROVISION_MAX_AWAITING;
+            } else _failed++;
+
+            updateElapsed();
+            return true;
+        }
+    } else if (frame.getCmdId() == RX_DEVICE_AUTHENTICATED &&
+        frame.has<RxDeviceAuthenticatedSchema::status>()) {
+        if (frame.get<RxDeviceAuthenticatedSchema::status>() != 0) return false;
+        uint32_t address64Msb = frame.get<RxDeviceAuthenticatedSchema::address64Msb>();
+        uint32_t address64Lsb = frame.get<RxDeviceAuthenticatedSchema::address64Lsb>();
+
+        for (uint8_t i = 0; i < PROVISION_MAX_AWAITING; i++) {
+            if (!_awaiting[i] || _awaitingAddress64Msb[i] != address64Msb ||
+                _awaitingAddress64Lsb[i] != address64Lsb) continue;
+            _awaiting[i] = false;
+            _joined++;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+JoinProvisioner::isDone() {
+    if (_list == nullptr || !_listDone || _deviceReady) return false;
+    for (uint8_t i = 0; i < PROVISION_MAX_IN_FLIGHT; i++)
+        if (_frameId[i] != 0) return false;
+    return true;
+}
+
+uint16_t
+JoinProvisioner::getSent() { return _sent; }
+uint16_t
+JoinProvisioner::getRegistered() { return _registered; }
+uint16_t
+JoinProvisioner::getFailed() { return _failed; }
+uint16_t
+JoinProvisioner::getJoined() { return _joined; }
+uint32_t
+JoinProvisioner::getElapsed() {
+    if (_finished) return _elapsed;
+    return millis() - _startedAt;
+}
+
+void
+JoinProvisioner::updateElapsed() {
+    if (_finished || !isDone()) return;
+    _finished = true;
+    _elapsed = millis() - _startedAt;
+}
+
+bool
+JoinProvisioner::readDevice() {
+    while (!_deviceReady && !_listDone) {
+        // a Stream with nothing left to read ends the list
+        int c = (_list->available() > 0) ? _list->read() : -1;
+        if (c == '\r') continue;
+
+        if (c == -1 || c == '\n') {
+            // a key of odd nibbles, or none after the separator
+            if (_field == 1 && (_nibbles == 0 || (_nibbles & 1))) _malformed = true;
+            if (_field == 1 || _field == 3) {
+                if (_malformed) _failed++;
+                else _deviceReady = true;
+            } else if (_field == 0 && (_nibbles > 0 || _malformed)) _failed++;
+
+            _field = 0;
+            _nibbles = 0;
+            _malformed = false;
+            if (c == -1) _listDone = true;
+            continue;
+        }
+        if (_field == 2) continue;
+
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else {
+            if (c == ' ' || c == '\t' || c == ',') {
+                if (_field == 0 && _nibbles > 0) {
+                    if (_nibbles != 16) _malformed = true;
+                    _field = 1;
+                    _nibbles = 0;
+                } else if (_field == 1 && _nibbles > 0) {
+                    if (_nibbles & 1) _malformed = true;
+                    _field = 3;
+                }
+            } else if (c == '#' && _field == 0 && _nibbles == 0) _field = 2;
+            else _malformed = true;
+            continue;
+        }
+
+        if (_field == 0) {
+            if (_nibbles == 0) {
+                _address64Msb = 0;
+                _address64Lsb = 0;
+                _keyLength = 0;
+            }
+            if (_nibbles >= 16) {
+                _malformed = true;
+                continue;
+            }
+            if (_nibbles < 8) _address64Msb = (_address64Msb << 4) | nibble;
+            else _address64Lsb = (_address64Lsb << 4) | nibble;
+            _nibbles++;
+        } else if (_field == 1) {
+            if (_nibbles >= 2*PROVISION_MAX_KEY_LENGTH) {
+                _malformed = true;
+                continue;
+            }
+            if (_nibbles & 1) _key[_nibbles/2] = (_key[_nibbles/2] << 4) | nibble;
+            else _key[_nibbles/2] = nibble;
+            _nibbles++;
+            _keyLength = (_nibbles+1)/2;
+        } else _malformed = true;
+    }
+    return _deviceReady;
+}
+
+uint8_t
+JoinProvisioner::nextFrameId() {
+    // skip 0 (no status), those of the XBeeExchanges and the frame
+    // ids still in flight
+    bool inFlight;
+    do {
+        _lastFrameId++;
+        if (_lastFrameId == 0 || _lastFrameId >= EXCHANGE_FIRST_FRAME_ID) _lastFrameId = 1;
+
+        inFlight = false;
+        for (uint8_t i = 0; i < PROVISION_MAX_IN_FLIGHT; i++)
+            if (_frameId[i] == _lastFrameId) inFlight = true;
+    } while (inFlight);
+    return _lastFrameId;
+}
+
+
+LinkStatistics::LinkStatistics() { clear(); }
+
+bool
+LinkStatistics::process(XBeeApiFrame& frame) {
+    if (frame.getCmdId() != ROUTE_INFORMATION ||
+        !frame.has<RouteInformationSchema::receiverAddress64Lsb>()) return false;
+
+    typedef RouteInformationSchema Schema;
+    uint32_t timestamp = frame.get<Schema::timestamp>();
+    uint8_t ackTimeouts = frame.get<Schema::ackTimeoutCount>();
+    uint32_t destinationAddress64Msb = frame.get<Schema::destinationAddress64Msb>();
+    uint32_t destinationAddress64Lsb = frame.get<Schema::destinationAddress64Lsb>();
+    uint32_t sourceAddress64Msb = frame.get<Schema::sourceAddress64Msb>();
+    uint32_t sourceAddress64Lsb = frame.get<Schema::sourceAddress64Lsb>();
+    uint32_t responderAddress64Msb = frame.get<Schema::responderAddress64Msb>();
+    uint32_t responderAddress64Lsb = frame.get<Schema::responderAddress64Lsb>();
+    uint32_t receiverAddress64Msb = frame.get<Schema::receiverAddress64Msb>();
+    uint32_t receiverAddress64Lsb = frame.get<Schema::receiverAddress64Lsb>();
+
+    // the link, added if new
+    uint8_t home = getHomeSlot(responderAddress64Msb, responderAddress64Lsb,
+        receiverAddress64Msb, receiverAddress64Lsb, LINK_STATISTICS_LINKS);
+    uint8_t link = home;
+    uint8_t n = 0;
+    for (; n < LINK_STATISTICS_LINKS; n++) {
+        if (_reports[link] == 0) {
+            _size++;
+            break;
+        }
+        if (_responderAddress64Msb[link] == responderAddress64Msb &&
+            _responderAddress64Lsb[link] == responderAddress64Lsb &&
+            _receiverAddress64Msb[link] == receiverAddress64Msb &&
+            _receiverAddress64Lsb[link] == receiverAddress64Lsb) break;
+        link = (link+1) & (LINK_STATISTICS_LINKS-1);
+    }
+    if (n == LINK_STATISTICS_LINKS || _reports[link] == 0) {
+        // table full: the link at the home slot is replaced
+        if (n == LINK_STATISTICS_LINKS) link = home;
+        _responderAddress64Msb[link] = responderAddress64Msb;
+        _responderAddress64Lsb[link] = responderAddress64Lsb;
+        _receiverAddress64Msb[link] = receiverAddress64Msb;
+        _receiverAddress64Lsb[link] = receiverAddress64Lsb;
+        _reports[link] = 0;
+        _ackTimeouts[link] = 0;
+        _latencySamples[link] = 0;
+    }
+    if (_reports[link] != 0xffff) _reports[link]++;
+    if (_ackTimeouts[link] <= 0xffff - ackTimeouts) _ackTimeouts[link] += ackTimeouts;
+
+    // the route, added if new
+    int8_t route = findRoute(sourceAddress64Msb, sourceAddress64Lsb,
+        destinationAddress64Msb, destinationAddress64Lsb);
+    if (route < 0) {
+        route = getHomeSlot(sourceAddress64Msb, sourceAddress64Lsb,
+            destinationAddress64Msb, destinationAddress64Lsb, LINK_STATISTICS_ROUTES);
+        for (uint8_t i = 0; i < LINK_STATISTICS_ROUTES; i++) {
+            uint8_t j = (route+i) & (LINK_STATISTICS_ROUTES-1);
+            if (!_routeUsed[j]) {
+                route = j;
+                break;
+            }
+        }
+        _sourceAddress64Msb[route] = sourceAddress64Msb;
+        _sourceAddress64Lsb[route] = sourceAddress64Lsb;
+        _destinationAddress64Msb[route] = destinationAddress64Msb;
+        _destinationAddress64Lsb[route] = destinationAddress64Lsb;
+        _hops[route] = 0;
+        _traceHops[route] = 0;
+        _churn[route] = 0;
+        _routeUsed[route] = true;
+    }
+
+    if (responderAddress64Msb == sourceAddress64Msb && responderAddress64Lsb == sourceAddress64Lsb) {
+        // first hop: a new trace
+        _hops[route] = 1;
+        _signature[route] = 0;
+    } else if (_hops[route] != 0) {
+        _hops[route]++;
+
+        // the time since the previous hop goes to the previous link
+        uint8_t last = _lastLink[route];
+        if (_receiverAddress64Msb[last] == responderAddress64Msb &&
+            _receiverAddress64Lsb[last] == responderAddress64Lsb && _reports[last] != 0) {
+            uint32_t latency = timestamp - _lastTimestamp[route];
+            if (_latencySamples[last] == 0) {
+                _latencyMin[last] = latency;
+                _latencyMax[last] = latency;
+                _latencyAverage[last] = latency;
+            } else {
+                if (latency < _latencyMin[last]) _latencyMin[last] = latency;
+                if (latency > _latencyMax[last]) _latencyMax[last] = latency;
+                _latencyAverage[last] += (int32_t)(latency - _latencyAverage[last]) / 8;
+            }
+            if (_latencySamples[last] != 0xffff) _latencySamples[last]++;
+        }
+    }
+    if (_hops[route] == 0) return true; // joined in the middle of a trace
+
+    _lastTimestamp[route] = timestamp;
+    _lastLink[route] = link;
+    _signature[route] = ((_signature[route] << 5) | (_signature[route] >> 27)) ^
+        receiverAddress64Msb ^ receiverAddress64Lsb;
+
+    if (receiverAddress64Msb == destinationAddress64Msb && receiverAddress64Lsb == destinationAddress64Lsb) {
+        // last hop: the trace is complete
+        if (_traceHops[route] != 0 &&
+            (_traceHops[route] != _hops[route] || _traceSignature[route] != _signature[route]) &&
+            _churn[route] != 0xffff) _churn[route]++;
+        _traceHops[route] = _hops[route];
+        _traceSignature[route] = _signature[route];
+        _hops[route] = 0;
+    }
+    return true;
+}
+
+void
+LinkStatistics::clear() {
+    for (uint8_t i = 0; i < LINK_STATISTICS_LINKS; i++) _reports[i] = 0;
+    for (uint8_t i = 0; i < LINK_STATISTICS_ROUTES; i++) _routeUsed[i] = false;
+    _size = 0;
+}
+
+uint8_t
+LinkStatistics::getSize() { return _size; }
+
+int8_t
+LinkStatistics::findLink(const uint32_t& responderAddress64Msb, const uint32_t& responderAddress64Lsb,
+    const uint32_t& receiverAddress64Msb, const uint32_t& receiverAddress64Lsb) {
+    uint8_t i = getHomeSlot(responderAddress64Msb, responderAddress64Lsb,
+        receiverAddress64Msb, receiverAddress64Lsb, LINK_STATISTICS_LINKS);
+    for (uint8_t n = 0; n < LINK_STATISTICS_LINKS; n++) {
+        if (_reports[i] == 0) return -1;
+        if (_responderAddress64Msb[i] == responderAddress64Msb &&
+            _responderAddress64Lsb[i] == responderAddress64Lsb &&
+            _receiverAddress64Msb[i] == receiverAddress64Msb &&
+            _receiverAddress64Lsb[i] == receiverAddress64Lsb) return i;
+        i = (i+1) & (LINK_STATISTICS_LINKS-1);
+    }
+    return -1;
+}
+
+int8_t
+LinkStatistics::findSlowestLink() {
+    int8_t slowest = -1;
+    uint32_t slowestExcess = 0;
+    for (uint8_t i = 0; i < LINK_STATISTICS_LINKS; i++) {
+        if (_reports[i] == 0 || _latencySamples[i] < 2) continue;
+
+        uint32_t excess = 0;
+        if (_latencyAverage[i] > _latencyMin[i]) excess = _latencyAverage[i] - _latencyMin[i];
+        if (slowest < 0 || excess > slowestExcess) {
+            slowest = i;
+            slowestExcess = excess;
+        }
+    }
+    return slowest;
+}
+
+uint32_t
+LinkStatistics::getResponderAddress64Msb(const uint8_t& link) { return _responderAddress64Msb[link]; }
+uint32_t
+LinkStatistics::getResponderAddress64Lsb(const uint8_t& link) { return _responderAddress64Lsb[link]; }
+uint32_t
+LinkStatistics::getReceiverAddress64Msb(const uint8_t& link) { return _receiverAddress64Msb[link]; }
+uint32_t
+LinkStatistics::getReceiverAddress64Lsb(const uint8_t& link) { return _receiverAddress64Lsb[link]; }
+
+uint16_t
+LinkStatistics::getReports(const uint8_t& link) { return _reports[link]; }
+uint16_t
+LinkStatistics::getAckTimeouts(const uint8_t& link) { return _ackTimeouts[link]; }
+uint16_t
+LinkStatistics::getLatencySamples(const uint8_t& link) { return _latencySamples[link]; }
+uint32_t
+LinkStatistics::getLatencyMin(const uint8_t& link) { return _latencyMin[link]; }
+uint32_t
+LinkStatistics::getLatencyMax(const uint8_t& link) { return _latencyMax[link]; }
+uint32_t
+LinkStatistics::getLatencyAverage(const uint8_t& link) { return _latencyAverage[link]; }
+
+bool
+LinkStatistics::getRoute(const uint32_t& sourceAddress64Msb, const uint32_t& sourceAddress64Lsb,
+    const uint32_t& destinationAddress64Msb, const uint32_t& destinationAddress64Lsb,
+    uint8_t& hops, uint16_t& churn) {
+    int8_t i = findRoute(sourceAddress64Msb, sourceAddress64Lsb,
+        destinationAddress64Msb, destinationAddress64Lsb);
+    if (i < 0 || _traceHops[i] == 0) return false;
+
+    hops = _traceHops[i];
+    churn = _churn[i];
+    return true;
+}
+
+uint8_t
+LinkStatistics::getHomeSlot(const uint32_t& fromMsb, const uint32_t& fromLsb,
+    const uint32_t& toMsb, const uint32_t& toLsb, const uint8_t& size) {
+    // same folding as AddressCache, the direction matters
+    uint32_t h = fromLsb ^ fromMsb ^ ((toLsb ^ toMsb) * 0x9e3779b1);
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return h & (size-1);
+}
+
+int8_t
+LinkStatistics::findRoute(const uint32_t& sourceAddress64Msb, const uint32_t& sourceAddress64Lsb,
+    const uint32_t& destinationAddress64Msb, const uint32_t& destinationAddress64Lsb) {
+    uint8_t i = getHomeSlot(sourceAddress64Msb, sourceAddress64Lsb,
+        destinationAddress64Msb, destinationAddress64Lsb, LINK_STATISTICS_ROUTES);
+    for (uint8_t n = 0; n < LINK_STATISTICS_ROUTES; n++) {
+        if (!_routeUsed[i]) return -1;
+        if (_sourceAddress64Msb[i] == sourceAddress64Msb &&
+            _sourceAddress64Lsb[i] == sourceAddress64Lsb &&
+            _destinationAddress64Msb[i] == destinationAddress64Msb &&
+            _destinationAddress64Lsb[i] == destinationAddress64Lsb) return i;
+        i = (i+1) & (LINK_STATISTICS_ROUTES-1);
+    }
+    return -1;
+}
+
+
+LatencyHistogram::LatencyHistogram() { clear(); }
+
+void
+LatencyHistogram::record(const uint32_t& latency) {
+    _counts[getBucket(latency)]++;
+    if (_count == 0 || latency < _min) _min = latency;
+    if (latency > _max) _max = latency;
+    _count++;
+}
+void
+LatencyHistogram::clear() {
+    for (uint8_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) _counts[i] = 0;
+    _count = 0;
+    _min = 0;
+    _max = 0;
+}
+uint32_t
+LatencyHistogram::getCount() { return _count; }
+uint32_t
+LatencyHistogram::getMin() { return _min; }
+uint32_t
+LatencyHistogram::getMax() { return _max; }
+
+uint32_t
+LatencyHistogram::getPercentile(const uint16_t& perMille) {
+    if (_count == 0) return 0;
+
+    // rank of the record, rounded up
+    uint32_t rank = ((uint64_t) _count*perMille + 999)/1000;
+    if (rank == 0) rank = 1;
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += _counts[i];
+        if (seen < rank) continue;
+        uint32_t limit = getBucketLimit(i);
+        if (limit > _max) limit = _max;
+        if (limit < _min) limit = _min;
+        return limit;
+    }
+    return _max;
+}
+
+uint8_t
+LatencyHistogram::getBucket(const uint32_t& latency) {
+    if (latency < 16) return latency;
+
+    // power of two (4 to 31), then its top 3 bits below the leading one
+    uint8_t exponent = 31;
+    while (!(latency & ((uint32_t) 1 << exponent))) exponent--;
+    return 16 + (exponent - 4)*8 + ((latency >> (exponent - 3)) & 7);
+}
+uint32_t
+LatencyHistogram::getBucketLimit(const uint8_t& bucket) {
+    if (bucket < 16) return bucket;
+
+    // largest latency of the bucket
+    uint8_t exponent = (bucket - 16)/8 + 4;
+    uint32_t base = ((uint32_t)(8 + (bucket - 16)%8)) << (exponent - 3);
+    return base + (((uint32_t) 1 << (exponent - 3)) - 1);
+}
+
+XBeeGroup::XBeeGroup() {
+    _size = 0;
+    _stolen = 0;
+    _readCount = 0;
+    _lastRead = 0;
+}
+
+int8_t
+XBeeGroup::add(XBee& radio) {
+    if (_size == XBEE_GROUP_MAX_RADIOS) return -1;
+
+    _radios[_size] = &radio;
+    _queueHead[_size] = 0;
+    _queueDepth[_size] = 0;
+    for (uint8_t i = 0; i < XBEE_GROUP_MAX_IN_FLIGHT; i++) _inFlightFrameIds[_size][i] = 0;
+    _inFlight[_size] = 0;
+    _sent[_size] = 0;
+    _refused[_size] = 0;
+    _received[_size] = false;
+    return _size++;
+}
+
+uint8_t
+XBeeGroup::getSize() { return _size; }
+XBee&
+XBeeGroup::getRadio(const uint8_t& radio) { return *_radios[radio]; }
+
+bool
+XBeeGroup::send(XBeeApiFrame& request) {
+    int8_t best = pickRadio(request.getCmdId(), request.getCmdData(), -1);
+    if (best < 0) return false;
+    return enqueue(best, request, false);
+}
+
+bool
+XBeeGroup::send(const uint8_t& radio, XBeeApiFrame& request) {
+    if (radio >= _size) return false;
+    return enqueue(radio, request, true);
+}
+
+void
+XBeeGroup::poll() {
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < _size; i++) {
+        // statuses that never came
+        for (uint8_t j = 0; j < XBEE_GROUP_MAX_IN_FLIGHT; j++) {
+            if (_inFlightFrameIds[i][j] == 0 || (now - _inFlightSince[i][j]) < XBEE_GROUP_TX_TIMEOUT) continue;
+            _inFlightFrameIds[i][j] = 0;
+            _inFlight[i]--;
+        }
+
+        while (_inFlight[i] < XBEE_GROUP_MAX_IN_FLIGHT) {
+            if (_queueDepth[i] == 0 && !steal(i)) break;
+
+            TxEntry& entry = _queue[i][_queueHead[i]];
+            _queueHead[i] = (_queueHead[i]+1) % XBEE_GROUP_QUEUE_SIZE;
+            _queueDepth[i]--;
+            if (!sendEntry(i, entry)) refuse(i, entry);
+        }
+    }
+}
+
+int8_t
+XBeeGroup::readPacket() {
+    for (uint8_t i = 0; i < _size; i++) {
+        if (_received[i]) continue;
+        _radios[i]->readPacket();
+
+        XBeeApiFrame& frame = _radios[i]->getApiFrame();
+        if (!frame.isReady()) continue;
+
+        // kept in the XBee until handed out, which is not read meanwhile
+        _received[i] = true;
+        _receivedAt[i] = _readCount++;
+        receiveStatus(i, frame);
+    }
+
+    int8_t first = -1;
+    for (uint8_t i = 0; i < _size; i++) {
+        if (!_received[i]) continue;
+        if (first < 0 || (int32_t)(_receivedAt[i] - _receivedAt[first]) < 0) first = i;
+    }
+    if (first < 0) return -1;
+
+    _received[first] = false;
+    _lastRead = first;
+    return first;
+}
+
+XBeeApiFrame&
+XBeeGroup::getApiFrame() { return _radios[_lastRead]->getApiFrame(); }
+uint8_t
+XBeeGroup::getRadio() { return _lastRead; }
+
+uint8_t
+XBeeGroup::getQueueDepth(const uint8_t& radio) { return _queueDepth[radio]; }
+uint8_t
+XBeeGroup::getInFlight(const uint8_t& radio) { return _inFlight[radio]; }
+uint32_t
+XBeeGroup::getSent(const uint8_t& radio) { return _sent[radio]; }
+uint32_t
+XBeeGroup::getRefused(const uint8_t& radio) { return _refused[radio]; }
+uint32_t
+XBeeGroup::getStolen() { return _stolen; }
+
+int8_t
+XBeeGroup::pickRadio(const uint8_t& cmdId, const uint8_t* cmdData, const int8_t& except) {
+    int8_t best = -1;
+    uint8_t bestReachability = REACHABILITY_UNREACHABLE;
+    uint8_t bestDepth = 0;
+
+    for (uint8_t i = 0; i < _size; i++) {
+        if (i == except || _queueDepth[i] == XBEE_GROUP_QUEUE_SIZE) continue;
+
+        uint8_t reachability = getReachability(i, cmdId, cmdData);
+        if (reachability == REACHABILITY_UNREACHABLE) continue;
+
+        uint8_t depth = _queueDepth[i] + _inFlight[i];
+        if (best < 0 || reachability > bestReachability ||
+            (reachability == bestReachability && depth < bestDepth)) {
+            best = i;
+            bestReachability = reachability;
+            bestDepth = depth;
+        }
+    }
+    return best;
+}
+
+bool
+XBeeGroup::enqueue(const uint8_t& radio, XBeeApiFrame& request, const bool& pinned) {
+    uint16_t length = request.getCmdDataLength();
+    if (length > MAX_CMD_DATA_SIZE || _queueDepth[radio] == XBEE_GROUP_QUEUE_SIZE) return false;
+
+    TxEntry& entry = _queue[radio][(_queueHead[radio]+_queueDepth[radio]) % XBEE_GROUP_QUEUE_SIZE];
+    entry.cmdId = request.getCmdId();
+    entry.cmdDataLength = length;
+    entry.pinned = pinned;
+    uint8_t* cmdData = request.getCmdData();
+    for (uint16_t i = 0; i < length; i++) entry.cmdData[i] = cmdData[i];
+
+    _queueDepth[radio]++;
+    return true;
+}
+
+bool
+XBeeGroup::steal(const uint8_t& radio) {
+    // the longest queue of the others
+    int8_t victim = -1;
+    for (uint8_t i = 0; i < _size; i++) {
+        if (i == radio || _queueDepth[i] == 0) continue;
+        if (victim < 0 || _queueDepth[i] > _queueDepth[victim]) victim = i;
+    }
+    if (victim < 0) return false;
+
+    // the owner takes from the head, the thief from the tail
+    TxEntry& entry = _queue[victim][(_queueHead[victim]+_queueDepth[victim]-1) % XBEE_GROUP_QUEUE_SIZE];
+    if (entry.pinned || getReachability(radio, entry.cmdId, entry.cmdData) == REACHABILITY_UNREACHABLE)
+        return false;
+
+    _queue[radio][_queueHead[radio]] = entry;
+    _queueDepth[radio] = 1;
+    _queueDepth[victim]--;
+    _stolen++;
+    return true;
+}
+
+bool
+XBeeGroup::sendEntry(const uint8_t& radio, TxEntry& entry) {
+    XBeeApiFrameView request(entry.cmdId, entry.cmdData, entry.cmdDataLength);
+    if (!_radios[radio]->send(request)) return false;
+    _sent[radio]++;
+
+    // without frame id no status comes back
+    uint8_t statusId = getStatusCmdId(entry.cmdId);
+    if (statusId == 0 || !request.has<FrameIdDescriptionSchema::frameId>()) return true;
+    uint8_t frameId = request.get<FrameIdDescriptionSchema::frameId>();
+    if (frameId == 0) return true;
+
+    for (uint8_t i = 0; i < XBEE_GROUP_MAX_IN_FLIGHT; i++) {
+        if (_inFlightFrameIds[radio][i] != 0) continue;
+        _inFlightFrameIds[radio][i] = frameId;
+        _inFlightStatusIds[radio][i] = statusId;
+        _inFlightSince[radio][i] = millis();
+        _inFlight[radio]++;
+        break;
+    }
+    return true;
+}
+
+void
+XBeeGroup::refuse(const uint8_t& radio, TxEntry& entry) {
+    // a radio that may still reach the destination, at the tail of its
+    // queue (the slot of the entry is not reused before it is copied)
+    int8_t other = entry.pinned ? -1 : pickRadio(entry.cmdId, entry.cmdData, radio);
+    if (other < 0) {
+        _refused[radio]++;
+        return;
+    }
+    _queue[other][(_queueHead[other]+_queueDepth[other]) % XBEE_GROUP_QUEUE_SIZE] = entry;
+    _queueDepth[other]++;
+}
+
+void
+XBeeGroup::receiveStatus(const uint8_t& radio, XBeeApiFrame& frame) {
+    uint8_t cmdId = frame.getCmdId();
+    if (!frame.has<FrameIdDescriptionSchema::frameId>()) return;
+    uint8_t frameId = frame.get<FrameIdDescriptionSchema::frameId>();
+    if (frameId == 0) return;
+
+    for (uint8_t i = 0; i < XBEE_GROUP_MAX_IN_FLIGHT; i++) {
+        if (_inFlightFrameIds[radio][i] != frameId ||
+            _inFlightStatusIds[radio][i] != cmdId) continue;
+        // room for the next request of the radio
+        _inFlightFrameIds[radio][i] = 0;
+        _inFlight[radio]--;
+        return;
+    }
+}
+
+uint8_t
+XBeeGroup::getReachability(const uint8_t& radio, const uint8_t& cmdId, const uint8_t* cmdData) {
+    if (!isUnicastRequest(cmdId, cmdData)) return REACHABILITY_UNKNOWN;
+
+    return _radios[radio]->getReachability(
+        getField<TxRxFrameIdDescriptionSchema::address64Msb>(cmdData),
+        getField<TxRxFrameIdDescriptionSchema::address64Lsb>(cmdData));
+}
+
+#ifdef XBEENG_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef XBEENG_LINUX
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+
+/**
+ * Column offsets of a SampleExport segment: the header page, then
+ * the timestamps, nodes, masks and channels
+ */
+static size_t
+getSampleExportOffset(const uint32_t& capacity, const uint8_t& column) {
+    size_t offset = SAMPLE_EXPORT_PAGE_SIZE;
+    if (column > 0) offset += (size_t) capacity*sizeof(uint64_t);
+    if (column > 1) offset += (size_t) capacity*sizeof(uint32_t);
+    if (column > 2) offset += (size_t) capacity*sizeof(uint16_t)*(column - 2);
+    return offset;
+}
+
+SampleExportWriter::SampleExportWriter() {
+    _fd = -1;
+    _channels = 0;
+    _segmentSize = 0;
+    _segment = 0;
+    _base = nullptr;
+    _header = nullptr;
+}
+
+SampleExportWriter::~SampleExportWriter() {
+    close();
+}
+
+bool
+SampleExportWriter::open(const char* path, const uint8_t& channels) {
+    close();
+    if (channels == 0 || channels > SAMPLE_EXPORT_MAX_CHANNELS) return false;
+
+    _fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (_fd < 0) return false;
+
+    _channels = channels;
+    _segmentSize = getSampleExportOffset(SAMPLE_EXPORT_SEGMENT_ROWS, 3 + channels);
+
+    struct stat st;
+    if (fstat(_fd, &st) != 0 || st.st_size % _segmentSize != 0) {
+        close();
+        return false;
+    }
+
+    uint32_t segments = st.st_size/_segmentSize;
+    if (!mapSegment(segments > 0 ? segments - 1 : 0)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool
+SampleExportWriter::mapSegment(const uint32_t& segment) {
+    off_t offset = (off_t) segment*_segmentSize;
+
+    struct stat st;
+    if (fstat(_fd, &st) != 0) return false;
+    bool created = st.st_size < offset + (off_t) _segmentSize;
+    if (created && ftruncate(_fd, offset + _segmentSize) != 0) return false;
+
+    void* base = mmap(nullptr, _segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, offset);
+    if (base == MAP_FAILED) return false;
+
+    _base = (uint8_t*) base;
+    _segment = segment;
+    _header = (SampleExportHeader*) _base;
+    if (created) {
+        memcpy(_header->magic, SAMPLE_EXPORT_MAGIC, sizeof(_header->magic));
+        _header->rows = 0;
+        _header->capacity = SAMPLE_EXPORT_SEGMENT_ROWS;
+        _header->channels = _channels;
+        _header->reserved = 0;
+        _header->minTimestamp = 0;
+        _header->maxTimestamp = 0;
+    } else if (memcmp(_header->magic, SAMPLE_EXPORT_MAGIC, sizeof(_header->magic)) != 0 ||
+        _header->capacity != SAMPLE_EXPORT_SEGMENT_ROWS || _header->channels != _channels ||
+        _header->rows > SAMPLE_EXPORT_SEGMENT_ROWS) {
+        unmapSegment();
+        return false;
+    }
+
+    _timestamps = (uint64_t*) (_base + getSampleExportOffset(SAMPLE_EXPORT_SEGMENT_ROWS, 0));
+    _nodes = (uint32_t*) (_base + getSampleExportOffset(SAMPLE_EXPORT_SEGMENT_ROWS, 1));
+    _masks = (uint16_t*) (_base + getSampleExportOffset(SAMPLE_EXPORT_SEGMENT_ROWS, 2));
+    _values = (uint16_t*) (_base + getSampleExportOffset(SAMPLE_EXPORT_SEGMENT_ROWS, 3));
+    return true;
+}
+
+void
+SampleExportWriter::unmapSegment() {
+    if (_base != nullptr) munmap(_base, _segmentSize);
+    _base = nullptr;
+    _header = nullptr;
+}
+
+bool
+SampleExportWriter::append(const uint64_t& timestamp, const uint32_t& node,
+    const uint16_t& mask, const uint16_t* values) {
+    if (_header == nullptr) return false;
+    if (_header->rows == SAMPLE_EXPORT_SEGMENT_ROWS) {
+        uint32_t next = _segment + 1;
+        unmapSegment();
+        if (!mapSegment(next)) return false;
+    }
+
+    uint32_t row = _header->rows;
+    _timestamps[row] = timestamp;
+    _nodes[row] = node;
+    _masks[row] = mask;
+    for (uint8_t channel = 0; channel < _channels; channel++) {
+        _values[channel*SAMPLE_EXPORT_SEGMENT_ROWS + row] =
+            (mask & (1 << channel)) ? values[channel] : 0;
+    }
+
+    if (row == 0 || timestamp < _header->minTimestamp) _header->minTimestamp = timestamp;
+    if (row == 0 || timestamp > _header->maxTimestamp) _header->maxTimestamp = timestamp;
+    // the row is complete before it is counted
+    __atomic_store_n(&(_header->rows), row + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint16_t
+SampleExportWriter::append(IoSampleColumns& samples, const uint64_t& timestamp,
+    SampleExportNodeIndex nodeIndex, void* context) {
+    uint8_t channels = _channels < IO_SAMPLE_ANALOG_CHANNELS ? _channels : IO_SAMPLE_ANALOG_CHANNELS;
+    uint16_t values[IO_SAMPLE_ANALOG_CHANNELS];
+
+    uint32_t node = 0;
+    uint32_t nodeAddress64Msb = 0;
+    uint32_t nodeAddress64Lsb = 0;
+    uint16_t row = 0;
+    for (; row < samples.getRows(); row++) {
+        uint32_t address64Msb = samples.getAddress64Msb()[row];
+        uint32_t address64Lsb = samples.getAddress64Lsb()[row];
+        if (address64Msb == 0 && address64Lsb == 0) address64Lsb = samples.getAddress16()[row];
+        // consecutive rows mostly come from the same frame
+        if (row == 0 || address64Msb != nodeAddress64Msb || address64Lsb != nodeAddress64Lsb) {
+            node = nodeIndex(address64Msb, address64Lsb, context);
+            nodeAddress64Msb = address64Msb;
+            nodeAddress64Lsb = address64Lsb;
+        }
+
+        for (uint8_t channel = 0; channel < channels; channel++) {
+            values[channel] = samples.getAnalog(channel)[row];
+        }
+        uint16_t mask = samples.getAnalogMasks()[row] & ((1 << channels) - 1);
+        if (!append(timestamp, node, mask, values)) break;
+    }
+    return row;
+}
+
+bool
+SampleExportWriter::sync() {
+    if (_base == nullptr) return false;
+    return msync(_base, _segmentSize, MS_SYNC) == 0;
+}
+
+void
+SampleExportWriter::close() {
+    unmapSegment();
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+}
+
+bool
+SampleExportWriter::isOpen() {
+    return _header != nullptr;
+}
+
+uint32_t
+SampleExportWriter::getSegments() {
+    return _header != nullptr ? _segment + 1 : 0;
+}
+
+SampleExportReader::SampleExportReader() {
+    _base = nullptr;
+    _size = 0;
+    _segmentSize = 0;
+    _segments = 0;
+    _capacity = 0;
+    _channels = 0;
+}
+
+SampleExportReader::~SampleExportReader() {
+    close();
+}
+
+bool
+SampleExportReader::open(const char* path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(SampleExportHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping outlives the descriptor
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+
+    _base = (const uint8_t*) base;
+    _size = st.st_size;
+
+    const SampleExportHeader* header = (const SampleExportHeader*) _base;
+    if (memcmp(header->magic, SAMPLE_EXPORT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->capacity == 0 || header->channels == 0 ||
+        header->channels > SAMPLE_EXPORT_MAX_CHANNELS) {
+        close();
+        return false;
+    }
+    _capacity = header->capacity;
+    _channels = header->channels;
+    _segmentSize = getSampleExportOffset(_capacity, 3 + _channels);
+    _segments = _size/_segmentSize;
+
+    // sequential scans: read ahead
+    madvise((void*) _base, _size, MADV_SEQUENTIAL);
+    return true;
+}
+
+void
+SampleExportReader::close() {
+    if (_base != nullptr) munmap((void*) _base, _size);
+    _base = nullptr;
+    _size = 0;
+    _segments = 0;
+}
+
+uint32_t
+SampleExportReader::getSegments() {
+    return _segments;
+}
+
+uint8_t
+SampleExportReader::getChannels() {
+    return _channels;
+}
+
+const SampleExportHeader*
+SampleExportReader::getHeader(const uint32_t& segment) {
+    if (segment >= _segments) return nullptr;
+    return (const SampleExportHeader*) (_base + (size_t) segment*_segmentSize);
+}
+
+uint32_t
+SampleExportReader::getRows(const uint32_t& segment) {
+    const SampleExportHeader* header = getHeader(segment);
+    if (header == nullptr) return 0;
+
+    uint32_t rows = __atomic_load_n(&(header->rows), __ATOMIC_ACQUIRE);
+    return rows < _capacity ? rows : _capacity;
+}
+
+int32_t
+SampleExportReader::findSegment(const uint32_t& segment, const uint64_t& from, const uint64_t& to) {
+    for (uint32_t i = segment; i < _segments; i++) {
+        const SampleExportHeader* header = getHeader(i);
+        if (getRows(i) > 0 && header->minTimestamp <= to && header->maxTimestamp >= from) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const uint8_t*
+SampleExportReader::getColumn(const uint32_t& segment, const size_t& offset) {
+    if (segment >= _segments) return nullptr;
+    return _base + (size_t) segment*_segmentSize + offset;
+}
+
+const uint64_t*
+SampleExportReader::getTimestamps(const uint32_t& segment) {
+    return (const uint64_t*) getColumn(segment, getSampleExportOffset(_capacity, 0));
+}
+
+const uint32_t*
+SampleExportReader::getNodes(const uint32_t& segment) {
+    return (const uint32_t*) getColumn(segment, getSampleExportOffset(_capacity, 1));
+}
+
+const uint16_t*
+SampleExportReader::getMasks(const uint32_t& segment) {
+    return (const uint16_t*) getColumn(segment, getSampleExportOffset(_capacity, 2));
+}
+
+const uint16_t*
+SampleExportReader::getChannel(const uint32_t& segment, const uint8_t& channel) {
+    if (channel >= _channels) return nullptr;
+    return (const uint16_t*) getColumn(segment, getSampleExportOffset(_capacity, 3 + channel));
+}
+
+uint64_t
+getMonotonicTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec*1000000000 + now.tv_nsec;
+}
+
+/**
+ * termios speed of a baud rate, false if not supported
+ */
+static bool
+getSerialPortSpeed(const uint32_t& baud, speed_t& speed) {
+    switch (baud) {
+    case 1200: speed = B1200; break;
+    case 2400: speed = B2400; break;
+    case 4800: speed = B4800; break;
+    case 9600: speed = B9600; break;
+    case 19200: speed = B19200; break;
+    case 38400: speed = B38400; break;
+    case 57600: speed = B57600; break;
+    case 115200: speed = B115200; break;
+    case 230400: speed = B230400; break;
+#ifdef B460800
+    case 460800: speed = B460800; break;
+#endif
+#ifdef B921600
+    case 921600: speed = B921600; break;
+#endif
+    default: return false;
+    }
+    return true;
+}
+
+SerialPort::SerialPort() {
+    _head = 0;
+    _tail = 0;
+    _fd = -1;
+    _busyPoll = 0;
+}
+SerialPort::~SerialPort() { close(); }
+
+bool
+SerialPort::open(const char* path, const uint32_t& baud) { return open(path, baud, false); }
+bool
+SerialPort::open(const char* path, const uint32_t& baud, const bool& rtsCts) {
+    close();
+
+    speed_t speed;
+    if (!getSerialPortSpeed(baud, speed)) return false;
+
+    int fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd == -1) return false;
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) == -1) {
+        ::close(fd);
+        return false;
+    }
+    // raw 8N1, reads return what is there (VMIN = VTIME = 0)
+    cfmakeraw(&tty);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cflag &= ~CSTOPB;
+#ifdef CRTSCTS
+    if (rtsCts) tty.c_cflag |= CRTSCTS;
+    else tty.c_cflag &= ~CRTSCTS;
+#else
+    if (rtsCts) {
+        ::close(fd);
+        return false;
+    }
+#endif
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    if (tcsetattr(fd, TCSANOW, &tty) == -1) {
+        ::close(fd);
+        return false;
+    }
+    // drop what came before the port was set up
+    tcflush(fd, TCIFLUSH);
+
+    _fd = fd;
+    _head = 0;
+    _tail = 0;
+    return true;
+}
+void
+SerialPort::close() {
+    if (_fd == -1) return;
+    ::close(_fd);
+    _fd = -1;
+    _head = 0;
+    _tail = 0;
+}
+bool
+SerialPort::isOpen() { return _fd != -1; }
+int
+SerialPort::getFd() { return _fd; }
+
+int
+SerialPort::available() {
+    if (_head == _tail && _fd != -1) {
+        ssize_t n = ::read(_fd, _buffer, SERIAL_PORT_BUFFER_SIZE);
+        _head = 0;
+        _tail = n > 0 ? n : 0;
+    }
+    return _tail - _head;
+}
+int
+SerialPort::read() {
+    if (!available()) return -1;
+    return _buffer[_head++];
+}
+int
+SerialPort::peek() {
+    if (!available()) return -1;
+    return _buffer[_head];
+}
+size_t
+SerialPort::write(uint8_t b) { return write(&b, 1); }
+size_t
+SerialPort::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (n < size && _fd != -1) {
+        ssize_t written = ::write(_fd, buffer + n, size - n);
+        if (written >= 0) {
+            n += written;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // the tty buffer is full: wait until it drains
+            struct pollfd out;
+            out.fd = _fd;
+            out.events = POLLOUT;
+            poll(&out, 1, -1);
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    return n;
+}
+void
+SerialPort::flush() {
+    if (_fd != -1) tcdrain(_fd);
+}
+bool
+SerialPort::waitAvailable(const uint64_t& deadline) {
+    if (_busyPoll > 0 && available() == 0) {
+        uint64_t until = getMonotonicTime() + _busyPoll;
+        if (until > deadline) until = deadline;
+        while (available() == 0 && _fd != -1 && getMonotonicTime() < until);
+    }
+
+    while (available() == 0) {
+        if (_fd == -1) return false;
+
+        struct pollfd in;
+        in.fd = _fd;
+        in.events = POLLIN;
+        in.revents = 0;
+
+        int ready;
+        if (deadline == UINT64_MAX) {
+            ready = poll(&in, 1, -1);
+        } else {
+            uint64_t now = getMonotonicTime();
+            if (now >= deadline) return false;
+#ifdef __linux__
+            struct timespec wait;
+            wait.tv_sec = (deadline - now)/1000000000;
+            wait.tv_nsec = (deadline - now)%1000000000;
+            ready = ppoll(&in, 1, &wait, nullptr);
+#else
+            // poll(2) takes milliseconds, rounded up
+            ready = poll(&in, 1, (int)((deadline - now + 999999)/1000000));
+#endif
+        }
+
+        if (ready == -1 && errno != EINTR) return false;
+        if (ready > 0 && (in.revents & (POLLERR | POLLHUP | POLLNVAL))) return available() > 0;
+    }
+    return true;
+}
+bool
+SerialPort::setLowLatency(const bool& lowLatency) {
+#ifdef XBEENG_LINUX
+    if (_fd == -1) return false;
+
+    struct serial_struct serial;
+    if (ioctl(_fd, TIOCGSERIAL, &serial) == -1) return false;
+    if (lowLatency) serial.flags |= ASYNC_LOW_LATENCY;
+    else serial.flags &= ~ASYNC_LOW_LATENCY;
+    return ioctl(_fd, TIOCSSERIAL, &serial) != -1;
+#else
+    return false;
+#endif
+}
+void
+SerialPort::setBusyPoll(const uint64_t& spin) { _busyPoll = spin; }
+
+#ifdef XBEENG_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+// epoll data of the timerfd, the radios are their index
+#define EVENT_LOOP_TIMER EVENT_LOOP_MAX_RADIOS
+
+XBeeEventLoop::XBeeEventLoop() {
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    _timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    _running = false;
+
+    if (_epollFd != -1 && _timerFd != -1) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = EVENT_LOOP_TIMER;
+        epoll_ctl(_epollFd, EPOLL_CTL_ADD, _timerFd, &event);
+    }
+
+    for (uint8_t i = 0; i < EVENT_LOOP_MAX_RADIOS; i++) {
+        _radios[i] = nullptr;
+        _pending[i] = false;
+    }
+    _pendingCount = 0;
+    for (uint8_t i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) _deadlines[i] = 0;
+    _armedAt = 0;
+
+    _frames = 0;
+    _errors = 0;
+}
+XBeeEventLoop::~XBeeEventLoop() {
+    if (_timerFd != -1) ::close(_timerFd);
+    if (_epollFd != -1) ::close(_epollFd);
+}
+
+bool
+XBeeEventLoop::isOpen() { return _epollFd != -1 && _timerFd != -1; }
+
+bool
+XBeeEventLoop::addRadio(XBee& xbee, const int& fd, EventLoopFrameCallback callback, void* context) {
+    if (!isOpen()) return false;
+
+    uint8_t i = 0;
+    while (i < EVENT_LOOP_MAX_RADIOS && _radios[i] != nullptr) i++;
+    if (i == EVENT_LOOP_MAX_RADIOS) return false;
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = i;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) == -1) return false;
+
+    _radios[i] = &xbee;
+    _radioFds[i] = fd;
+    _frameCallbacks[i] = callback;
+    _frameContexts[i] = context;
+    return true;
+}
+void
+XBeeEventLoop::removeRadio(XBee& xbee) {
+    for (uint8_t i = 0; i < EVENT_LOOP_MAX_RADIOS; i++) {
+        if (_radios[i] != &xbee) continue;
+        epoll_ctl(_epollFd, EPOLL_CTL_DEL, _radioFds[i], nullptr);
+        _radios[i] = nullptr;
+        if (_pending[i]) {
+            _pending[i] = false;
+            _pendingCount--;
+        }
+    }
+}
+
+int8_t
+XBeeEventLoop::addTimer(const uint64_t& delay, const uint64_t& period,
+    EventLoopTimerCallback callback, void* context) {
+    for (uint8_t i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        if (_deadlines[i] != 0) continue;
+        _deadlines[i] = getMonotonicTime() + delay;
+        _periods[i] = period;
+        _timerCallbacks[i] = callback;
+        _timerContexts[i] = context;
+        armTimers();
+        return i;
+    }
+    return -1;
+}
+void
+XBeeEventLoop::cancelTimer(const int8_t& timer) {
+    if (timer < 0 || timer >= EVENT_LOOP_MAX_TIMERS) return;
+    _deadlines[timer] = 0;
+    armTimers();
+}
+
+bool
+XBeeEventLoop::runOnce(const uint64_t& deadline) {
+    int timeout = -1;
+    if (_pendingCount > 0) {
+        // only look for what else is ready
+        timeout = 0;
+    } else if (deadline != UINT64_MAX) {
+        uint64_t now = getMonotonicTime();
+        // epoll_wait(2) takes milliseconds, rounded up
+        timeout = now >= deadline ? 0 : (int)((deadline - now + 999999)/1000000);
+    }
+
+    struct epoll_event events[EVENT_LOOP_MAX_RADIOS + 1];
+    int n = epoll_wait(_epollFd, events, EVENT_LOOP_MAX_RADIOS + 1, timeout);
+    if (n == -1) return errno == EINTR;
+
+    for (int i = 0; i < n; i++) {
+        uint32_t source = events[i].data.u32;
+        if (source == EVENT_LOOP_TIMER) {
+            uint64_t expirations;
+            while (::read(_timerFd, &expirations, sizeof(expirations)) > 0);
+            _armedAt = 0;
+            runTimers();
+        } else if (_radios[source] != nullptr) {
+            readRadio(source);
+        }
+    }
+
+    for (uint8_t i = 0; i < EVENT_LOOP_MAX_RADIOS && _pendingCount > 0; i++) {
+        if (!_pending[i]) continue;
+        _pending[i] = false;
+        _pendingCount--;
+        if (_radios[i] != nullptr) readRadio(i);
+    }
+    return true;
+}
+void
+XBeeEventLoop::run() {
+    _running = true;
+    while (_running && runOnce(UINT64_MAX));
+    _running = false;
+}
+void
+XBeeEventLoop::stop() { _running = false; }
+
+uint32_t
+XBeeEventLoop::getFrames() { return _frames; }
+uint32_t
+XBeeEventLoop::getErrors() { return _errors; }
+
+void
+XBeeEventLoop::readRadio(const uint8_t& radio) {
+    XBee* xbee = _radios[radio];
+    for (uint8_t i = 0; i < EVENT_LOOP_FRAMES_PER_WAKE; i++) {
+        xbee->readPacket();
+        XBeeApiFrame& frame = xbee->getApiFrame();
+        if (frame.isReady()) {
+            _frames++;
+            if (_frameCallbacks[radio] != nullptr)
+                _frameCallbacks[radio](*xbee, frame, _frameContexts[radio]);
+            // the callback may have removed the radio
+            if (_radios[radio] != xbee) return;
+        } else if (frame.hasErrors()) {
+            _errors++;
+        } else {
+            // drained: epoll tells when more bytes come
+            return;
+        }
+    }
+    // more frames may wait: in the fd epoll (level-triggered) comes
+    // back here, in the buffer of the stream runOnce(...) does
+    if (!_pending[radio]) {
+        _pending[radio] = true;
+        _pendingCount++;
+    }
+}
+void
+XBeeEventLoop::runTimers() {
+    uint64_t now = getMonotonicTime();
+    for (uint8_t i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        if (_deadlines[i] == 0 || _deadlines[i] > now) continue;
+
+        if (_periods[i] == 0) {
+            _deadlines[i] = 0;
+        } else {
+            // expirations missed while busy are skipped, not bunched
+            _deadlines[i] += _periods[i];
+            if (_deadlines[i] <= now) _deadlines[i] = now + _periods[i];
+        }
+        _timerCallbacks[i](_timerContexts[i]);
+    }
+    armTimers();
+}
+void
+XBeeEventLoop::armTimers() {
+    uint64_t earliest = 0;
+    for (uint8_t i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        if (_deadlines[i] != 0 && (earliest == 0 || _deadlines[i] < earliest))
+            earliest = _deadlines[i];
+    }
+    if (earliest == _armedAt) return;
+
+    // an absolute deadline, 0 disarms
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = earliest/1000000000;
+    spec.it_value.tv_nsec = earliest%1000000000;
+    timerfd_settime(_timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    _armedAt = earliest;
+}
+
+XBeeReaderThread::XBeeReaderThread(XBee& xbee) {
+    _xbee = &xbee;
+    _running = false;
+    _eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    _head = 0;
+    _tail = 0;
+    _dropped = 0;
+
+    _response.setCmdData(_responseCmdData);
+}
+XBeeReaderThread::~XBeeReaderThread() {
+    stop();
+    if (_eventFd != -1) ::close(_eventFd);
+    // the buffer of the response is not on the heap
+    _response.setCmdData(nullptr);
+}
+
+bool
+XBeeReaderThread::start() {
+    if (_running) return true;
+    if (_eventFd == -1) return false;
+
+    __atomic_store_n(&_running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&_thread, nullptr, runThread, this) != 0) {
+        _running = false;
+        return false;
+    }
+    return true;
+}
+void
+XBeeReaderThread::stop() {
+    if (!_running) return;
+    __atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+    pthread_join(_thread, nullptr);
+}
+bool
+XBeeReaderThread::isRunning() { return _running; }
+
+bool
+XBeeReaderThread::readPacket() {
+    uint32_t tail = _tail;
+    if (tail == __atomic_load_n(&_head, __ATOMIC_ACQUIRE)) return false;
+
+    QueuedFrame& queued = _queue[tail & (READER_QUEUE_SIZE-1)];
+    _response.setCmdId(queued.cmdId);
+    _response.setFrameDataLength(queued.frameDataLength);
+    memcpy(_responseCmdData, queued.cmdData, queued.frameDataLength - 1);
+    _response.setChecksum(queued.checksum);
+    _response.setReady(true);
+    _response.setErrorCode(NO_ERROR);
+
+    // the slot goes back to the reader thread
+    __atomic_store_n(&_tail, tail + 1, __ATOMIC_SEQ_CST);
+    return true;
+}
+bool
+XBeeReaderThread::readPacket(const uint32_t& timeout) {
+    return readPacketBefore(getMonotonicTime() + (uint64_t) timeout*1000000);
+}
+bool
+XBeeReaderThread::readPacketBefore(const uint64_t& deadline) {
+    for (;;) {
+        if (readPacket()) return true;
+
+        // clear the wake-up, then check again: a frame pushed from
+        // now on finds the ring empty and signals the eventfd
+        uint64_t signals;
+        while (::read(_eventFd, &signals, sizeof(signals)) > 0);
+        if (readPacket()) return true;
+
+        struct pollfd in;
+        in.fd = _eventFd;
+        in.events = POLLIN;
+        in.revents = 0;
+        if (deadline == UINT64_MAX) {
+            poll(&in, 1, -1);
+        } else {
+            uint64_t now = getMonotonicTime();
+            if (now >= deadline) return false;
+            struct timespec wait;
+            wait.tv_sec = (deadline - now)/1000000000;
+            wait.tv_nsec = (deadline - now)%1000000000;
+            ppoll(&in, 1, &wait, nullptr);
+        }
+    }
+}
+
+XBeeApiFrame&
+XBeeReaderThread::getApiFrame() { return _response; }
+int
+XBeeReaderThread::getFd() { return _eventFd; }
+uint32_t
+XBeeReaderThread::getDropped() { return __atomic_load_n(&_dropped, __ATOMIC_RELAXED); }
+
+void*
+XBeeReaderThread::runThread(void* reader) {
+    static_cast<XBeeReaderThread*>(reader)->run();
+    return nullptr;
+}
+void
+XBeeReaderThread::run() {
+    while (__atomic_load_n(&_running, __ATOMIC_ACQUIRE)) {
+        if (_xbee->readPacketBefore(getMonotonicTime() + READER_STOP_WAIT))
+            push(_xbee->getApiFrame());
+    }
+}
+void
+XBeeReaderThread::push(XBeeApiFrame& frame) {
+    uint32_t head = _head;
+    if (head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE) == READER_QUEUE_SIZE) {
+        __atomic_store_n(&_dropped, _dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    QueuedFrame& queued = _queue[head & (READER_QUEUE_SIZE-1)];
+    queued.cmdId = frame.getCmdId();
+    queued.checksum = frame.getChecksum();
+    queued.frameDataLength = frame.getFrameDataLength();
+    memcpy(queued.cmdData, frame.getCmdData(), queued.frameDataLength - 1);
+
+    // published; the application may be asleep only if it found the
+    // ring empty, that is if it has taken every frame before this one
+    __atomic_store_n(&_head, head + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&_tail, __ATOMIC_SEQ_CST) == head) {
+        uint64_t signal = 1;
+        ssize_t written = ::write(_eventFd, &signal, sizeof(signal));
+        (void) written;
+    }
+}
+
+XBeeWriterThread::XBeeWriterThread(XBee& xbee, Stream& serial) {
+    _xbee = &xbee;
+    _serial = &serial;
+    _running = false;
+
+    for (uint32_t i = 0; i < WRITER_QUEUE_SIZE; i++) _queue[i].sequence = i;
+    _pushAt = 0;
+    _popAt = 0;
+
+    _itemsFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _roomFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _writerAsleep = false;
+    _blocked = 0;
+
+    _batch.length = 0;
+    _batch.serial = &serial;
+
+    _maxDepth = 0;
+    _sent = 0;
+    _rejected = 0;
+    pthread_mutex_init(&_waitTimesMutex, nullptr);
+}
+XBeeWriterThread::~XBeeWriterThread() {
+    stop();
+    if (_itemsFd != -1) ::close(_itemsFd);
+    if (_roomFd != -1) ::close(_roomFd);
+    pthread_mutex_destroy(&_waitTimesMutex);
+}
+
+bool
+XBeeWriterThread::start() {
+    if (_running) return true;
+    if (_itemsFd == -1 || _roomFd == -1) return false;
+
+    __atomic_store_n(&_running, true, __ATOMIC_SEQ_CST);
+    if (pthread_create(&_thread, nullptr, runThread, this) != 0) {
+        _running = false;
+        return false;
+    }
+    return true;
+}
+void
+XBeeWriterThread::stop() {
+    if (!_running) return;
+    __atomic_store_n(&_running, false, __ATOMIC_SEQ_CST);
+    signal(_itemsFd);
+    pthread_join(_thread, nullptr);
+}
+bool
+XBeeWriterThread::isRunning() { return _running; }
+
+bool
+XBeeWriterThread::send(XBeeApiFrame& request) {
+    if (!fits(request)) return false;
+    for (;;) {
+        if (push(request)) return true;
+
+        // full: wait for the writer to take a frame, checking again
+        // once registered so that no wake-up is missed
+        __atomic_add_fetch(&_blocked, 1, __ATOMIC_SEQ_CST);
+        if (push(request)) {
+            __atomic_sub_fetch(&_blocked, 1, __ATOMIC_SEQ_CST);
+            return true;
+        }
+        if (!__atomic_load_n(&_running, __ATOMIC_SEQ_CST)) {
+            __atomic_sub_fetch(&_blocked, 1, __ATOMIC_SEQ_CST);
+            return false;
+        }
+
+        struct pollfd room;
+        room.fd = _roomFd;
+        room.events = POLLIN;
+        room.revents = 0;
+        // bounded, the other blocked threads may take the wake-up
+        poll(&room, 1, 10);
+        uint64_t signals;
+        while (::read(_roomFd, &signals, sizeof(signals)) > 0);
+        __atomic_sub_fetch(&_blocked, 1, __ATOMIC_SEQ_CST);
+    }
+}
+bool
+XBeeWriterThread::trySend(XBeeApiFrame& request) {
+    if (!fits(request)) return false;
+    if (push(request)) return true;
+    __atomic_add_fetch(&_rejected, 1, __ATOMIC_RELAXED);
+    return false;
+}
+
+uint32_t
+XBeeWriterThread::getDepth() {
+    return __atomic_load_n(&_pushAt, __ATOMIC_RELAXED) - __atomic_load_n(&_popAt, __ATOMIC_RELAXED);
+}
+uint32_t
+XBeeWriterThread::getMaxDepth() { return __atomic_load_n(&_maxDepth, __ATOMIC_RELAXED); }
+uint32_t
+XBeeWriterThread::getSent() { return __atomic_load_n(&_sent, __ATOMIC_RELAXED); }
+uint32_t
+XBeeWriterThread::getRejected() { return __atomic_load_n(&_rejected, __ATOMIC_RELAXED); }
+void
+XBeeWriterThread::getWaitTimes(LatencyHistogram& waitTimes) {
+    pthread_mutex_lock(&_waitTimesMutex);
+    waitTimes = _waitTimes;
+    pthread_mutex_unlock(&_waitTimesMutex);
+}
+
+bool
+XBeeWriterThread::fits(XBeeApiFrame& request) {
+    // a slot holds MAX_CMD_DATA_SIZE bytes of command data
+    if (request.getFrameDataLength() > 0 && request.getCmdDataLength() <= MAX_CMD_DATA_SIZE) return true;
+    __atomic_add_fetch(&_rejected, 1, __ATOMIC_RELAXED);
+    return false;
+}
+bool
+XBeeWriterThread::push(XBeeApiFrame& request) {
+    // bounded queue of D. Vyukov: a slot is free for the push number
+    // n when its sequence is n, and holds a frame for the pop number
+    // n when its sequence is n + 1
+    uint32_t at = __atomic_load_n(&_pushAt, __ATOMIC_RELAXED);
+    QueuedFrame* queued;
+    for (;;) {
+        queued = &(_queue[at & (WRITER_QUEUE_SIZE-1)]);
+        int32_t turn = __atomic_load_n(&(queued->sequence), __ATOMIC_ACQUIRE) - at;
+        if (turn == 0) {
+            if (__atomic_compare_exchange_n(&_pushAt, &at, at + 1, true,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (turn < 0) {
+            // full
+            return false;
+        } else {
+            at = __atomic_load_n(&_pushAt, __ATOMIC_RELAXED);
+        }
+    }
+
+    queued->cmdId = request.getCmdId();
+    queued->checksum = request.getChecksum();
+    queued->frameDataLength = request.getFrameDataLength();
+    memcpy(queued->cmdData, request.getCmdData(), queued->frameDataLength - 1);
+    queued->queuedAt = getMonotonicTime();
+    __atomic_store_n(&(queued->sequence), at + 1, __ATOMIC_RELEASE);
+
+    uint32_t depth = at + 1 - __atomic_load_n(&_popAt, __ATOMIC_RELAXED);
+    uint32_t maxDepth = __atomic_load_n(&_maxDepth, __ATOMIC_RELAXED);
+    while (depth > maxDepth && !__atomic_compare_exchange_n(&_maxDepth, &maxDepth, depth, true,
+        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    // the writer only sleeps after finding the queue empty: either it
+    // sees this frame, or this sees it asleep
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&_writerAsleep, __ATOMIC_SEQ_CST)) signal(_itemsFd);
+    return true;
+}
+bool
+XBeeWriterThread::pop() {
+    uint32_t at = _popAt;
+    QueuedFrame& queued = _queue[at & (WRITER_QUEUE_SIZE-1)];
+    if (__atomic_load_n(&(queued.sequence), __ATOMIC_ACQUIRE) != at + 1) return false;
+
+    if (_batch.length + WRITER_FRAME_BYTES > WRITER_BATCH_SIZE) writeBatch();
+
+    XBeeApiFrame request;
+    request.setCmdId(queued.cmdId);
+    request.setFrameDataLength(queued.frameDataLength);
+    request.setCmdData(queued.cmdData);
+    request.setChecksum(queued.checksum);
+    if (_xbee->sendTo(_batch, request)) __atomic_add_fetch(&_sent, 1, __ATOMIC_RELAXED);
+    else __atomic_add_fetch(&_rejected, 1, __ATOMIC_RELAXED);
+    // the buffer is not on the heap
+    request.setCmdData(nullptr);
+
+    uint64_t waited = getMonotonicTime() - queued.queuedAt;
+    pthread_mutex_lock(&_waitTimesMutex);
+    _waitTimes.record(waited/1000);
+    pthread_mutex_unlock(&_waitTimesMutex);
+
+    // the slot is free for the push WRITER_QUEUE_SIZE later
+    __atomic_store_n(&(queued.sequence), at + WRITER_QUEUE_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&_popAt, at + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&_blocked, __ATOMIC_SEQ_CST) > 0) signal(_roomFd);
+    return true;
+}
+
+void*
+XBeeWriterThread::runThread(void* writer) {
+    static_cast<XBeeWriterThread*>(writer)->run();
+    return nullptr;
+}
+void
+XBeeWriterThread::run() {
+    for (;;) {
+        if (pop()) continue;
+
+        // empty: what is encoded goes out before sleeping, and what
+        // came meanwhile goes before stopping
+        writeBatch();
+        bool running = __atomic_load_n(&_running, __ATOMIC_SEQ_CST);
+        if (pop()) continue;
+        if (!running) break;
+
+        __atomic_store_n(&_writerAsleep, true, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!pop()) {
+            struct pollfd items;
+            items.fd = _itemsFd;
+            items.events = POLLIN;
+            items.revents = 0;
+            if (__atomic_load_n(&_running, __ATOMIC_SEQ_CST)) poll(&items, 1, -1);
+            uint64_t signals;
+            while (::read(_itemsFd, &signals, sizeof(signals)) > 0);
+        }
+        __atomic_store_n(&_writerAsleep, false, __ATOMIC_SEQ_CST);
+    }
+}
+void
+XBeeWriterThread::writeBatch() {
+    if (_batch.length == 0) return;
+    _serial->write(_batch.buffer, _batch.length);
+    _serial->flush();
+    _batch.length = 0;
+}
+void
+XBeeWriterThread::signal(const int& fd) {
+    uint64_t signal = 1;
+    ssize_t written = ::write(fd, &signal, sizeof(signal));
+    (void) written;
+}
+
+size_t
+XBeeWriterThread::Batch::write(const uint8_t* data, size_t size) {
+    // room for a whole frame is made before encoding it; should it
+    // not suffice, the batch goes out first rather than cut the frame
+    if (size > WRITER_BATCH_SIZE - length) {
+        serial->write(buffer, length);
+        length = 0;
+        if (size > WRITER_BATCH_SIZE) return serial->write(data, size);
+    }
+    memcpy(&(buffer[length]), data, size);
+    length += size;
+    return size;
+}
+#endif
+#endif
@@ -22,18 +22,41 @@
 
 #if defined(ARDUINO) && ARDUINO >= 100
     #include "Arduino.h"
-#else
+#elif defined(ARDUINO)
     #include "WProgram.h"
+#else
+    // host build, see the Makefile
+    #include "host/Arduino.h"
 #endif
 
 #include <inttypes.h>
+#include <string.h>
 
 #define XBEENG_WITH_EXTRAS
 
+#if defined(__unix__) || defined(__APPLE__)
+#define XBEENG_POSIX
+#endif
+#if defined(XBEENG_POSIX) && defined(__linux__)
+#define XBEENG_LINUX
+#endif
+
+#ifdef XBEENG_POSIX
+#include <pthread.h>
+#endif
+
 #ifdef XBEENG_WITH_EXTRAS
 #include <initializer_list>
 #endif
 
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<coroutine>)
+#define XBEENG_COROUTINES
+#include <coroutine>
+#include <stdlib.h>
+#endif
+#endif
+
 #define XB_START    0x7e
 #define XB_ESCAPE   0x7d
 #define XB_ON       0x11
@@ -53,6 +76,14 @@
  */
 #define MAX_CMD_DATA_SIZE 110
 
+/*
+ * Frame ids of the XBeeExchanges, from EXCHANGE_FIRST_FRAME_ID to 255;
+ * the other frames of the library and those of the application keep
+ * 1 to EXCHANGE_FIRST_FRAME_ID-1 (or 0).
+ */
+#define EXCHANGE_FIRST_FRAME_ID 0x80
+#define EXCHANGE_FRAME_IDS (256 - EXCHANGE_FIRST_FRAME_ID)
+
 // API Frame Names:
 #define TX_64_REQUEST 0x00
 #define TX_16_REQUEST 0x01
@@ -79,10 +110,9 @@
 #define RX_SENSOR_READ 0x94
 #define RX_NODE_ID 0x95
 #define REMOTE_AT_COMMAND_RESPONSE 0x97
-// ToDo API Frame Names:
-#define OTA_FIRMWARE_UPDATE_STATUS 0xa0
 #define RX_ROUTE_RECORD 0xa1
 #define RX_MTO_ROUTE_REQUEST 0xa3
+#define OTA_FIRMWARE_UPDATE_STATUS 0xa0
 #define RX_DEVICE_AUTHENTICATED 0xa2
 #define REGISTER_JOINING_DEVICE_STATUS 0xa4
 
@@ -108,6 +138,22 @@
 #define COORDINATOR_REALIGNMENT 5
 #define COORDINATOR_STARTED 6
 
+// OTA firmware update status (bootloader message types)
+#define OTA_ACK 0x06
+#define OTA_NACK 0x15
+#define OTA_NO_MAC_ACK 0x40
+#define OTA_QUERY 0x51
+#define OTA_QUERY_RESPONSE 0x52
+
+// register joining device status
+#define REGISTER_SUCCESS 0x00
+#define REGISTER_KEY_TOO_LONG 0x01
+#define REGISTER_ADDRESS_NOT_FOUND 0xb1
+#define REGISTER_INVALID_KEY 0xb2
+#define REGISTER_INVALID_ADDRESS 0xb3
+#define REGISTER_KEY_TABLE_FULL 0xb4
+#define REGISTER_INVALID_INSTALL_CODE 0xbd
+
 //page 57 DM datasheet
 #define AT_OK 0
 #define AT_ERROR  1
@@ -120,9 +166,137 @@
 #define CHECKSUM_FAILURE 1
 #define PACKET_EXCEEDS_CMD_DATA_LENGTH 2
 #define UNEXPECTED_START 3
+// set by XBeeExchanges on the frame of an exchange that has no response
+#define RESPONSE_TIMEOUT 4
+#define REQUEST_NOT_SENT 5
 
 #define CMD_DATA_OFFSET 4
 
+/*
+ * Byte order of the host, to convert the big-endian fields of the
+ * frames: with a known order the conversion is a load (memcpy, so any
+ * alignment is fine) and at most one swap instruction (rev, bswap or
+ * movbe). On AVR, and compilers that do not tell the order, bytes
+ * are shifted one by one, which is as fast on an 8-bit core.
+ */
+#if defined(__BYTE_ORDER__) && !defined(__AVR__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define XBEENG_SWAP16(x) __builtin_bswap16(x)
+#define XBEENG_SWAP32(x) __builtin_bswap32(x)
+#elif __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define XBEENG_SWAP16(x) (x)
+#define XBEENG_SWAP32(x) (x)
+#endif
+#endif
+
+/**
+ * Returns the big-endian (wire order) value at <i>bytes</i>, in host
+ * order
+ */
+inline uint16_t
+getBigEndian16(const uint8_t* bytes) {
+#ifdef XBEENG_SWAP16
+    uint16_t value;
+    memcpy(&value, bytes, 2);
+    return XBEENG_SWAP16(value);
+#else
+    return ((uint16_t)bytes[0] << 8) | bytes[1];
+#endif
+}
+inline uint32_t
+getBigEndian32(const uint8_t* bytes) {
+#ifdef XBEENG_SWAP32
+    uint32_t value;
+    memcpy(&value, bytes, 4);
+    return XBEENG_SWAP32(value);
+#else
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+        ((uint32_t)bytes[2] << 8) | bytes[3];
+#endif
+}
+/**
+ * Writes the host order <i>value</i> at <i>bytes</i>, big-endian
+ */
+inline void
+setBigEndian16(uint8_t* bytes, const uint16_t& value) {
+#ifdef XBEENG_SWAP16
+    uint16_t swapped = XBEENG_SWAP16(value);
+    memcpy(bytes, &swapped, 2);
+#else
+    bytes[0] = (value >> 8) & 0xff;
+    bytes[1] = value & 0xff;
+#endif
+}
+inline void
+setBigEndian32(uint8_t* bytes, const uint32_t& value) {
+#ifdef XBEENG_SWAP32
+    uint32_t swapped = XBEENG_SWAP32(value);
+    memcpy(bytes, &swapped, 4);
+#else
+    bytes[0] = (value >> 24) & 0xff;
+    bytes[1] = (value >> 16) & 0xff;
+    bytes[2] = (value >> 8) & 0xff;
+    bytes[3] = value & 0xff;
+#endif
+}
+
+/**
+ * A fixed field of a frame: its offset in the frame, as in the Digi
+ * documentation (the cmdID is at 3), and its width in bytes; 0 for
+ * the variable data that ends a frame. index is its position in the
+ * cmdData, end the cmdData length up to and including it.
+ * Every multi-byte field is big-endian on the wire.
+ * <p/>
+ * The <Frame>Schema of a frame lists its fields in order: the first
+ * is a FirstField, every other one the Next of the field before it,
+ * so they can neither overlap nor leave gaps. The *_HEAD length of
+ * the frame is the end of its last fixed field.
+ */
+template<uint8_t Offset, uint8_t Width>
+struct FrameField {
+    enum {
+        offset = Offset,
+        width = Width,
+        index = Offset - CMD_DATA_OFFSET,
+        end = Offset + Width - CMD_DATA_OFFSET
+    };
+    // the field of W bytes that follows this one
+    template<uint8_t W> using Next = FrameField<Offset + Width, W>;
+};
+// the field of Width bytes right after the cmdID
+template<uint8_t Width> using FirstField = FrameField<CMD_DATA_OFFSET, Width>;
+
+/**
+ * Reads and writes a field of 1, 2 or 4 bytes in host order
+ */
+template<uint8_t Width> struct FieldValue;
+template<> struct FieldValue<1> {
+    typedef uint8_t type;
+    static uint8_t get(const uint8_t* bytes) { return bytes[0]; }
+    static void set(uint8_t* bytes, const uint8_t& value) { bytes[0] = value; }
+};
+template<> struct FieldValue<2> {
+    typedef uint16_t type;
+    static uint16_t get(const uint8_t* bytes) { return getBigEndian16(bytes); }
+    static void set(uint8_t* bytes, const uint16_t& value) { setBigEndian16(bytes, value); }
+};
+template<> struct FieldValue<4> {
+    typedef uint32_t type;
+    static uint32_t get(const uint8_t* bytes) { return getBigEndian32(bytes); }
+    static void set(uint8_t* bytes, const uint32_t& value) { setBigEndian32(bytes, value); }
+};
+
+/**
+ * Returns the Field of a cmdData in host order, for instance
+ * getField<TxStatusSchema::deliveryStatus>(cmdData)
+ */
+template<typename Field> inline typename FieldValue<Field::width>::type
+getField(const uint8_t* cmdData) { return FieldValue<Field::width>::get(&(cmdData[Field::index])); }
+template<typename Field> inline void
+setField(uint8_t* cmdData, const typename FieldValue<Field::width>::type& value) {
+    FieldValue<Field::width>::set(&(cmdData[Field::index]), value);
+}
+
 /**
  * The super class of all XBee communication packet.
  * Users should never attempt to create an instance of this
@@ -197,6 +371,16 @@ public:
      */
     uint8_t getErrorCode();
     void setErrorCode(const uint8_t& errorCode);
+    /**
+     * Returns a Field of the frame, from its <Frame>Schema, in host
+     * order: get<TxStatusSchema::deliveryStatus>()
+     */
+    template<typename Field> typename FieldValue<Field::width>::type get();
+    template<typename Field> void set(const typename FieldValue<Field::width>::type& value);
+    /**
+     * Returns true if the cmdData is long enough to hold the Field
+     */
+    template<typename Field> bool has();
 #ifdef XBEENG_WITH_EXTRAS
     /*
      */
@@ -206,6 +390,10 @@ protected:
     uint8_t _cmdId;
     uint8_t* _cmdData;
 
+    // makes room for tailLength bytes after the first headLength ones
+    // (the fixed fields, kept), reallocating the cmdData if needed
+    void resizeTail(const uint16_t& headLength, const uint16_t& tailLength);
+
 private:
     uint8_t _msbLength;
     uint8_t _lsbLength;
@@ -217,6 +405,103 @@ private:
     void printHex(Stream& strm, const uint8_t& hex);
 };
 
+// Accessors of the frames are inline: reading a field is a load, not a call
+inline uint8_t
+XBeeApiFrame::getMsbLength() { return _msbLength; }
+inline void
+XBeeApiFrame::setMsbLength(const uint8_t& msbLength) { _msbLength = msbLength; }
+
+inline uint8_t
+XBeeApiFrame::getLsbLength() { return _lsbLength; }
+inline void
+XBeeApiFrame::setLsbLength(const uint8_t& lsbLength) { _lsbLength = lsbLength; }
+
+inline uint16_t
+XBeeApiFrame::getFrameDataLength() {
+    return ((_msbLength << 8) & 0xffff) + (_lsbLength & 0xff);
+}
+inline void
+XBeeApiFrame::setFrameDataLength(const uint16_t& frameDataLength) {
+    _msbLength = 0xff & (frameDataLength >> 8);
+    _lsbLength = 0xff & frameDataLength;
+}
+
+inline uint8_t
+XBeeApiFrame::getCmdId() { return _cmdId; }
+inline void
+XBeeApiFrame::setCmdId(const uint8_t& cmdId) { _cmdId = cmdId; }
+
+inline uint16_t
+XBeeApiFrame::getCmdDataLength() {
+    uint16_t frameDataLength = getFrameDataLength();
+    if (frameDataLength == 0) return 0;
+    return frameDataLength - 1;
+}
+inline void
+XBeeApiFrame::setCmdDataLength(const uint16_t& cmdDataLength) {
+    setFrameDataLength(cmdDataLength + 1);
+}
+
+inline uint8_t*
+XBeeApiFrame::getCmdData() { return _cmdData; }
+inline void
+XBeeApiFrame::setCmdData(uint8_t* cmdData) { _cmdData = cmdData; }
+
+inline uint8_t
+XBeeApiFrame::getChecksum() { return _checksum; }
+inline void
+XBeeApiFrame::setChecksum(const uint8_t& checksum) { _checksum = checksum; }
+
+inline bool
+XBeeApiFrame::isReady() { return _ready; }
+inline void
+XBeeApiFrame::setReady(const bool& ready) { _ready = ready; }
+
+inline bool
+XBeeApiFrame::hasErrors() { return _errorCode > 0; }
+inline uint8_t
+XBeeApiFrame::getErrorCode() { return _errorCode; }
+inline void
+XBeeApiFrame::setErrorCode(const uint8_t& errorCode) { _errorCode = errorCode; }
+
+template<typename Field> inline typename FieldValue<Field::width>::type
+XBeeApiFrame::get() { return getField<Field>(_cmdData); }
+template<typename Field> inline void
+XBeeApiFrame::set(const typename FieldValue<Field::width>::type& value) { setField<Field>(_cmdData, value); }
+template<typename Field> inline bool
+XBeeApiFrame::has() { return getCmdDataLength() >= Field::end; }
+
+/**
+ * Frame over a buffer it does not own (a queue slot, an array on the
+ * stack): unlike XBeeApiFrame it does not delete its cmdData
+ */
+class XBeeApiFrameView : public XBeeApiFrame {
+public:
+    XBeeApiFrameView(uint8_t* cmdData);
+    /**
+     * Sets the length and the checksum too
+     */
+    XBeeApiFrameView(const uint8_t& cmdId, uint8_t* cmdData, const uint16_t& cmdDataLength);
+    ~XBeeApiFrameView();
+};
+
+inline
+XBeeApiFrameView::XBeeApiFrameView(uint8_t* cmdData) { _cmdData = cmdData; }
+inline
+XBeeApiFrameView::XBeeApiFrameView(const uint8_t& cmdId, uint8_t* cmdData, const uint16_t& cmdDataLength) {
+    _cmdId = cmdId;
+    _cmdData = cmdData;
+    setCmdDataLength(cmdDataLength);
+    setChecksum();
+}
+inline
+XBeeApiFrameView::~XBeeApiFrameView() { _cmdData = nullptr; }
+
+struct TxRxXBeeApiFrameSchema {
+    typedef FirstField<4> address64Msb;
+    typedef address64Msb::Next<4> address64Lsb;
+    typedef address64Lsb::Next<2> address16;
+};
 class TxRxXBeeApiFrame : public XBeeApiFrame {
 public:
     uint32_t getAddress64Msb();
@@ -224,18 +509,38 @@ public:
     uint16_t getAddress16();
 };
 
+inline uint32_t
+TxRxXBeeApiFrame::getAddress64Msb() { return get<TxRxXBeeApiFrameSchema::address64Msb>(); }
+inline uint32_t
+TxRxXBeeApiFrame::getAddress64Lsb() { return get<TxRxXBeeApiFrameSchema::address64Lsb>(); }
+inline uint16_t
+TxRxXBeeApiFrame::getAddress16() { return get<TxRxXBeeApiFrameSchema::address16>(); }
+
 /**
  * This class is extended by all frame descriptions
  * that include a frame id
  */
-#define FRAME_ID_HEAD 1
+struct FrameIdDescriptionSchema {
+    typedef FirstField<1> frameId;
+};
+#define FRAME_ID_HEAD FrameIdDescriptionSchema::frameId::end
 class FrameIdDescription : public XBeeApiFrame {
 public:
     uint8_t getFrameId();
     void setFrameId(const uint8_t& frameId);
 };
 
-#define TXRX_FRAME_ID_HEAD 11
+inline uint8_t
+FrameIdDescription::getFrameId() { return get<FrameIdDescriptionSchema::frameId>(); }
+inline void
+FrameIdDescription::setFrameId(const uint8_t& frameId) { set<FrameIdDescriptionSchema::frameId>(frameId); }
+
+struct TxRxFrameIdDescriptionSchema : FrameIdDescriptionSchema {
+    typedef frameId::Next<4> address64Msb;
+    typedef address64Msb::Next<4> address64Lsb;
+    typedef address64Lsb::Next<2> address16;
+};
+#define TXRX_FRAME_ID_HEAD TxRxFrameIdDescriptionSchema::address16::end
 class TxRxFrameIdDescription : public FrameIdDescription {
 public:
     uint32_t getAddress64Msb();
@@ -249,7 +554,21 @@ protected:
     void setAddress16(const uint16_t& address16, bool performChecksum);
 };
 
-#define TX_64_REQUEST_HEAD 10
+inline uint32_t
+TxRxFrameIdDescription::getAddress64Msb() { return get<TxRxFrameIdDescriptionSchema::address64Msb>(); }
+inline uint32_t
+TxRxFrameIdDescription::getAddress64Lsb() { return get<TxRxFrameIdDescriptionSchema::address64Lsb>(); }
+
+inline uint16_t
+TxRxFrameIdDescription::getAddress16() { return get<TxRxFrameIdDescriptionSchema::address16>(); }
+
+struct Tx64RequestSchema : FrameIdDescriptionSchema {
+    typedef frameId::Next<4> address64Msb;
+    typedef address64Msb::Next<4> address64Lsb;
+    typedef address64Lsb::Next<1> options;
+    typedef options::Next<0> data;
+};
+#define TX_64_REQUEST_HEAD Tx64RequestSchema::data::end
 class Tx64Request : public TxRxFrameIdDescription {
 private:
     uint16_t getAddress16();
@@ -298,7 +617,21 @@ private:
 #endif
 };
 
-#define TX_16_REQUEST_HEAD 4
+inline uint8_t
+Tx64Request::getOptions() { return get<Tx64RequestSchema::options>(); }
+
+inline uint8_t*
+Tx64Request::getData() { return &(_cmdData[Tx64RequestSchema::data::index]); }
+
+inline uint16_t
+Tx64Request::getDataLength() { return getCmdDataLength() - TX_64_REQUEST_HEAD; }
+
+struct Tx16RequestSchema : FrameIdDescriptionSchema {
+    typedef frameId::Next<2> address16;
+    typedef address16::Next<1> options;
+    typedef options::Next<0> data;
+};
+#define TX_16_REQUEST_HEAD Tx16RequestSchema::data::end
 class Tx16Request : public FrameIdDescription {
 public:
     Tx16Request(const uint8_t& frameId,
@@ -345,7 +678,23 @@ private:
 #endif
 };
 
-#define AT_COMMAND_HEAD 3
+inline uint16_t
+Tx16Request::getAddress16() { return get<Tx16RequestSchema::address16>(); }
+
+inline uint8_t
+Tx16Request::getOptions() { return get<Tx16RequestSchema::options>(); }
+
+inline uint8_t*
+Tx16Request::getData() { return &(_cmdData[Tx16RequestSchema::data::index]); }
+
+inline uint16_t
+Tx16Request::getDataLength() { return getCmdDataLength() - TX_16_REQUEST_HEAD; }
+
+struct AtCommandSchema : FrameIdDescriptionSchema {
+    typedef frameId::Next<2> cmd;
+    typedef cmd::Next<0> param;
+};
+#define AT_COMMAND_HEAD AtCommandSchema::param::end
 class AtCommand : public FrameIdDescription {
 public:
     AtCommand(const uint8_t& frameId, const uint8_t* data, const uint16_t& dataLength);
@@ -359,6 +708,10 @@ public:
     AtCommand(const uint8_t& frameId, const char (&cmd)[3], const std::initializer_list<uint8_t>& param);
 #endif
 
+    /**
+     * Returns the command with its first character in the high byte,
+     * ('N' << 8) | 'I' for NI
+     */
     uint16_t getCmd();
     void setCmd(const uint16_t& cmd);
     void setCmd(const char (&cmd)[3]);
@@ -387,7 +740,16 @@ private:
 #endif
 };
 
-#define AT_QUEUE_COMMAND_HEAD 3
+inline uint16_t
+AtCommand::getCmd() { return get<AtCommandSchema::cmd>(); }
+
+inline uint8_t*
+AtCommand::getParam() { return &(_cmdData[AtCommandSchema::param::index]); }
+
+inline uint16_t
+AtCommand::getParamLength() { return getCmdDataLength() - AT_COMMAND_HEAD; }
+
+#define AT_QUEUE_COMMAND_HEAD AT_COMMAND_HEAD
 class AtQueueCommand : public AtCommand {
 public:
     AtQueueCommand(const uint8_t& frameId, const uint8_t* data, const uint16_t& dataLength);
@@ -397,9 +759,14 @@ public:
     AtQueueCommand(const uint8_t& frameId, const uint16_t& cmd, const uint8_t* param, const uint16_t& paramLength);
 };
 
-#define TX_REQUEST_HEAD 13
 #define BROADCAST_ADDRESS16 0xfffe
 #define BROADCAST_ADDRESS64 0xffff
+struct TxRequestSchema : TxRxFrameIdDescriptionSchema {
+    typedef address16::Next<1> broadcast;
+    typedef broadcast::Next<1> options;
+    typedef options::Next<0> data;
+};
+#define TX_REQUEST_HEAD TxRequestSchema::data::end
 class TxRequest : public TxRxFrameIdDescription {
 public:
     TxRequest(const uint8_t& frameId,
@@ -467,7 +834,28 @@ private:
 #endif
 };
 
-#define EXPLICIT_TX_REQUEST_HEAD 19
+inline uint8_t
+TxRequest::getBroadcast() { return get<TxRequestSchema::broadcast>(); }
+
+inline uint8_t
+TxRequest::getOptions() { return get<TxRequestSchema::options>(); }
+
+inline uint8_t*
+TxRequest::getData() { return &(_cmdData[TxRequestSchema::data::index]); }
+
+inline uint16_t
+TxRequest::getDataLength() { return getCmdDataLength() - TX_REQUEST_HEAD; }
+
+struct ExplicitTxRequestSchema : TxRxFrameIdDescriptionSchema {
+    typedef address16::Next<1> sourceEndpoint;
+    typedef sourceEndpoint::Next<1> destinationEndpoint;
+    typedef destinationEndpoint::Next<2> clusterId;
+    typedef clusterId::Next<2> profileId;
+    typedef profileId::Next<1> broadcast;
+    typedef broadcast::Next<1> options;
+    typedef options::Next<0> data;
+};
+#define EXPLICIT_TX_REQUEST_HEAD ExplicitTxRequestSchema::data::end
 class ExplicitTxRequest : public TxRxFrameIdDescription {
 public:
     ExplicitTxRequest(const uint8_t& frameId,
@@ -581,7 +969,35 @@ private:
 #endif
 };
 
-#define REMOTE_AT_COMMAND_HEAD 14
+inline uint8_t
+ExplicitTxRequest::getSourceEndpoint() { return get<ExplicitTxRequestSchema::sourceEndpoint>(); }
+
+inline uint8_t
+ExplicitTxRequest::getDestinationEndpoint() { return get<ExplicitTxRequestSchema::destinationEndpoint>(); }
+
+inline uint16_t
+ExplicitTxRequest::getClusterId() { return get<ExplicitTxRequestSchema::clusterId>(); }
+
+inline uint16_t
+ExplicitTxRequest::getProfileId() { return get<ExplicitTxRequestSchema::profileId>(); }
+
+inline uint8_t
+ExplicitTxRequest::getBroadcast() { return get<ExplicitTxRequestSchema::broadcast>(); }
+
+inline uint8_t
+ExplicitTxRequest::getOptions() { return get<ExplicitTxRequestSchema::options>(); }
+
+inline uint8_t*
+ExplicitTxRequest::getData() { return &_cmdData[ExplicitTxRequestSchema::data::index]; }
+inline uint16_t
+ExplicitTxRequest::getDataLength() { return getCmdDataLength() - EXPLICIT_TX_REQUEST_HEAD; }
+
+struct RemoteAtCommandSchema : TxRxFrameIdDescriptionSchema {
+    typedef address16::Next<1> options;
+    typedef options::Next<2> cmd;
+    typedef cmd::Next<0> param;
+};
+#define REMOTE_AT_COMMAND_HEAD RemoteAtCommandSchema::param::end
 class RemoteAtCommand : public TxRxFrameIdDescription {
 public:
     RemoteAtCommand(const uint8_t& frameId,
@@ -629,6 +1045,10 @@ public:
     uint8_t getOptions();
     void setOptions(const uint8_t& options);
 
+    /**
+     * Returns the command with its first character in the high byte,
+     * ('N' << 8) | 'I' for NI
+     */
     uint16_t getCmd();
     void setCmd(const uint16_t& cmd);
     void setCmd(const char* cmd);
@@ -643,7 +1063,24 @@ private:
     void setParam(const uint8_t* param, const uint16_t& paramLength, const bool& performChecksum);
 };
 
-#define CREATE_SOURCE_ROUTE_HEAD 13
+inline uint8_t
+RemoteAtCommand::getOptions() { return get<RemoteAtCommandSchema::options>(); }
+
+inline uint16_t
+RemoteAtCommand::getCmd() { return get<RemoteAtCommandSchema::cmd>(); }
+
+inline uint8_t*
+RemoteAtCommand::getParam() { return &(_cmdData[RemoteAtCommandSchema::param::index]); }
+
+inline uint16_t
+RemoteAtCommand::getParamLength() { return getCmdDataLength() - REMOTE_AT_COMMAND_HEAD; }
+
+struct CreateSourceRouteSchema : TxRxFrameIdDescriptionSchema {
+    typedef address16::Next<1> options;
+    typedef options::Next<1> nAddresses;
+    typedef nAddresses::Next<0> addresses;
+};
+#define CREATE_SOURCE_ROUTE_HEAD CreateSourceRouteSchema::addresses::end
 class CreateSourceRoute : public TxRxFrameIdDescription {
 public:
     CreateSourceRoute(const uint8_t& frameId,
@@ -668,7 +1105,13 @@ public:
     const std::initializer_list<uint16_t>& addresses);
 #endif
 
-    uint16_t* getAddresses();
+    /**
+     * Returns the bytes of the addresses as they are on the wire,
+     * two per address, big-endian; getAddress(i) returns one in host
+     * order
+     */
+    const uint8_t* getAddresses();
+    uint16_t getAddress(const uint8_t& i);
     void setAddresses(const uint16_t* addresses, const uint8_t& nAddresses);
 #ifdef XBEENG_WITH_EXTRAS
     void setAddresses(const std::initializer_list<uint16_t>& addresses);
@@ -681,7 +1124,19 @@ private:
 #endif
 };
 
-#define REGISTER_JOINING_DEVICE_HEAD 12
+inline const uint8_t*
+CreateSourceRoute::getAddresses() { return &(_cmdData[CreateSourceRouteSchema::addresses::index]); }
+inline uint16_t
+CreateSourceRoute::getAddress(const uint8_t& i) { return getBigEndian16(&(_cmdData[CreateSourceRouteSchema::addresses::index+2*i])); }
+
+inline uint8_t
+CreateSourceRoute::getNAddresses() { return get<CreateSourceRouteSchema::nAddresses>(); }
+
+struct RegisterJoiningDeviceSchema : TxRxFrameIdDescriptionSchema {
+    typedef address16::Next<1> options;
+    typedef options::Next<0> key;
+};
+#define REGISTER_JOINING_DEVICE_HEAD RegisterJoiningDeviceSchema::key::end
 class RegisterJoiningDevice : public TxRxFrameIdDescription {
 public:
     RegisterJoiningDevice(const uint8_t& frameId,
@@ -714,7 +1169,22 @@ private:
 #endif
 };
 
-#define RX_64_RESPONSE_HEAD 10
+inline uint8_t
+RegisterJoiningDevice::getOptions() { return get<RegisterJoiningDeviceSchema::options>(); }
+
+inline uint8_t*
+RegisterJoiningDevice::getKey() { return &(_cmdData[RegisterJoiningDeviceSchema::key::index]); }
+inline uint16_t
+RegisterJoiningDevice::getKeyLength() { return getCmdDataLength() - REGISTER_JOINING_DEVICE_HEAD; }
+
+struct Rx64ResponseSchema {
+    typedef FirstField<4> address64Msb;
+    typedef address64Msb::Next<4> address64Lsb;
+    typedef address64Lsb::Next<1> rssi;
+    typedef rssi::Next<1> options;
+    typedef options::Next<0> data;
+};
+#define RX_64_RESPONSE_HEAD Rx64ResponseSchema::data::end
 class Rx64Response : public TxRxXBeeApiFrame {
 private:
     uint16_t getAddress16();
@@ -726,7 +1196,23 @@ public:
     uint16_t getDataLength();
 };
 
-#define RX_16_RESPONSE_HEAD 4
+inline uint8_t
+Rx64Response::getRssi() { return get<Rx64ResponseSchema::rssi>(); }
+inline uint8_t
+Rx64Response::getOptions() { return get<Rx64ResponseSchema::options>(); }
+
+inline uint8_t*
+Rx64Response::getData() { return &(_cmdData[Rx64ResponseSchema::data::index]); }
+inline uint16_t
+Rx64Response::getDataLength() { return getCmdDataLength() - RX_64_RESPONSE_HEAD; }
+
+struct Rx16ResponseSchema {
+    typedef FirstField<2> address16;
+    typedef address16::Next<1> rssi;
+    typedef rssi::Next<1> options;
+    typedef options::Next<0> data;
+};
+#define RX_16_RESPONSE_HEAD Rx16ResponseSchema::data::end
 class Rx16Response : public XBeeApiFrame {
 public:
     uint16_t getAddress16();
@@ -738,7 +1224,24 @@ public:
     uint16_t getDataLength();
 };
 
-#define RX_64_DATA_SAMPLE_HEAD 15
+inline uint16_t
+Rx16Response::getAddress16() { return get<Rx16ResponseSchema::address16>(); }
+inline uint8_t
+Rx16Response::getRssi() { return get<Rx16ResponseSchema::rssi>(); }
+inline uint8_t
+Rx16Response::getOptions() { return get<Rx16ResponseSchema::options>(); }
+
+inline uint8_t*
+Rx16Response::getData() { return &(_cmdData[Rx16ResponseSchema::data::index]); }
+inline uint16_t
+Rx16Response::getDataLength() { return getCmdDataLength() - RX_16_RESPONSE_HEAD; }
+
+struct Rx64DataSampleSchema : Rx64ResponseSchema {
+    typedef data::Next<1> nSamples;
+    typedef nSamples::Next<2> digitalMask;
+    typedef digitalMask::Next<2> digitalSamples;
+};
+#define RX_64_DATA_SAMPLE_HEAD Rx64DataSampleSchema::digitalSamples::end
 class Rx64DataSample : public Rx64Response {
 private:
     uint8_t* getData();
@@ -751,11 +1254,31 @@ public:
 
     uint16_t getDigitalSamples();
 
-    uint16_t* getAnalogSamples();
+    /**
+     * Returns the bytes of the analog samples as they are on the wire,
+     * two per sample, big-endian; getAnalogSample(i) returns one in
+     * host order
+     */
+    const uint8_t* getAnalogSamples();
+    uint16_t getAnalogSample(const uint16_t& i);
     uint16_t getAnalogSamplesLength();
 };
 
-#define RX_16_DATA_SAMPLE_HEAD 9
+inline uint8_t
+Rx64DataSample::getNSamples() { return get<Rx64DataSampleSchema::nSamples>(); }
+inline uint16_t
+Rx64DataSample::getDigitalMask() { return get<Rx64DataSampleSchema::digitalMask>() & 0x1FF; }
+inline uint8_t
+Rx64DataSample::getAnalogMask() { return (get<Rx64DataSampleSchema::digitalMask>() >> 9) & 0x3F; }
+inline uint16_t
+Rx64DataSample::getAnalogSample(const uint16_t& i) { return getBigEndian16(&(getAnalogSamples()[2*i])); }
+
+struct Rx16DataSampleSchema : Rx16ResponseSchema {
+    typedef data::Next<1> nSamples;
+    typedef nSamples::Next<2> digitalMask;
+    typedef digitalMask::Next<2> digitalSamples;
+};
+#define RX_16_DATA_SAMPLE_HEAD Rx16DataSampleSchema::digitalSamples::end
 class Rx16DataSample : public Rx16Response {
 private:
     uint8_t* getData();
@@ -768,13 +1291,37 @@ public:
 
     uint16_t getDigitalSamples();
 
-    uint16_t* getAnalogSamples();
+    /**
+     * Returns the bytes of the analog samples as they are on the wire,
+     * two per sample, big-endian; getAnalogSample(i) returns one in
+     * host order
+     */
+    const uint8_t* getAnalogSamples();
+    uint16_t getAnalogSample(const uint16_t& i);
     uint16_t getAnalogSamplesLength();
 };
 
-#define AT_COMMAND_RESPONSE_HEAD 4
+inline uint8_t
+Rx16DataSample::getNSamples() { return get<Rx16DataSampleSchema::nSamples>(); }
+inline uint16_t
+Rx16DataSample::getDigitalMask() { return get<Rx16DataSampleSchema::digitalMask>() & 0x1FF; }
+inline uint8_t
+Rx16DataSample::getAnalogMask() { return (get<Rx16DataSampleSchema::digitalMask>() >> 9) & 0x3F; }
+inline uint16_t
+Rx16DataSample::getAnalogSample(const uint16_t& i) { return getBigEndian16(&(getAnalogSamples()[2*i])); }
+
+struct AtCommandResponseSchema : FrameIdDescriptionSchema {
+    typedef frameId::Next<2> cmd;
+    typedef cmd::Next<1> status;
+    typedef status::Next<0> data;
+};
+#define AT_COMMAND_RESPONSE_HEAD AtCommandResponseSchema::data::end
 class AtCommandResponse : public FrameIdDescription {
 public:
+    /**
+     * Returns the command with its first character in the high byte,
+     * ('N' << 8) | 'I' for NI
+     */
     uint16_t getCmd();
     uint8_t getStatus();
 
@@ -782,19 +1329,48 @@ public:
     uint16_t getDataLength();
 };
 
-#define TX_STATUS_RESPONSE_HEAD 2
+inline uint16_t
+AtCommandResponse::getCmd() { return get<AtCommandResponseSchema::cmd>(); }
+
+inline uint8_t
+AtCommandResponse::getStatus() { return get<AtCommandResponseSchema::status>(); }
+
+inline uint8_t*
+AtCommandResponse::getData() { return &(_cmdData[AtCommandResponseSchema::data::index]); }
+inline uint16_t
+AtCommandResponse::getDataLength() { return getCmdDataLength() - AT_COMMAND_RESPONSE_HEAD; }
+
+struct TxStatusResponseSchema : FrameIdDescriptionSchema {
+    typedef frameId::Next<1> status;
+};
+#define TX_STATUS_RESPONSE_HEAD TxStatusResponseSchema::status::end
 class TxStatusResponse : public FrameIdDescription {
 public:
     uint8_t getStatus();
 };
 
-#define MODEM_STATUS_HEAD 1
+inline uint8_t
+TxStatusResponse::getStatus() { return get<TxStatusResponseSchema::status>(); }
+
+struct ModemStatusSchema {
+    typedef FirstField<1> status;
+};
+#define MODEM_STATUS_HEAD ModemStatusSchema::status::end
 class ModemStatus : public XBeeApiFrame {
 public:
     uint8_t getStatus();
 };
 
-#define TX_STATUS_HEAD 6
+inline uint8_t
+ModemStatus::getStatus() { return get<ModemStatusSchema::status>(); }
+
+struct TxStatusSchema : FrameIdDescriptionSchema {
+    typedef frameId::Next<2> address16;
+    typedef address16::Next<1> retryCount;
+    typedef retryCount::Next<1> deliveryStatus;
+    typedef deliveryStatus::Next<1> discoveryStatus;
+};
+#define TX_STATUS_HEAD TxStatusSchema::discoveryStatus::end
 class TxStatus : public FrameIdDescription {
 public:
     uint16_t getAddress16();
@@ -803,7 +1379,32 @@ public:
     uint8_t getDiscoveryStatus();
 };
 
-#define ROUTE_INFORMATION_HEAD 41
+inline uint16_t
+TxStatus::getAddress16() { return get<TxStatusSchema::address16>(); }
+
+inline uint8_t
+TxStatus::getRetryCount() { return get<TxStatusSchema::retryCount>(); }
+
+inline uint8_t
+TxStatus::getDiscoveryStatus() { return get<TxStatusSchema::discoveryStatus>(); }
+
+struct RouteInformationSchema {
+    typedef FirstField<1> sourceEvent;
+    typedef sourceEvent::Next<1> length;
+    typedef length::Next<4> timestamp;
+    typedef timestamp::Next<1> ackTimeoutCount;
+    typedef ackTimeoutCount::Next<1> txBlockedCount;
+    typedef txBlockedCount::Next<1> reserved;
+    typedef reserved::Next<4> destinationAddress64Msb;
+    typedef destinationAddress64Msb::Next<4> destinationAddress64Lsb;
+    typedef destinationAddress64Lsb::Next<4> sourceAddress64Msb;
+    typedef sourceAddress64Msb::Next<4> sourceAddress64Lsb;
+    typedef sourceAddress64Lsb::Next<4> responderAddress64Msb;
+    typedef responderAddress64Msb::Next<4> responderAddress64Lsb;
+    typedef responderAddress64Lsb::Next<4> receiverAddress64Msb;
+    typedef receiverAddress64Msb::Next<4> receiverAddress64Lsb;
+};
+#define ROUTE_INFORMATION_HEAD RouteInformationSchema::receiverAddress64Lsb::end
 class RouteInformation : public XBeeApiFrame {
 public:
     uint8_t getSourceEvent();
@@ -824,7 +1425,43 @@ public:
     uint32_t getReceiverAddress64Lsb();
 };
 
-#define AGGREGATE_ADDRESSING_HEAD 17
+inline uint8_t
+RouteInformation::getSourceEvent() { return get<RouteInformationSchema::sourceEvent>(); }
+inline uint8_t
+RouteInformation::getLength() { return get<RouteInformationSchema::length>(); }
+inline uint32_t
+RouteInformation::getTimestamp() { return get<RouteInformationSchema::timestamp>(); }
+inline uint8_t
+RouteInformation::getAckTimoutCount() { return get<RouteInformationSchema::ackTimeoutCount>(); }
+
+inline uint32_t
+RouteInformation::getDestinationAddress64Msb() { return get<RouteInformationSchema::destinationAddress64Msb>(); }
+inline uint32_t
+RouteInformation::getDestinationAddress64Lsb() { return get<RouteInformationSchema::destinationAddress64Lsb>(); }
+
+inline uint32_t
+RouteInformation::getSourceAddress64Msb() { return get<RouteInformationSchema::sourceAddress64Msb>(); }
+inline uint32_t
+RouteInformation::getSourceAddress64Lsb() { return get<RouteInformationSchema::sourceAddress64Lsb>(); }
+
+inline uint32_t
+RouteInformation::getResponderAddress64Msb() { return get<RouteInformationSchema::responderAddress64Msb>(); }
+inline uint32_t
+RouteInformation::getResponderAddress64Lsb() { return get<RouteInformationSchema::responderAddress64Lsb>(); }
+
+inline uint32_t
+RouteInformation::getReceiverAddress64Msb() { return get<RouteInformationSchema::receiverAddress64Msb>(); }
+inline uint32_t
+RouteInformation::getReceiverAddress64Lsb() { return get<RouteInformationSchema::receiverAddress64Lsb>(); }
+
+struct AggregateAddressingSchema {
+    typedef FirstField<1> formatId;
+    typedef formatId::Next<4> newAddress64Msb;
+    typedef newAddress64Msb::Next<4> newAddress64Lsb;
+    typedef newAddress64Lsb::Next<4> oldAddress64Msb;
+    typedef oldAddress64Msb::Next<4> oldAddress64Lsb;
+};
+#define AGGREGATE_ADDRESSING_HEAD AggregateAddressingSchema::oldAddress64Lsb::end
 class AggregateAddressing : public XBeeApiFrame {
 public:
     uint8_t getFormatId();
@@ -836,7 +1473,24 @@ public:
     uint32_t getOldAddress64Lsb();
 };
 
-#define RX_RESPONSE_HEAD 11
+inline uint8_t
+AggregateAddressing::getFormatId() { return get<AggregateAddressingSchema::formatId>(); }
+
+inline uint32_t
+AggregateAddressing::getNewAddress64Msb() { return get<AggregateAddressingSchema::newAddress64Msb>(); }
+inline uint32_t
+AggregateAddressing::getNewAddress64Lsb() { return get<AggregateAddressingSchema::newAddress64Lsb>(); }
+
+inline uint32_t
+AggregateAddressing::getOldAddress64Msb() { return get<AggregateAddressingSchema::oldAddress64Msb>(); }
+inline uint32_t
+AggregateAddressing::getOldAddress64Lsb() { return get<AggregateAddressingSchema::oldAddress64Lsb>(); }
+
+struct RxResponseSchema : TxRxXBeeApiFrameSchema {
+    typedef address16::Next<1> options;
+    typedef options::Next<0> data;
+};
+#define RX_RESPONSE_HEAD RxResponseSchema::data::end
 class RxResponse : public TxRxXBeeApiFrame {
 public:
     uint8_t getOptions();
@@ -845,7 +1499,23 @@ public:
     uint16_t getDataLength();
 };
 
-#define EXPLICIT_RX_RESPONSE_HEAD 17
+inline uint8_t
+RxResponse::getOptions() { return get<RxResponseSchema::options>(); }
+
+inline uint8_t*
+RxResponse::getData() { return &(_cmdData[RxResponseSchema::data::index]); }
+inline uint16_t
+RxResponse::getDataLength() { return getCmdDataLength() - RX_RESPONSE_HEAD; }
+
+struct ExplicitRxResponseSchema : TxRxXBeeApiFrameSchema {
+    typedef address16::Next<1> sourceEndpoint;
+    typedef sourceEndpoint::Next<1> destinationEndpoint;
+    typedef destinationEndpoint::Next<2> clusterId;
+    typedef clusterId::Next<2> profileId;
+    typedef profileId::Next<1> options;
+    typedef options::Next<0> data;
+};
+#define EXPLICIT_RX_RESPONSE_HEAD ExplicitRxResponseSchema::data::end
 class ExplicitRxResponse : public TxRxXBeeApiFrame {
 public:
     uint8_t getSourceEndpoint();
@@ -860,7 +1530,30 @@ public:
     uint16_t getDataLength();
 };
 
-#define RX_DATA_SAMPLE_HEAD 17
+inline uint8_t
+ExplicitRxResponse::getSourceEndpoint() { return get<ExplicitRxResponseSchema::sourceEndpoint>(); }
+inline uint8_t
+ExplicitRxResponse::getDestinationEndpoint() { return get<ExplicitRxResponseSchema::destinationEndpoint>(); }
+inline uint16_t
+ExplicitRxResponse::getClusterId() { return get<ExplicitRxResponseSchema::clusterId>(); }
+inline uint16_t
+ExplicitRxResponse::getProfileId() { return get<ExplicitRxResponseSchema::profileId>(); }
+
+inline uint8_t
+ExplicitRxResponse::getOptions() { return get<ExplicitRxResponseSchema::options>(); }
+
+inline uint8_t*
+ExplicitRxResponse::getData() { return &(_cmdData[ExplicitRxResponseSchema::data::index]); }
+inline uint16_t
+ExplicitRxResponse::getDataLength() { return getCmdDataLength() - EXPLICIT_RX_RESPONSE_HEAD; }
+
+struct RxDataSampleSchema : RxResponseSchema {
+    typedef data::Next<1> nSamples;
+    typedef nSamples::Next<2> digitalMask;
+    typedef digitalMask::Next<1> analogMask;
+    typedef analogMask::Next<2> digitalSamples;
+};
+#define RX_DATA_SAMPLE_HEAD RxDataSampleSchema::digitalSamples::end
 class RxDataSample : public RxResponse {
 private:
     uint8_t* getData();
@@ -873,21 +1566,75 @@ public:
 
     uint16_t getDigitalSamples();
 
-    uint16_t* getAnalogSamples();
+    /**
+     * Returns the bytes of the analog samples as they are on the wire,
+     * two per sample, big-endian; getAnalogSample(i) returns one in
+     * host order
+     */
+    const uint8_t* getAnalogSamples();
+    uint16_t getAnalogSample(const uint16_t& i);
     uint16_t getAnalogSamplesLength();
 };
 
-#define RX_SENSOR_READ_HEAD 22
+inline uint8_t
+RxDataSample::getNSamples() { return get<RxDataSampleSchema::nSamples>(); }
+inline uint16_t
+RxDataSample::getDigitalMask() { return get<RxDataSampleSchema::digitalMask>(); }
+inline uint8_t
+RxDataSample::getAnalogMask() { return get<RxDataSampleSchema::analogMask>(); }
+inline uint16_t
+RxDataSample::getAnalogSample(const uint16_t& i) { return getBigEndian16(&(getAnalogSamples()[2*i])); }
+
+struct RxSensorReadSchema : TxRxXBeeApiFrameSchema {
+    typedef address16::Next<1> options;
+    typedef options::Next<1> oneWireSensors;
+    typedef oneWireSensors::Next<8> adValues;
+    typedef adValues::Next<2> temp;
+};
+#define RX_SENSOR_READ_HEAD RxSensorReadSchema::temp::end
 class RxSensorRead : public TxRxXBeeApiFrame {
 public:
     uint8_t getOptions();
     uint8_t get1WireSensors();
 
-    uint16_t* getADValues();
+    /**
+     * Returns the bytes of the four A/D values as they are on the wire,
+     * two per value, big-endian; getADValue(i) returns one in host order
+     */
+    const uint8_t* getADValues();
+    uint16_t getADValue(const uint8_t& i);
     uint16_t getTemp();
 };
 
-#define RX_NODE_ID_HEAD 29
+inline uint8_t
+RxSensorRead::getOptions() { return get<RxSensorReadSchema::options>(); }
+inline uint8_t
+RxSensorRead::get1WireSensors() { return get<RxSensorReadSchema::oneWireSensors>(); }
+
+inline const uint8_t*
+RxSensorRead::getADValues() { return &(_cmdData[RxSensorReadSchema::adValues::index]); }
+inline uint16_t
+RxSensorRead::getADValue(const uint8_t& i) { return getBigEndian16(&(_cmdData[RxSensorReadSchema::adValues::index+2*i])); }
+inline uint16_t
+RxSensorRead::getTemp() { return get<RxSensorReadSchema::temp>(); }
+
+struct RxNodeIdSchema : RxResponseSchema {
+    typedef data::Next<2> sourceAddress16;
+    typedef sourceAddress16::Next<4> networkAddress64Msb;
+    typedef networkAddress64Msb::Next<4> networkAddress64Lsb;
+    // the NI and its terminator, with an empty NI
+    typedef networkAddress64Lsb::Next<1> ni;
+    // after the NI: offsets with an empty NI, add the NI length
+    typedef ni::Next<2> parentAddress16;
+    typedef parentAddress16::Next<1> type;
+    typedef type::Next<1> sourceEvent;
+    typedef sourceEvent::Next<2> digiProfileId;
+    typedef digiProfileId::Next<2> digiManufacturerId;
+    typedef digiManufacturerId::Next<4> digiDd;
+    typedef digiDd::Next<1> rssi;
+};
+// the NI terminator is not counted in RX_NODE_ID_HEAD
+#define RX_NODE_ID_HEAD (RxNodeIdSchema::digiManufacturerId::end - 1)
 class RxNodeId : public RxResponse {
 private:
     uint8_t* getData();
@@ -913,9 +1660,122 @@ public:
     uint8_t getRssi();
 };
 
-#define REMOTE_AT_COMMAND_RESPONSE_HEAD 14
+inline uint16_t
+RxNodeId::getSourceAddress16() { return get<RxNodeIdSchema::sourceAddress16>(); }
+inline uint32_t
+RxNodeId::getNetworkAddress64Msb() { return get<RxNodeIdSchema::networkAddress64Msb>(); }
+inline uint32_t
+RxNodeId::getNetworkAddress64Lsb() { return get<RxNodeIdSchema::networkAddress64Lsb>(); }
+
+inline uint8_t*
+RxNodeId::getNi() { return &(_cmdData[RxNodeIdSchema::ni::index]); }
+
+inline uint16_t
+RxNodeId::getParentAddress16() { return getField<RxNodeIdSchema::parentAddress16>(_cmdData+getNiLength()); }
+inline uint8_t
+RxNodeId::getType() { return getField<RxNodeIdSchema::type>(_cmdData+getNiLength()); }
+inline uint8_t
+RxNodeId::getSourceEvent() { return getField<RxNodeIdSchema::sourceEvent>(_cmdData+getNiLength()); }
+inline uint16_t
+RxNodeId::getDigiProfileId() { return getField<RxNodeIdSchema::digiProfileId>(_cmdData+getNiLength()); }
+inline uint16_t
+RxNodeId::getDigiManufacturerId() { return getField<RxNodeIdSchema::digiManufacturerId>(_cmdData+getNiLength()); }
+
+/**
+ * RxNodeId fields decoded in one pass: parse(...) finds the end of
+ * the NI string once, checks the frame is long enough for the fields
+ * after it, and the getters read at their offsets plus the NI length.
+ * The values are those of the RxNodeId getters; the view points into
+ * the frame, so it is valid until the frame is read again.
+ */
+class RxNodeIdView {
+public:
+    RxNodeIdView();
+    /**
+     * Returns false if <i>frame</i> is not an RxNodeId, its NI is not
+     * terminated or it is shorter than the mandatory fields
+     */
+    bool parse(XBeeApiFrame& frame);
+    bool isValid();
+
+    uint8_t getOptions();
+    uint16_t getSourceAddress16();
+    uint32_t getNetworkAddress64Msb();
+    uint32_t getNetworkAddress64Lsb();
+
+    uint8_t* getNi();
+    uint16_t getNiLength();
+
+    uint16_t getParentAddress16();
+    uint8_t getType();
+    uint8_t getSourceEvent();
+    uint16_t getDigiProfileId();
+    uint16_t getDigiManufacturerId();
+
+    /**
+     * Returns true if the frame has the optional Digi DD value
+     * (and RSSI)
+     */
+    bool hasDigiDd();
+    bool hasRssi();
+    uint32_t getDigiDd();
+    uint8_t getRssi();
+private:
+    uint8_t* _cmdData;
+    uint16_t _niLength;
+    bool _hasDigiDd;
+    bool _hasRssi;
+};
+
+inline bool
+RxNodeIdView::isValid() { return _cmdData != nullptr; }
+
+inline uint8_t
+RxNodeIdView::getOptions() { return getField<RxNodeIdSchema::options>(_cmdData); }
+inline uint16_t
+RxNodeIdView::getSourceAddress16() { return getField<RxNodeIdSchema::sourceAddress16>(_cmdData); }
+inline uint32_t
+RxNodeIdView::getNetworkAddress64Msb() { return getField<RxNodeIdSchema::networkAddress64Msb>(_cmdData); }
+inline uint32_t
+RxNodeIdView::getNetworkAddress64Lsb() { return getField<RxNodeIdSchema::networkAddress64Lsb>(_cmdData); }
+
+inline uint8_t*
+RxNodeIdView::getNi() { return &(_cmdData[RxNodeIdSchema::ni::index]); }
+inline uint16_t
+RxNodeIdView::getNiLength() { return _niLength; }
+
+inline uint16_t
+RxNodeIdView::getParentAddress16() { return getField<RxNodeIdSchema::parentAddress16>(_cmdData+_niLength); }
+inline uint8_t
+RxNodeIdView::getType() { return getField<RxNodeIdSchema::type>(_cmdData+_niLength); }
+inline uint8_t
+RxNodeIdView::getSourceEvent() { return getField<RxNodeIdSchema::sourceEvent>(_cmdData+_niLength); }
+inline uint16_t
+RxNodeIdView::getDigiProfileId() { return getField<RxNodeIdSchema::digiProfileId>(_cmdData+_niLength); }
+inline uint16_t
+RxNodeIdView::getDigiManufacturerId() { return getField<RxNodeIdSchema::digiManufacturerId>(_cmdData+_niLength); }
+
+inline bool
+RxNodeIdView::hasDigiDd() { return _hasDigiDd; }
+inline bool
+RxNodeIdView::hasRssi() { return _hasRssi; }
+inline uint32_t
+RxNodeIdView::getDigiDd() { return _hasDigiDd ? getField<RxNodeIdSchema::digiDd>(_cmdData+_niLength) : 0; }
+inline uint8_t
+RxNodeIdView::getRssi() { return _hasRssi ? getField<RxNodeIdSchema::rssi>(_cmdData+_niLength) : 0; }
+
+struct RemoteAtCommandResponseSchema : TxRxFrameIdDescriptionSchema {
+    typedef address16::Next<2> cmd;
+    typedef cmd::Next<1> status;
+    typedef status::Next<0> data;
+};
+#define REMOTE_AT_COMMAND_RESPONSE_HEAD RemoteAtCommandResponseSchema::data::end
 class RemoteAtCommandResponse : public TxRxFrameIdDescription {
 public:
+    /**
+     * Returns the command with its first character in the high byte,
+     * ('N' << 8) | 'I' for NI
+     */
     uint16_t getCmd();
     uint8_t getStatus();
 
@@ -923,66 +1783,703 @@ public:
     uint16_t getDataLength();
 };
 
-/**
- * Primary interface for communicating with an XBee Radio.
- * This class provides methods for sending and receiving
- * packets with an XBee radio via the serial port.
- * The XBee radio must be configured in API (packet) mode (AP=2)
- * in order to use this software.
- * <p/>
- * Since this code is designed to run on a microcontroller,
- * with only one thread, you are responsible for reading the
- * data of the serial buffer in a timely manner.  This involves
- * a call to a variant of readPacket(...).
- * If your serial port is receiving data faster than you are
- * reading, you can expect to lose packets.
- * <p/>
- * In order to conserve resources, this class only supports
- * storing one response packet in memory at a time.
- * This means that you must fully consume the packet prior to
- * calling readPacket(...), because calling readPacket(...)
- * overwrites the previous response.
- * <p/>
- * This class creates an array of size MAX_CMD_DATA_SIZE for
- * storing the response packet.  You may want to adjust this
- * value to conserve memory.
- *
- * \author Andrew Rapp
- */
-class XBee {
+inline uint16_t
+RemoteAtCommandResponse::getCmd() { return get<RemoteAtCommandResponseSchema::cmd>(); }
+inline uint8_t
+RemoteAtCommandResponse::getStatus() { return get<RemoteAtCommandResponseSchema::status>(); }
+inline uint8_t*
+RemoteAtCommandResponse::getData() { return &(_cmdData[RemoteAtCommandResponseSchema::data::index]); }
+inline uint16_t
+RemoteAtCommandResponse::getDataLength() { return getCmdDataLength() - REMOTE_AT_COMMAND_RESPONSE_HEAD; }
+
+struct RxRouteRecordSchema : TxRxXBeeApiFrameSchema {
+    typedef address16::Next<1> options;
+    typedef options::Next<1> nAddresses;
+    typedef nAddresses::Next<0> addresses;
+};
+#define RX_ROUTE_RECORD_HEAD RxRouteRecordSchema::addresses::end
+class RxRouteRecord : public TxRxXBeeApiFrame {
 public:
-    XBee();
+    uint8_t getOptions();
+
     /**
-     * Reads all available serial bytes until a packet is parsed,
-     * an error occurs, or the buffer is empty.
-     * You may call <i>xbee</i>.getResponse().isReady() after
-     * calling this method to determine if a packet is ready, or
-     * <i>xbee</i>.getResponse().isError() to determine if a error
-     * occurred.
-     * <p/>
-     * This method should always return quickly since it does not
-     * wait for serial data to arrive.
-     * You will want to use this method if you are doing other
-     * timely stuff in your loop, where a delay would cause problems.
-     * NOTE: calling this method resets the current response, so
-     * make sure you first consume the current response
+     * Returns the 16-bit addresses of the intermediate hops, in the
+     * order expected by CreateSourceRoute, as bytes on the wire: two
+     * per address, big-endian; getAddress(i) returns one in host
+     * order
      */
-    void readPacket();
+    const uint8_t* getAddresses();
+    uint16_t getAddress(const uint8_t& i);
+    uint8_t getNAddresses();
+};
+
+inline uint8_t
+RxRouteRecord::getOptions() { return get<RxRouteRecordSchema::options>(); }
+inline const uint8_t*
+RxRouteRecord::getAddresses() { return &(_cmdData[RxRouteRecordSchema::addresses::index]); }
+inline uint16_t
+RxRouteRecord::getAddress(const uint8_t& i) { return getBigEndian16(&(_cmdData[RxRouteRecordSchema::addresses::index+2*i])); }
+inline uint8_t
+RxRouteRecord::getNAddresses() { return get<RxRouteRecordSchema::nAddresses>(); }
+
+struct RxMtoRouteRequestSchema : TxRxXBeeApiFrameSchema {
+    typedef address16::Next<1> options;
+};
+#define RX_MTO_ROUTE_REQUEST_HEAD RxMtoRouteRequestSchema::options::end
+class RxMtoRouteRequest : public TxRxXBeeApiFrame {
+public:
+    uint8_t getOptions();
+};
+
+inline uint8_t
+RxMtoRouteRequest::getOptions() { return get<RxMtoRouteRequestSchema::options>(); }
+
+struct OtaFirmwareUpdateStatusSchema : TxRxXBeeApiFrameSchema {
+    typedef address16::Next<1> options;
+    typedef options::Next<1> messageType;
+    typedef messageType::Next<1> blockNumber;
+    typedef blockNumber::Next<4> targetAddress64Msb;
+    typedef targetAddress64Msb::Next<4> targetAddress64Lsb;
+};
+#define OTA_FIRMWARE_UPDATE_STATUS_HEAD OtaFirmwareUpdateStatusSchema::targetAddress64Lsb::end
+class OtaFirmwareUpdateStatus : public TxRxXBeeApiFrame {
+public:
+    uint8_t getOptions();
     /**
-     * Waits a maximum of <i>timeout</i> milliseconds for a response
-     * packet before timing out; returns true if packet is read.
-     * Returns false if timeout or error occurs.
+     * Returns the bootloader message type:
+     * OTA_ACK, OTA_NACK, OTA_NO_MAC_ACK, OTA_QUERY or OTA_QUERY_RESPONSE
      */
-    bool readPacket(const uint32_t& timeout);
+    uint8_t getMessageType();
+    uint8_t getBlockNumber();
+
+    uint32_t getTargetAddress64Msb();
+    uint32_t getTargetAddress64Lsb();
+};
+
+inline uint8_t
+OtaFirmwareUpdateStatus::getOptions() { return get<OtaFirmwareUpdateStatusSchema::options>(); }
+inline uint8_t
+OtaFirmwareUpdateStatus::getMessageType() { return get<OtaFirmwareUpdateStatusSchema::messageType>(); }
+inline uint8_t
+OtaFirmwareUpdateStatus::getBlockNumber() { return get<OtaFirmwareUpdateStatusSchema::blockNumber>(); }
+
+inline uint32_t
+OtaFirmwareUpdateStatus::getTargetAddress64Msb() { return get<OtaFirmwareUpdateStatusSchema::targetAddress64Msb>(); }
+inline uint32_t
+OtaFirmwareUpdateStatus::getTargetAddress64Lsb() { return get<OtaFirmwareUpdateStatusSchema::targetAddress64Lsb>(); }
+
+struct RxDeviceAuthenticatedSchema : TxRxXBeeApiFrameSchema {
+    typedef address16::Next<1> status;
+};
+#define RX_DEVICE_AUTHENTICATED_HEAD RxDeviceAuthenticatedSchema::status::end
+class RxDeviceAuthenticated : public TxRxXBeeApiFrame {
+public:
     /**
-     * Reads until a packet is received or an error occurs.
-     * Caution: use this carefully since if you don't get a response,
-     * your Arduino code will hang on this call forever!! often it's
-     * better to use a timeout: readPacket(int)
+     * Returns 0 when the device joined and was authenticated
      */
-    void readPacketUntilAvailable();
+    uint8_t getStatus();
+};
+
+inline uint8_t
+RxDeviceAuthenticated::getStatus() { return get<RxDeviceAuthenticatedSchema::status>(); }
+
+struct RegisterJoiningDeviceStatusSchema : FrameIdDescriptionSchema {
+    typedef frameId::Next<1> status;
+};
+#define REGISTER_JOINING_DEVICE_STATUS_HEAD RegisterJoiningDeviceStatusSchema::status::end
+class RegisterJoiningDeviceStatus : public FrameIdDescription {
+public:
     /**
-     * Set response with the internal response values.
+     * Returns REGISTER_SUCCESS or the reason the key was not stored
+     */
+    uint8_t getStatus();
+};
+
+inline uint8_t
+RegisterJoiningDeviceStatus::getStatus() { return get<RegisterJoiningDeviceStatusSchema::status>(); }
+
+/*
+ * Rows an IoSampleColumns holds, and its columns: analog channels
+ * (mask bit numbers: A0 to A5, or A0 to A3 and 7 for the supply
+ * voltage) and digital lines (D0 to D12).
+ * Every row takes 47 bytes of memory: a few rows on a board, a bulk
+ * of them (47 KiB, better not on the stack) on a host.
+ */
+#ifdef XBEENG_POSIX
+#define IO_SAMPLE_MAX_ROWS 1024
+#else
+#define IO_SAMPLE_MAX_ROWS 8
+#endif
+#define IO_SAMPLE_ANALOG_CHANNELS 8
+#define IO_SAMPLE_DIGITAL_LINES 16
+
+/**
+ * Decodes the IO samples of Rx64DataSample (0x82), Rx16DataSample
+ * (0x83) and RxDataSample (0x92) frames into host-order columns,
+ * one row per sample: an array per analog channel, an array per
+ * digital line (0 or 1), the digital word and the masks of each row,
+ * and its source address.
+ * Call decode(...) for every sample frame read; the rows add up
+ * until clear().
+ * <p/>
+ * The samples of a frame are big-endian 16-bit words, byte-swapped
+ * all at once (eight at a time with SSE2 or NEON, otherwise two at a
+ * time in a 32-bit word), then scattered to their columns.
+ */
+class IoSampleColumns {
+public:
+    IoSampleColumns();
+    /**
+     * Appends the samples of <i>frame</i>; returns the number of rows
+     * added, 0 if it is not a sample frame or the columns are full
+     * (the samples that do not fit are dropped)
+     */
+    uint8_t decode(XBeeApiFrame& frame);
+    void clear();
+    uint16_t getRows();
+    /**
+     * Returns the union of the masks of all the rows
+     */
+    uint16_t getDigitalMask();
+    uint8_t getAnalogMask();
+
+    /**
+     * Returns the column of an analog channel, 0 in the rows where
+     * the channel was not sampled
+     */
+    uint16_t* getAnalog(const uint8_t& channel);
+    /**
+     * Returns the column of a digital line, 0 in the rows where the
+     * line was not sampled
+     */
+    uint8_t* getDigitalLine(const uint8_t& line);
+    uint16_t* getDigital();
+    uint16_t* getDigitalMasks();
+    uint8_t* getAnalogMasks();
+
+    /**
+     * Returns the source address columns; Rx16DataSample rows have
+     * a 0 address64, Rx64DataSample rows a BROADCAST_ADDRESS16
+     */
+    uint32_t* getAddress64Msb();
+    uint32_t* getAddress64Lsb();
+    uint16_t* getAddress16();
+private:
+    uint16_t _analog[IO_SAMPLE_ANALOG_CHANNELS][IO_SAMPLE_MAX_ROWS];
+    uint8_t _digitalLines[IO_SAMPLE_DIGITAL_LINES][IO_SAMPLE_MAX_ROWS];
+    uint16_t _digital[IO_SAMPLE_MAX_ROWS];
+    uint16_t _digitalMasks[IO_SAMPLE_MAX_ROWS];
+    uint8_t _analogMasks[IO_SAMPLE_MAX_ROWS];
+    uint32_t _address64Msb[IO_SAMPLE_MAX_ROWS];
+    uint32_t _address64Lsb[IO_SAMPLE_MAX_ROWS];
+    uint16_t _address16[IO_SAMPLE_MAX_ROWS];
+
+    uint16_t _rows;
+    uint16_t _digitalMask;
+    uint8_t _analogMask;
+};
+
+/*
+ * TimeSeriesStore settings: nodes, a power of two (when full, the
+ * node updated the least recently is replaced), analog channels kept
+ * (A0 and up), raw samples kept per node, and the aggregate
+ * resolutions, in milliseconds, with the number of periods kept per
+ * resolution.
+ * Every node takes 18 + (5 + 2*TIME_SERIES_CHANNELS)*TIME_SERIES_RING_SIZE +
+ * TIME_SERIES_RESOLUTIONS*(2 + TIME_SERIES_PERIODS*(4 + 12*TIME_SERIES_CHANNELS))
+ * bytes of memory, about 850 bytes with these values: a few nodes on
+ * a board, a whole network (215 KiB, better not on the stack) on a
+ * host.
+ */
+#ifdef XBEENG_POSIX
+#define TIME_SERIES_NODES 256
+#else
+#define TIME_SERIES_NODES 2
+#endif
+#define TIME_SERIES_CHANNELS 4
+#define TIME_SERIES_RING_SIZE 16
+#define TIME_SERIES_RESOLUTIONS 3
+#define TIME_SERIES_RESOLUTION_MS { 1000UL, 60000UL, 3600000UL }
+#define TIME_SERIES_PERIODS 4
+
+/**
+ * Aggregate of one channel over one period of a TimeSeriesStore
+ */
+struct TimeSeriesAggregate {
+    // millis() at the start of the period
+    uint32_t start;
+    uint16_t count;
+    uint16_t min;
+    uint16_t max;
+    uint16_t mean;
+    uint16_t last;
+};
+
+/**
+ * Fixed-memory store of the recent analog samples of the nodes,
+ * keyed by their 64-bit address in an open-addressing index.
+ * Every sample is appended to a ring per channel, and folded into
+ * the min/max/mean/last of the current period of every resolution
+ * (by default 1 s, 1 min and 1 h); the last TIME_SERIES_PERIODS
+ * periods with samples are kept. Adding a sample and reading any
+ * sample or aggregate take constant time, but for replacing a node
+ * when the store is full.
+ * <p/>
+ * Nodes are addressed by index, see findNode(...).
+ */
+class TimeSeriesStore {
+public:
+    TimeSeriesStore();
+    /**
+     * Adds every row of <i>samples</i>, at millis(); returns the
+     * number of rows added. Rx16DataSample rows are keyed by their
+     * 16-bit address, as address64 0:address16.
+     */
+    uint16_t add(IoSampleColumns& samples);
+    /**
+     * Adds one sample: <i>values</i> is indexed by channel, and only
+     * the channels of <i>analogMask</i> are read
+     */
+    void add(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+        const uint8_t& analogMask, const uint16_t* values, const uint32_t& time);
+    void clear();
+    /**
+     * Returns the index of the node, or -1
+     */
+    int16_t findNode(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    /**
+     * Returns the number of raw samples kept for the node
+     */
+    uint8_t getSamples(const uint16_t& node);
+    /**
+     * Returns true, with the value and its time, if the sample
+     * <i>age</i> (0 is the last one) of the node has the channel
+     */
+    bool getSample(const uint16_t& node, const uint8_t& channel, const uint8_t& age,
+        uint16_t& value, uint32_t& time);
+    /**
+     * Returns true, with the aggregate, if the period <i>age</i>
+     * (0 is the current one) of the resolution has samples of the
+     * channel
+     */
+    bool getAggregate(const uint16_t& node, const uint8_t& channel,
+        const uint8_t& resolution, const uint8_t& age, TimeSeriesAggregate& aggregate);
+private:
+    uint16_t getNode(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    uint16_t getHomeSlot(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    int16_t findSlot(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    void removeSlot(const uint16_t& slot);
+
+    // index: the node of every slot, or -1; twice as many slots as
+    // nodes keep the probes short
+    int16_t _slots[2*TIME_SERIES_NODES];
+    // the nodes in use, from 0
+    uint16_t _nodes;
+
+    uint32_t _address64Msb[TIME_SERIES_NODES];
+    uint32_t _address64Lsb[TIME_SERIES_NODES];
+    uint32_t _updatedAt[TIME_SERIES_NODES];
+
+    // raw samples: one ring per channel, times and masks per sample
+    uint16_t _samples[TIME_SERIES_NODES][TIME_SERIES_CHANNELS][TIME_SERIES_RING_SIZE];
+    uint32_t _sampleTime[TIME_SERIES_NODES][TIME_SERIES_RING_SIZE];
+    uint8_t _sampleMask[TIME_SERIES_NODES][TIME_SERIES_RING_SIZE];
+    uint8_t _sampleHead[TIME_SERIES_NODES];
+    uint8_t _sampleCount[TIME_SERIES_NODES];
+
+    // periods: one ring per resolution
+    uint32_t _periodStart[TIME_SERIES_NODES][TIME_SERIES_RESOLUTIONS][TIME_SERIES_PERIODS];
+    uint8_t _periodHead[TIME_SERIES_NODES][TIME_SERIES_RESOLUTIONS];
+    uint8_t _periodCount[TIME_SERIES_NODES][TIME_SERIES_RESOLUTIONS];
+    uint16_t _count[TIME_SERIES_NODES][TIME_SERIES_CHANNELS][TIME_SERIES_RESOLUTIONS][TIME_SERIES_PERIODS];
+    uint16_t _min[TIME_SERIES_NODES][TIME_SERIES_CHANNELS][TIME_SERIES_RESOLUTIONS][TIME_SERIES_PERIODS];
+    uint16_t _max[TIME_SERIES_NODES][TIME_SERIES_CHANNELS][TIME_SERIES_RESOLUTIONS][TIME_SERIES_PERIODS];
+    uint16_t _last[TIME_SERIES_NODES][TIME_SERIES_CHANNELS][TIME_SERIES_RESOLUTIONS][TIME_SERIES_PERIODS];
+    uint32_t _sum[TIME_SERIES_NODES][TIME_SERIES_CHANNELS][TIME_SERIES_RESOLUTIONS][TIME_SERIES_PERIODS];
+};
+
+/*
+ * This value determines how many bytes of each remote AT
+ * response are kept by XBee::gatherRemoteAtCommand(...).
+ * 20 is enough for the longest NI string.
+ */
+#define MAX_GATHER_DATA_SIZE 20
+
+/**
+ * One row of the table filled by XBee::gatherRemoteAtCommand(...),
+ * keyed by the source address of the RemoteAtCommandResponse
+ * (in host order, as returned by its getters).
+ */
+struct RemoteAtGatherEntry {
+    uint32_t address64Msb;
+    uint32_t address64Lsb;
+    uint16_t address16;
+
+    uint8_t status;
+
+    uint8_t data[MAX_GATHER_DATA_SIZE];
+    uint8_t dataLength;
+};
+
+/*
+ * Number of slots of an AddressCache, it must be a power of two.
+ * Every slot takes 10 bytes of memory.
+ */
+#define ADDRESS_CACHE_SIZE 32
+
+/*
+ * Number of unicast requests (with non-zero frame id) that XBee
+ * remembers until their TxStatus arrives, to know which 64-bit
+ * address a status refers to.
+ */
+#define MAX_PENDING_TX 8
+
+/*
+ * Number of aggregator changes (AggregateAddressing, 0x8E) whose old
+ * address XBee keeps rewriting to the new one, the oldest change is
+ * forgotten when full.
+ */
+#define MAX_AGGREGATOR_REWRITES 4
+
+/*
+ * Bytes XBee escapes on the stack before writing them to the
+ * transport, one write per chunk; at least 2.
+ */
+#define XBEE_WRITE_CHUNK 32
+
+// XBee::getReachability(...) results
+#define REACHABILITY_UNREACHABLE 0
+#define REACHABILITY_UNKNOWN 1
+#define REACHABILITY_KNOWN 2
+
+/**
+ * Called by XBee when an AggregateAddressing (0x8E) frame moves the
+ * aggregator from the old address to the new one, to repoint the
+ * subscriptions of the application. Not called for the first
+ * aggregator (old address 0).
+ */
+typedef void (*AggregatorCallback)(uint32_t oldAddress64Msb, uint32_t oldAddress64Lsb,
+    uint32_t newAddress64Msb, uint32_t newAddress64Lsb);
+
+/**
+ * Compact open-addressing (linear probing) table that maps 64-bit
+ * addresses to the 16-bit network address last seen for them.
+ * Attached to an XBee with XBee::setAddressCache(...), it learns
+ * the mappings from received frames and from successful TxStatus,
+ * and fills them into outbound TxRequest, ExplicitTxRequest and
+ * RemoteAtCommand frames whose address16 is BROADCAST_ADDRESS16,
+ * sparing the address discovery of the ZigBee module.
+ * A mapping is dropped when a delivery to its address fails.
+ * <p/>
+ * All the addresses are in host order.
+ */
+class AddressCache {
+public:
+    AddressCache();
+    /**
+     * Stores (or refreshes) the mapping address64 -> address16.
+     * BROADCAST_ADDRESS16 means "unknown" and is ignored.
+     * When the table is full the entry at the home slot is replaced.
+     */
+    void learn(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+        const uint16_t& address16);
+    /**
+     * Returns true and sets <i>address16</i> if address64 is known.
+     */
+    bool lookup(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+        uint16_t& address16);
+    void invalidate(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    void clear();
+    /**
+     * Returns the number of cached mappings
+     */
+    uint8_t getSize();
+private:
+    uint8_t getHomeSlot(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    int16_t find(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+
+    uint32_t _address64Msb[ADDRESS_CACHE_SIZE];
+    uint32_t _address64Lsb[ADDRESS_CACHE_SIZE];
+    // BROADCAST_ADDRESS16 marks an empty slot
+    uint16_t _address16[ADDRESS_CACHE_SIZE];
+    uint8_t _size;
+};
+
+/*
+ * Number of destinations an UnreachableCache can hold down at the
+ * same time, when full the oldest failure is forgotten.
+ */
+#define UNREACHABLE_CACHE_SIZE 8
+/*
+ * Hold-down (milliseconds) after the first failure, it doubles on
+ * every consecutive failure up to UNREACHABLE_MAX_HOLD_DOWN.
+ */
+#define UNREACHABLE_HOLD_DOWN 1000
+#define UNREACHABLE_MAX_HOLD_DOWN 60000
+
+/**
+ * Negative cache of destinations that have left the network.
+ * Attached to an XBee with XBee::setUnreachableCache(...), every
+ * TxStatus reporting ADDRESS_NOT_FOUND or ROUTE_NOT_FOUND puts its
+ * destination on an exponential hold-down, during which XBee::send(...)
+ * rejects the unicast requests to it instead of triggering another
+ * route and address discovery.
+ * The entry is cleared as soon as any frame from that node arrives
+ * or a delivery to it succeeds.
+ * <p/>
+ * All the addresses are in host order.
+ */
+class UnreachableCache {
+public:
+    UnreachableCache();
+    /**
+     * Records a failed delivery and starts (or doubles) the hold-down
+     */
+    void markUnreachable(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    void markReachable(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    /**
+     * Returns true while the destination is held down.
+     * Once the hold-down expires every request is let through again
+     * until a TxStatus reports a failure, which starts a hold-down
+     * twice as long; requests sent before that status arrives are
+     * not held back (send a single probe first to avoid a burst).
+     */
+    bool isUnreachable(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    /**
+     * Returns the milliseconds left of the hold-down, 0 if none
+     */
+    uint32_t getHoldDown(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    void clear();
+    /**
+     * Returns the number of destinations with recorded failures
+     */
+    uint8_t getSize();
+private:
+    int8_t find(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+
+    uint32_t _address64Msb[UNREACHABLE_CACHE_SIZE];
+    uint32_t _address64Lsb[UNREACHABLE_CACHE_SIZE];
+    // millis() of the last failure
+    uint32_t _since[UNREACHABLE_CACHE_SIZE];
+    uint32_t _holdDown[UNREACHABLE_CACHE_SIZE];
+    // consecutive failures, 0 marks an empty slot
+    uint8_t _failures[UNREACHABLE_CACHE_SIZE];
+};
+
+/*
+ * Number of destinations a SourceRouteCache can hold, when full the
+ * least recently used route is replaced.
+ */
+#define SOURCE_ROUTE_CACHE_SIZE 16
+/*
+ * Routes with more intermediate hops are not cached, and their
+ * destinations fall back to route discovery.
+ */
+#define MAX_SOURCE_ROUTE_HOPS 8
+// cmdData length of the longest CreateSourceRoute sent from the cache
+#define MAX_SOURCE_ROUTE_LENGTH (CREATE_SOURCE_ROUTE_HEAD+2*MAX_SOURCE_ROUTE_HOPS)
+
+/**
+ * Per-destination cache of the routes reported by RxRouteRecord
+ * (0xA1) frames, for concentrators using many-to-one routing.
+ * Attached to an XBee with XBee::setSourceRouteCache(...), it learns
+ * every route record, and before a unicast TxRequest, ExplicitTxRequest
+ * or RemoteAtCommand to a cached destination, XBee::send(...) first
+ * sends the matching CreateSourceRoute (with frame id 0), unless that
+ * route is the last one handed to the module.
+ * A route is dropped when a delivery to its destination fails.
+ * <p/>
+ * All the addresses are in host order.
+ */
+class SourceRouteCache {
+public:
+    SourceRouteCache();
+    /**
+     * Stores (or replaces) the route to address64.
+     * Returns false if the route has more than MAX_SOURCE_ROUTE_HOPS
+     * hops; the previous route (if any) is dropped in that case.
+     */
+    bool learn(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+        const uint16_t& address16, const uint16_t* addresses, const uint8_t& nAddresses);
+    /**
+     * Returns true, and the route, if address64 is cached.
+     * Every call counts as a hit or a miss.
+     */
+    bool lookup(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+        uint16_t& address16, const uint16_t*& addresses, uint8_t& nAddresses);
+    void invalidate(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    void clear();
+    /**
+     * Returns the number of cached routes
+     */
+    uint8_t getSize();
+    uint32_t getHits();
+    uint32_t getMisses();
+private:
+    int8_t find(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+
+    uint32_t _address64Msb[SOURCE_ROUTE_CACHE_SIZE];
+    uint32_t _address64Lsb[SOURCE_ROUTE_CACHE_SIZE];
+    uint16_t _address16[SOURCE_ROUTE_CACHE_SIZE];
+    uint16_t _addresses[SOURCE_ROUTE_CACHE_SIZE][MAX_SOURCE_ROUTE_HOPS];
+    // number of hops, 0xff marks an empty slot
+    uint8_t _nAddresses[SOURCE_ROUTE_CACHE_SIZE];
+    // millis() of the last learn/lookup
+    uint32_t _lastUsed[SOURCE_ROUTE_CACHE_SIZE];
+
+    uint32_t _hits;
+    uint32_t _misses;
+};
+
+/*
+ * Bits of each of the two Bloom filters of a DuplicateFilter (a power
+ * of two), hashes per frame, and milliseconds after which the filters
+ * rotate: the copies of a frame are dropped for one to two windows
+ * after its first copy.
+ * With 1024 bits, 3 hashes and 50 distinct frames per window about
+ * 0.3% of the frames are dropped by mistake on average (measured with
+ * random payloads), rising to 0.5% at the end of a window when both
+ * filters are full.
+ */
+#define DUPLICATE_FILTER_BITS 1024
+#define DUPLICATE_FILTER_HASHES 3
+#define DUPLICATE_FILTER_WINDOW 2000
+
+/**
+ * Drops the received frames already seen within a short window,
+ * like the retries of DigiMesh and ZigBee or the broadcasts arriving
+ * once per path. Attached to an XBee with XBee::setDuplicateFilter(...),
+ * readPacket() skips them as if they never came.
+ * <p/>
+ * Only RX frames (0x80 to 0x83, 0x90 to 0x92) are filtered, keyed by
+ * their source address and payload (the RSSI and options bytes are
+ * left out), or by an application sequence number in the payload.
+ * The frames seen are kept in two rotating Bloom filters: fixed
+ * memory and constant time per frame, at the cost of rare false
+ * positives.
+ */
+class DuplicateFilter {
+public:
+    DuplicateFilter();
+    /**
+     * Keys the frames by the <i>length</i> bytes at <i>offset</i> of
+     * their payload instead of by the whole payload; 0 length goes
+     * back to the whole payload
+     */
+    void setSequenceNumber(const uint8_t& offset, const uint8_t& length);
+    /**
+     * Returns true if <i>frame</i> was seen within the window, and
+     * records it
+     */
+    bool isDuplicate(XBeeApiFrame& frame);
+    void clear();
+    /**
+     * Returns the number of frames found duplicate
+     */
+    uint32_t getDropped();
+private:
+    uint8_t _bits[2][DUPLICATE_FILTER_BITS/8];
+    uint8_t _current;
+    uint32_t _rotatedAt;
+
+    uint8_t _sequenceOffset;
+    uint8_t _sequenceLength;
+
+    uint32_t _dropped;
+};
+
+#ifdef XBEENG_POSIX
+/**
+ * Returns the nanoseconds of the monotonic clock, the time base of
+ * the deadlines
+ */
+uint64_t getMonotonicTime();
+
+/**
+ * A Stream that can block until it has bytes to read, so XBee waits
+ * for frames without spinning (see XBee::readPacket(timeout)).
+ */
+class WaitableStream : public Stream {
+public:
+    /**
+     * Blocks until available() is non-zero, returning true, or until
+     * <i>deadline</i> (see getMonotonicTime(), UINT64_MAX for none)
+     * has passed, returning false
+     */
+    virtual bool waitAvailable(const uint64_t& deadline) = 0;
+};
+#endif
+
+/**
+ * Primary interface for communicating with an XBee Radio.
+ * This class provides methods for sending and receiving
+ * packets with an XBee radio via the serial port.
+ * The XBee radio must be configured in API (packet) mode (AP=2)
+ * in order to use this software.
+ * <p/>
+ * Since this code is designed to run on a microcontroller,
+ * with only one thread, you are responsible for reading the
+ * data of the serial buffer in a timely manner.  This involves
+ * a call to a variant of readPacket(...).
+ * If your serial port is receiving data faster than you are
+ * reading, you can expect to lose packets.
+ * <p/>
+ * In order to conserve resources, this class only supports
+ * storing one response packet in memory at a time.
+ * This means that you must fully consume the packet prior to
+ * calling readPacket(...), because calling readPacket(...)
+ * overwrites the previous response.
+ * <p/>
+ * This class creates an array of size MAX_CMD_DATA_SIZE for
+ * storing the response packet.  You may want to adjust this
+ * value to conserve memory.
+ *
+ * \author Andrew Rapp
+ */
+class XBee {
+public:
+    XBee();
+    ~XBee();
+    /**
+     * Reads all available serial bytes until a packet is parsed,
+     * an error occurs, or the buffer is empty.
+     * You may call <i>xbee</i>.getResponse().isReady() after
+     * calling this method to determine if a packet is ready, or
+     * <i>xbee</i>.getResponse().isError() to determine if a error
+     * occurred.
+     * <p/>
+     * This method should always return quickly since it does not
+     * wait for serial data to arrive.
+     * You will want to use this method if you are doing other
+     * timely stuff in your loop, where a delay would cause problems.
+     * NOTE: calling this method resets the current response, so
+     * make sure you first consume the current response
+     */
+    void readPacket();
+    /**
+     * Waits a maximum of <i>timeout</i> milliseconds for a response
+     * packet before timing out; returns true if packet is read.
+     * Returns false if timeout or error occurs.
+     * On a WaitableStream (such as a SerialPort) the wait blocks
+     * instead of polling the serial port.
+     */
+    bool readPacket(const uint32_t& timeout);
+    /**
+     * Reads until a packet is received or an error occurs.
+     * Caution: use this carefully since if you don't get a response,
+     * your Arduino code will hang on this call forever!! often it's
+     * better to use a timeout: readPacket(int)
+     */
+    void readPacketUntilAvailable();
+#ifdef XBEENG_POSIX
+    /**
+     * Same as readPacket(timeout), waiting until <i>deadline</i>
+     * nanoseconds (see getMonotonicTime())
+     */
+    bool readPacketBefore(const uint64_t& deadline);
+#endif
+    /**
+     * Set response with the internal response values.
      */
     void getApiFrame(XBeeApiFrame &response);
     /**
@@ -992,9 +2489,37 @@ public:
      */
     XBeeApiFrame& getApiFrame();
     /**
-     * Sends a XBeeRequest (TX packet) out the serial port
+     * Sends a XBeeRequest (TX packet) out the serial port.
+     * Returns false, without sending anything, when the destination
+     * is held down by the attached UnreachableCache.
+     */
+    bool send(XBeeApiFrame &request);
+    /**
+     * Same as send(request), writing the frame to <i>transport</i>
+     * (see XBeeOn) instead of the serial port, for instance to batch
+     * several frames in one write
+     */
+    template<class Transport> bool sendTo(Transport& transport, XBeeApiFrame& request);
+    /**
+     * Sends <i>cmd</i> to every node with a single broadcast
+     * RemoteAtCommand (address64 0x000000000000FFFF, address16
+     * BROADCAST_ADDRESS16) and collects the RemoteAtCommandResponse
+     * frames carrying <i>frameId</i> into <i>table</i>, one row per
+     * source address (a repeated answer overwrites its row).
+     * Stops when no answer arrived for <i>quiet</i> milliseconds,
+     * when <i>deadline</i> milliseconds have elapsed, or when the
+     * table is full; returns the number of rows filled.
+     * <p/>
+     * <i>frameId</i> must be non-zero, otherwise no node answers.
+     * Every other frame received meanwhile is discarded.
      */
-    void send(XBeeApiFrame &request);
+    uint8_t gatherRemoteAtCommand(const uint8_t& frameId, const char (&cmd)[3],
+        const uint8_t* param, const uint16_t& paramLength,
+        RemoteAtGatherEntry* table, const uint8_t& tableSize,
+        const uint32_t& quiet, const uint32_t& deadline);
+    uint8_t gatherRemoteAtCommand(const uint8_t& frameId, const char (&cmd)[3],
+        RemoteAtGatherEntry* table, const uint8_t& tableSize,
+        const uint32_t& quiet, const uint32_t& deadline);
     /**
      * Starts the serial connection on the specified serial port
      */
@@ -1003,13 +2528,131 @@ public:
      * Specify the serial port.
      */
     void setSerial(Stream &serial);
+#ifdef XBEENG_POSIX
+    void begin(WaitableStream &serial);
+    void setSerial(WaitableStream &serial);
+#endif
+    /**
+     * Attaches an AddressCache that learns from every parsed frame
+     * and fills the 16-bit address of outbound unicast requests.
+     * The cache is not copied, it must outlive this object.
+     */
+    void setAddressCache(AddressCache& addressCache);
+    /**
+     * Attaches an UnreachableCache that holds down the destinations
+     * reported as ADDRESS_NOT_FOUND or ROUTE_NOT_FOUND.
+     * The cache is not copied, it must outlive this object.
+     */
+    void setUnreachableCache(UnreachableCache& unreachableCache);
+    /**
+     * Attaches a SourceRouteCache fed by the RxRouteRecord frames,
+     * used to send a CreateSourceRoute before unicast requests.
+     * The cache is not copied, it must outlive this object.
+     */
+    void setSourceRouteCache(SourceRouteCache& sourceRouteCache);
+    /**
+     * Sets the function called after an AggregateAddressing (0x8E)
+     * frame, nullptr for none.
+     * Whatever the callback, from then on XBee sends the unicast
+     * requests addressed to the old aggregator to the new one, and
+     * repoints its caches and pending requests.
+     */
+    void setAggregatorCallback(AggregatorCallback aggregatorCallback);
+    /**
+     * Attaches a DuplicateFilter, readPacket() skips the frames it
+     * finds duplicate.
+     * The filter is not copied, it must outlive this object.
+     */
+    void setDuplicateFilter(DuplicateFilter& duplicateFilter);
+    /**
+     * Returns what the attached caches say about address64:
+     * REACHABILITY_UNREACHABLE while it is held down,
+     * REACHABILITY_KNOWN if its 16-bit address is cached,
+     * REACHABILITY_UNKNOWN otherwise.
+     */
+    uint8_t getReachability(const uint32_t& address64Msb, const uint32_t& address64Lsb);
+
+protected:
+    /*
+     * readPacket() and send(...) over any transport: XBee uses them
+     * with its Stream, XBeeOn with the transport it was built with,
+     * so the byte I/O is inlined when the transport is not virtual.
+     */
+    template<class Transport> void readFrom(Transport& transport);
+    template<class Transport> bool readFrom(Transport& transport, const uint32_t& timeout);
+    template<class Transport> void readFromUntilAvailable(Transport& transport);
+#ifdef XBEENG_POSIX
+    template<class Transport> bool readFromBefore(Transport& transport, const uint64_t& deadline);
+    // blocks on the transports that have waitAvailable(deadline),
+    // otherwise returns whether the deadline is still ahead
+    template<class Transport>
+    static auto waitAvailable(Transport& transport, const uint64_t& deadline, int)
+        -> decltype(transport.waitAvailable(deadline));
+    template<class Transport>
+    static bool waitAvailable(Transport& transport, const uint64_t& deadline, long);
+#endif
 
 private:
-    bool available();
-    uint8_t read();
-    void flush();
-    void write(const uint8_t& val);
-    void sendByte(const uint8_t& b, const bool& escape);
+    // discards the last frame if it is complete or failed
+    void startPacket();
+    // parses one byte, returns true once the frame is complete or failed
+    bool parseByte(uint8_t c);
+    // routes the request; returns false if its destination is held
+    // down, otherwise its first TXRX_FRAME_ID_HEAD bytes as sent (the
+    // destination may change) and the checksum, to be used in place of
+    // the request's if rewriteAddress,
+    // and the cmdData of a CreateSourceRoute to send ahead of it if
+    // routeLength > 0 (no I/O here: the caller sends both, in order)
+    bool prepareSend(XBeeApiFrame& request, uint8_t* head,
+        bool& rewriteAddress, uint8_t& checksum, uint8_t* route, uint8_t& routeLength);
+    // escapes b into out, writing out when full
+    template<class Transport>
+    static void putByte(Transport& transport, uint8_t* out, uint8_t& n, const uint8_t& b);
+
+    // called once for every frame parsed by readPacket()
+    void processApiFrame();
+
+    // the caches, pending statuses and aggregator rewrites are shared
+    // by send(...) and readPacket(), which may run on two threads
+    // (see XBeeReaderThread, XBeeWriterThread); no-ops on a board
+    void lockRouting();
+    void unlockRouting();
+#ifdef XBEENG_POSIX
+    pthread_mutex_t _routingMutex;
+#endif
+
+    // unicast requests waiting for their TxStatus
+    void addPendingTx(const uint8_t& frameId,
+        const uint32_t& address64Msb, const uint32_t& address64Lsb);
+    bool takePendingTx(const uint8_t& frameId,
+        uint32_t& address64Msb, uint32_t& address64Lsb);
+    uint8_t _pendingTxFrameId[MAX_PENDING_TX];
+    uint32_t _pendingTxAddress64Msb[MAX_PENDING_TX];
+    uint32_t _pendingTxAddress64Lsb[MAX_PENDING_TX];
+    uint8_t _pendingTxNext;
+
+    AddressCache* _addressCache;
+    UnreachableCache* _unreachableCache;
+    SourceRouteCache* _sourceRouteCache;
+    DuplicateFilter* _duplicateFilter;
+
+    // aggregator changes, old address -> new address
+    void rewriteAggregator(const uint32_t& oldAddress64Msb, const uint32_t& oldAddress64Lsb,
+        const uint32_t& newAddress64Msb, const uint32_t& newAddress64Lsb);
+    bool findAggregatorRewrite(uint32_t& address64Msb, uint32_t& address64Lsb);
+    bool _rewriteUsed[MAX_AGGREGATOR_REWRITES];
+    uint32_t _rewriteOldAddress64Msb[MAX_AGGREGATOR_REWRITES];
+    uint32_t _rewriteOldAddress64Lsb[MAX_AGGREGATOR_REWRITES];
+    uint32_t _rewriteNewAddress64Msb[MAX_AGGREGATOR_REWRITES];
+    uint32_t _rewriteNewAddress64Lsb[MAX_AGGREGATOR_REWRITES];
+    uint8_t _rewriteNext;
+    AggregatorCallback _aggregatorCallback;
+
+    // destination of the last CreateSourceRoute handed to the module,
+    // which only keeps one source route
+    bool _sourceRouteSent;
+    uint32_t _sourceRouteAddress64Msb;
+    uint32_t _sourceRouteAddress64Lsb;
 
     // just a state variables for packet parsing
     // and has no relevance for the response otherwise
@@ -1023,6 +2666,1747 @@ private:
     uint8_t _responseCmdData[MAX_CMD_DATA_SIZE];
 
     Stream* _serial;
+#ifdef XBEENG_POSIX
+    // _serial if it is a WaitableStream, otherwise nullptr
+    WaitableStream* _waitable;
+#endif
 };
 
+inline void
+XBee::lockRouting() {
+#ifdef XBEENG_POSIX
+    pthread_mutex_lock(&_routingMutex);
+#endif
+}
+inline void
+XBee::unlockRouting() {
+#ifdef XBEENG_POSIX
+    pthread_mutex_unlock(&_routingMutex);
+#endif
+}
+inline void
+XBee::startPacket() {
+    // reset previous complete response
+    if (_response.isReady() || _response.hasErrors()) {
+        // discard previous packet and start over
+        resetStateVariables();
+
+        _response.setMsbLength(0);
+        _response.setLsbLength(0);
+        _response.setCmdId(0);
+        _response.setChecksum(0);
+
+        _response.setReady(false);
+        _response.setErrorCode(NO_ERROR);
+    }
+}
+inline bool
+XBee::parseByte(uint8_t c) {
+    if (_pos > 0 && c == XB_START) {
+        _response.setErrorCode(UNEXPECTED_START);
+        return true;
+    }
+    if (_pos > MAX_CMD_DATA_SIZE) {
+        _response.setErrorCode(PACKET_EXCEEDS_CMD_DATA_LENGTH);
+        return true;
+    }
+    if (_pos > 0 && c == XB_ESCAPE) {
+        _escape = true;
+        return false;
+    }
+    if (_escape) {
+        c ^= 0x20;
+        _escape = false;
+    }
+
+    if (_pos >= 3) {
+        _checksumTotal += c;
+    }
+
+    switch (_pos) {
+        case 0: {
+            if (c == XB_START) {
+                _pos++;
+            }
+        } break;
+        case 1: {
+            _response.setMsbLength(c);
+            _pos++;
+        } break;
+        case 2: {
+            _response.setLsbLength(c);
+            _pos++;
+        } break;
+        case 3: {
+            _response.setCmdId(c);
+            _pos++;
+        } break;
+        default: {
+            // check if we're at the end of the packet.
+            // Frame Data length does not include
+            // start, msb, lsb, and checksum bytes, so add 3
+            if (_pos == (_response.getFrameDataLength() + 3)) {
+                // verify checksum
+                if (_checksumTotal == 0xff) {
+                    _response.setChecksum(c);
+
+                    if (_duplicateFilter != nullptr && _duplicateFilter->isDuplicate(_response)) {
+                        // dropped: go on reading as if it never came
+                        _pos = 0;
+                        _checksumTotal = 0;
+                        return false;
+                    }
+
+                    _response.setReady(true);
+
+                    _response.setErrorCode(NO_ERROR);
+
+                    processApiFrame();
+                } else {
+                    _response.setErrorCode(CHECKSUM_FAILURE);
+                }
+
+                // reset state vars
+                _pos = 0;
+                _checksumTotal = 0;
+                return true;
+            } else {
+                _response.getCmdData()[_pos - CMD_DATA_OFFSET] = c;
+                _pos++;
+            }
+        }
+    }
+    return false;
+}
+template<class Transport> void
+XBee::readFrom(Transport& transport) {
+    startPacket();
+    while (transport.available()) {
+        if (parseByte(transport.read())) return;
+    }
+}
+template<class Transport> bool
+XBee::readFrom(Transport& transport, const uint32_t& timeout) {
+#ifdef XBEENG_POSIX
+    return readFromBefore(transport, getMonotonicTime() + (uint64_t) timeout*1000000);
+#else
+    uint32_t start = millis();
+
+    while ((millis() - start) < timeout) {
+        readFrom(transport);
+
+        if (_response.isReady()) {
+            return true;
+        } else if (_response.hasErrors()) {
+            return false;
+        }
+    }
+
+    // timed out
+    return false;
+#endif
+}
+template<class Transport> void
+XBee::readFromUntilAvailable(Transport& transport) {
+#ifdef XBEENG_POSIX
+    readFromBefore(transport, UINT64_MAX);
+#else
+    while (!(_response.isReady() || _response.hasErrors())) {
+        readFrom(transport);
+    }
+#endif
+}
+#ifdef XBEENG_POSIX
+template<class Transport> bool
+XBee::readFromBefore(Transport& transport, const uint64_t& deadline) {
+    for (;;) {
+        readFrom(transport);
+
+        if (_response.isReady()) {
+            return true;
+        } else if (_response.hasErrors()) {
+            return false;
+        }
+
+        if (!waitAvailable(transport, deadline, 0)) {
+            // timed out
+            return false;
+        }
+    }
+}
+template<class Transport> auto
+XBee::waitAvailable(Transport& transport, const uint64_t& deadline, int)
+    -> decltype(transport.waitAvailable(deadline)) {
+    return transport.waitAvailable(deadline);
+}
+template<class Transport> bool
+XBee::waitAvailable(Transport&, const uint64_t& deadline, long) {
+    return getMonotonicTime() < deadline;
+}
+#endif
+template<class Transport> void
+XBee::putByte(Transport& transport, uint8_t* out, uint8_t& n, const uint8_t& b) {
+    if (n > XBEE_WRITE_CHUNK - 2) {
+        transport.write(out, n);
+        n = 0;
+    }
+    if (b == XB_START || b == XB_ESCAPE || b == XB_ON || b == XB_OFF) {
+        out[n++] = XB_ESCAPE;
+        out[n++] = b ^ 0x20;
+    } else {
+        out[n++] = b;
+    }
+}
+template<class Transport> bool
+XBee::sendTo(Transport& transport, XBeeApiFrame& request) {
+    uint8_t head[TXRX_FRAME_ID_HEAD];
+    bool rewriteAddress;
+    uint8_t checksum;
+    uint8_t route[MAX_SOURCE_ROUTE_LENGTH];
+    uint8_t routeLength;
+    if (!prepareSend(request, head, rewriteAddress, checksum, route, routeLength)) return false;
+
+    // through the same transport, so the module gets the route right
+    // before the request, even behind frames batched earlier
+    if (routeLength > 0) {
+        XBeeApiFrameView routeRequest(CREATE_SOURCE_ROUTE, route, routeLength);
+        sendTo(transport, routeRequest);
+    }
+
+    uint16_t length = request.getCmdDataLength();
+    uint8_t* cmdData = request.getCmdData();
+
+    // escaped in chunks, one write per chunk
+    uint8_t out[XBEE_WRITE_CHUNK];
+    uint8_t n = 0;
+
+    // start
+    out[n++] = XB_START;
+
+    // length
+    putByte(transport, out, n, request.getMsbLength());
+    putByte(transport, out, n, request.getLsbLength());
+
+    // cmdID
+    putByte(transport, out, n, request.getCmdId());
+
+    // cmdData
+    for (uint16_t i = 0; i < length; i++) {
+        if (rewriteAddress && i < TXRX_FRAME_ID_HEAD) putByte(transport, out, n, head[i]);
+        else putByte(transport, out, n, cmdData[i]);
+    }
+
+    // checksum
+    putByte(transport, out, n, checksum);
+
+    // send packet
+    transport.write(out, n);
+    transport.flush();
+
+    return true;
+}
+
+/**
+ * XBee bound at compile time to its transport: readPacket(...) and
+ * send(...) call the members of <i>Transport</i> directly, so a
+ * transport with non-virtual (or final) members, such as a ring
+ * buffer, a POSIX fd or a test double, has its byte I/O inlined into
+ * the parser and the encoder. A Transport is any class with
+ * <pre>
+ * int available();
+ * int read();
+ * size_t write(const uint8_t* buffer, size_t size);
+ * void flush();
+ * </pre>
+ * which every Stream has.
+ * <p/>
+ * It is an XBee: the classes taking an XBee& (XBeeGroup, OtaUpdater,
+ * ...) read and write the same transport through a Stream adapter,
+ * so begin(...) and setSerial(...) must not be called on it.
+ * The transport is not copied, it must outlive this object.
+ */
+template<class Transport>
+class XBeeOn : public XBee {
+public:
+    XBeeOn(Transport& transport);
+    /**
+     * Same as XBee::readPacket()
+     */
+    void readPacket();
+    /**
+     * Same as XBee::readPacket(timeout)
+     */
+    bool readPacket(const uint32_t& timeout);
+    /**
+     * Same as XBee::readPacketUntilAvailable()
+     */
+    void readPacketUntilAvailable();
+#ifdef XBEENG_POSIX
+    /**
+     * Same as XBee::readPacketBefore(deadline)
+     */
+    bool readPacketBefore(const uint64_t& deadline);
+#endif
+    /**
+     * Same as XBee::send(request)
+     */
+    bool send(XBeeApiFrame& request);
+    Transport& getTransport();
+private:
+    // the transport, type-erased for the XBee& users
+#ifdef XBEENG_POSIX
+    class TransportStream : public WaitableStream {
+#else
+    class TransportStream : public Stream {
+#endif
+    public:
+        TransportStream(Transport& transport) : _transport(transport) {}
+        int available() { return _transport.available(); }
+        int read() { return _transport.read(); }
+        int peek() { return -1; }
+        size_t write(uint8_t b) { return _transport.write(&b, 1); }
+        size_t write(const uint8_t* buffer, size_t size) {
+            return _transport.write(buffer, size);
+        }
+        void flush() { _transport.flush(); }
+#ifdef XBEENG_POSIX
+        bool waitAvailable(const uint64_t& deadline) {
+            return XBee::waitAvailable(_transport, deadline, 0);
+        }
+#endif
+    private:
+        Transport& _transport;
+    };
+
+    Transport& _transport;
+    TransportStream _stream;
+};
+
+template<class Transport>
+XBeeOn<Transport>::XBeeOn(Transport& transport) : _transport(transport), _stream(transport) {
+    XBee::begin(_stream);
+}
+template<class Transport> void
+XBeeOn<Transport>::readPacket() { readFrom(_transport); }
+template<class Transport> bool
+XBeeOn<Transport>::readPacket(const uint32_t& timeout) { return readFrom(_transport, timeout); }
+template<class Transport> void
+XBeeOn<Transport>::readPacketUntilAvailable() { readFromUntilAvailable(_transport); }
+#ifdef XBEENG_POSIX
+template<class Transport> bool
+XBeeOn<Transport>::readPacketBefore(const uint64_t& deadline) {
+    return readFromBefore(_transport, deadline);
+}
+#endif
+template<class Transport> bool
+XBeeOn<Transport>::send(XBeeApiFrame& request) { return sendTo(_transport, request); }
+template<class Transport> Transport&
+XBeeOn<Transport>::getTransport() { return _transport; }
+
+/*
+ * OtaUpdater settings: number of nodes updated at the same time,
+ * blocks in flight per node (at most 16), milliseconds before an
+ * unacknowledged block is sent again, and retries of a block
+ * before its update fails.
+ */
+#define OTA_MAX_SESSIONS 4
+#define OTA_WINDOW_SIZE 4
+#define OTA_BLOCK_TIMEOUT 2000
+#define OTA_MAX_RETRIES 5
+
+// Addressing of the OTA blocks (ExplicitTxRequest)
+#define OTA_ENDPOINT 0xe8
+#define OTA_CLUSTER_ID 0x0071
+#define OTA_PROFILE_ID 0xc105
+
+// OtaUpdater session states
+#define OTA_IDLE 0
+#define OTA_RUNNING 1
+#define OTA_DONE 2
+#define OTA_FAILED 3
+
+/**
+ * Streams firmware images to remote nodes through ExplicitTxRequest
+ * frames, and tracks their progress from the OtaFirmwareUpdateStatus
+ * (0xA0) frames.
+ * <p/>
+ * The image is read in place from memory: a flash array, or the
+ * memory-mapped image file on a host, is never copied. It is cut in
+ * blocks of (NP - 1) bytes, each block prefixed with its number
+ * (modulo 256). Up to OTA_WINDOW_SIZE blocks per node are in flight:
+ * an OTA_ACK frees a slot of the window, an OTA_NACK or OTA_NO_MAC_ACK
+ * (or OTA_BLOCK_TIMEOUT without status) sends the block again.
+ * Several nodes are updated at the same time, in round robin, within
+ * an optional airtime budget shared by all of them.
+ * <p/>
+ * Call poll() often, and hand every frame read to process(...).
+ */
+class OtaUpdater {
+public:
+    OtaUpdater(XBee& xbee);
+    /**
+     * Sets the block size of the next sessions from NP (maximum RF
+     * payload bytes), 84 by default
+     */
+    void setMaxPayload(const uint8_t& np);
+    /**
+     * Limits the bytes sent per second by all the sessions,
+     * 0 means unlimited. It must allow at least one block.
+     */
+    void setAirtimeBudget(const uint32_t& bytesPerSecond);
+    /**
+     * Starts updating the node address64 with <i>image</i>, which must
+     * stay valid until the session ends. Returns the session index,
+     * or -1 if every session is busy.
+     */
+    int8_t start(const uint32_t& address64Msb, const uint32_t& address64Lsb,
+        const uint8_t* image, const uint32_t& imageLength);
+    /**
+     * Stops a session, and releases it (also when done or failed)
+     */
+    void abort(const uint8_t& session);
+    /**
+     * Sends the new blocks and the retransmissions due
+     */
+    void poll();
+    /**
+     * Returns true if <i>frame</i> was an OtaFirmwareUpdateStatus
+     * of a running session
+     */
+    bool process(XBeeApiFrame& frame);
+
+    uint8_t getState(const uint8_t& session);
+    uint32_t getBlocksAcked(const uint8_t& session);
+    uint32_t getBlocksTotal(const uint8_t& session);
+    uint32_t getRetries(const uint8_t& session);
+private:
+    struct OtaSession {
+        uint8_t state;
+        uint32_t address64Msb;
+        uint32_t address64Lsb;
+
+        const uint8_t* image;
+        uint32_t imageLength;
+        uint8_t blockSize;
+        uint32_t nBlocks;
+
+        // window: blocks [base, next) are in flight
+        uint32_t base;
+        uint32_t next;
+        uint16_t acked;
+        uint32_t sentAt[OTA_WINDOW_SIZE];
+        uint8_t tries[OTA_WINDOW_SIZE];
+
+        uint32_t retries;
+    };
+
+    bool sendBlock(OtaSession& session, const uint32_t& block);
+    bool takeBudget(const uint16_t& bytes);
+
+    XBee* _xbee;
+    OtaSession _sessions[OTA_MAX_SESSIONS];
+    uint8_t _nextSession;
+
+    uint8_t _blockSize;
+
+    uint32_t _budget;
+    uint32_t _tokens;
+    uint32_t _tokensAt;
+};
+
+/*
+ * JoinProvisioner settings: registrations waiting for their
+ * RegisterJoiningDeviceStatus, milliseconds before one of them
+ * counts as failed, registered devices remembered until their
+ * RxDeviceAuthenticated (the oldest is forgotten when full), and
+ * the longest key read from the list (install code with its CRC).
+ */
+#define PROVISION_MAX_IN_FLIGHT 4
+#define PROVISION_TIMEOUT 5000
+#define PROVISION_MAX_AWAITING 16
+#define PROVISION_MAX_KEY_LENGTH 18
+
+/**
+ * Registers a list of joining devices (secure join) in the trust
+ * center, keeping up to PROVISION_MAX_IN_FLIGHT RegisterJoiningDevice
+ * frames in flight instead of one blocking round trip each.
+ * <p/>
+ * The list is read from any Stream (for instance an SD File), one
+ * device per line: its 64-bit address and its key (or install code),
+ * both in hex, separated by spaces, tabs or a comma. Empty lines and
+ * lines starting with '#' are skipped; a line without a key, or with
+ * an odd number of hex digits in it, counts as failed.
+ * <pre>
+ * 0013A200403E0F30 36C50D3B8F1AD7E2A40C56B3C7E91F0D8A6B
+ * </pre>
+ * The RegisterJoiningDeviceStatus (0xA4) frames are matched by frame
+ * id (from 1 to EXCHANGE_FIRST_FRAME_ID-1), and the joins are confirmed
+ * by the RxDeviceAuthenticated (0xA2) frames.
+ * <p/>
+ * Call poll() often, and hand every frame read to process(...).
+ */
+class JoinProvisioner {
+public:
+    JoinProvisioner(XBee& xbee);
+    /**
+     * Starts reading <i>list</i>, which must outlive the provisioning.
+     * <i>options</i> is the RegisterJoiningDevice option byte, for
+     * instance 0x01 when the keys are install codes.
+     */
+    void begin(Stream& list, const uint8_t& options);
+    /**
+     * Reads the next devices and registers them while there is room,
+     * and expires the registrations without status
+     */
+    void poll();
+    /**
+     * Returns true if <i>frame</i> was the status of a registration
+     * in flight or the authentication of a registered device
+     */
+    bool process(XBeeApiFrame& frame);
+    /**
+     * Returns true once the whole list is read and no registration
+     * is in flight (joins may still be confirmed afterwards)
+     */
+    bool isDone();
+
+    uint16_t getSent();
+    uint16_t getRegistered();
+    /**
+     * Returns the malformed lines, the rejected registrations and
+     * those without status
+     */
+    uint16_t getFailed();
+    uint16_t getJoined();
+    /**
+     * Returns the milliseconds since begin(...), up to isDone();
+     * getRegistered() * 1000 / getElapsed() is the throughput
+     */
+    uint32_t getElapsed();
+private:
+    bool readDevice();
+    uint8_t nextFrameId();
+
+    XBee* _xbee;
+    Stream* _list;
+    uint8_t _options;
+    bool _listDone;
+
+    // device parsed from the list, waiting for room
+    bool _deviceReady;
+    uint32_t _address64Msb;
+    uint32_t _address64Lsb;
+    uint8_t _key[PROVISION_MAX_KEY_LENGTH];
+    uint8_t _keyLength;
+    // parser state: field (0 address, 1 key, 2 comment, 3 after the
+    // key), hex digits read in the field, and whether the line is
+    // malformed
+    uint8_t _field;
+    uint8_t _nibbles;
+    bool _malformed;
+
+    // registrations in flight, frame id 0 marks an empty slot
+    uint8_t _frameId[PROVISION_MAX_IN_FLIGHT];
+    uint32_t _inFlightAddress64Msb[PROVISION_MAX_IN_FLIGHT];
+    uint32_t _inFlightAddress64Lsb[PROVISION_MAX_IN_FLIGHT];
+    uint32_t _sentAt[PROVISION_MAX_IN_FLIGHT];
+    uint8_t _lastFrameId;
+
+    // registered devices waiting for their authentication
+    uint32_t _awaitingAddress64Msb[PROVISION_MAX_AWAITING];
+    uint32_t _awaitingAddress64Lsb[PROVISION_MAX_AWAITING];
+    bool _awaiting[PROVISION_MAX_AWAITING];
+    uint8_t _awaitingNext;
+
+    uint16_t _sent;
+    uint16_t _registered;
+    uint16_t _failed;
+    uint16_t _joined;
+    uint32_t _startedAt;
+    uint32_t _elapsed;
+    bool _finished;
+    void updateElapsed();
+};
+
+/*
+ * Number of links (responder -> receiver hops) and of routes
+ * (source -> destination) a LinkStatistics holds, they must be
+ * powers of two. When full, the entry at the home slot is replaced.
+ * Every link takes 34 bytes of memory, every route 34 bytes.
+ */
+#define LINK_STATISTICS_LINKS 16
+#define LINK_STATISTICS_ROUTES 8
+
+/**
+ * Aggregates the RouteInformation (0x8D) frames of DigiMesh trace
+ * routes and NACKs into a per-link table: reports, MAC ACK timeouts,
+ * and the latency between consecutive hops of a trace. Per route it
+ * keeps the hop count of the last complete trace, and its churn
+ * (how many times the hops changed between traces).
+ * <p/>
+ * The hop latency is the difference of the timestamps (microseconds)
+ * of two nodes whose clocks are not synchronized, so each link
+ * carries a constant offset: compare a link with itself, for
+ * instance getLatencyAverage(i) - getLatencyMin(i) is how much slower
+ * it got, which is what findSlowestLink() ranks.
+ * <p/>
+ * The table is made of flat arrays indexed by link, from 0 to
+ * LINK_STATISTICS_LINKS-1 (empty links have no reports), and is
+ * updated in constant time. All the addresses are in host order.
+ */
+class LinkStatistics {
+public:
+    LinkStatistics();
+    /**
+     * Returns true if <i>frame</i> was a RouteInformation
+     */
+    bool process(XBeeApiFrame& frame);
+    void clear();
+    /**
+     * Returns the number of links
+     */
+    uint8_t getSize();
+    /**
+     * Returns the link from responder to receiver, or -1
+     */
+    int8_t findLink(const uint32_t& responderAddress64Msb, const uint32_t& responderAddress64Lsb,
+        const uint32_t& receiverAddress64Msb, const uint32_t& receiverAddress64Lsb);
+    /**
+     * Returns the link whose average latency is the furthest above
+     * its minimum, or -1 if no link has two latency samples
+     */
+    int8_t findSlowestLink();
+
+    uint32_t getResponderAddress64Msb(const uint8_t& link);
+    uint32_t getResponderAddress64Lsb(const uint8_t& link);
+    uint32_t getReceiverAddress64Msb(const uint8_t& link);
+    uint32_t getReceiverAddress64Lsb(const uint8_t& link);
+    /**
+     * getAckTimeouts(i) / getReports(i) is the MAC ACK timeout rate
+     * of the link
+     */
+    uint16_t getReports(const uint8_t& link);
+    uint16_t getAckTimeouts(const uint8_t& link);
+    uint16_t getLatencySamples(const uint8_t& link);
+    uint32_t getLatencyMin(const uint8_t& link);
+    uint32_t getLatencyMax(const uint8_t& link);
+    /**
+     * Returns the moving average (1/8 weight) of the latency
+     */
+    uint32_t getLatencyAverage(const uint8_t& link);
+
+    /**
+     * Returns true, with the hops of the last complete trace and the
+     * churn, if the route from source to destination is known
+     */
+    bool getRoute(const uint32_t& sourceAddress64Msb, const uint32_t& sourceAddress64Lsb,
+        const uint32_t& destinationAddress64Msb, const uint32_t& destinationAddress64Lsb,
+        uint8_t& hops, uint16_t& churn);
+private:
+    uint8_t getHomeSlot(const uint32_t& fromMsb, const uint32_t& fromLsb,
+        const uint32_t& toMsb, const uint32_t& toLsb, const uint8_t& size);
+    int8_t findRoute(const uint32_t& sourceAddress64Msb, const uint32_t& sourceAddress64Lsb,
+        const uint32_t& destinationAddress64Msb, const uint32_t& destinationAddress64Lsb);
+
+    uint32_t _responderAddress64Msb[LINK_STATISTICS_LINKS];
+    uint32_t _responderAddress64Lsb[LINK_STATISTICS_LINKS];
+    uint32_t _receiverAddress64Msb[LINK_STATISTICS_LINKS];
+    uint32_t _receiverAddress64Lsb[LINK_STATISTICS_LINKS];
+    // 0 marks an empty link
+    uint16_t _reports[LINK_STATISTICS_LINKS];
+    uint16_t _ackTimeouts[LINK_STATISTICS_LINKS];
+    uint16_t _latencySamples[LINK_STATISTICS_LINKS];
+    uint32_t _latencyMin[LINK_STATISTICS_LINKS];
+    uint32_t _latencyMax[LINK_STATISTICS_LINKS];
+    uint32_t _latencyAverage[LINK_STATISTICS_LINKS];
+    uint8_t _size;
+
+    uint32_t _sourceAddress64Msb[LINK_STATISTICS_ROUTES];
+    uint32_t _sourceAddress64Lsb[LINK_STATISTICS_ROUTES];
+    uint32_t _destinationAddress64Msb[LINK_STATISTICS_ROUTES];
+    uint32_t _destinationAddress64Lsb[LINK_STATISTICS_ROUTES];
+    // trace in progress: timestamp and link of the last hop, hops so
+    // far (0 when no trace is in progress) and hash of the hops
+    uint32_t _lastTimestamp[LINK_STATISTICS_ROUTES];
+    uint8_t _lastLink[LINK_STATISTICS_ROUTES];
+    uint8_t _hops[LINK_STATISTICS_ROUTES];
+    uint32_t _signature[LINK_STATISTICS_ROUTES];
+    // last complete trace, 0 hops marks an empty route
+    uint8_t _traceHops[LINK_STATISTICS_ROUTES];
+    uint32_t _traceSignature[LINK_STATISTICS_ROUTES];
+    uint16_t _churn[LINK_STATISTICS_ROUTES];
+    bool _routeUsed[LINK_STATISTICS_ROUTES];
+};
+
+/*
+ * Buckets of a LatencyHistogram: 16 exact ones below 16, then 8 per
+ * power of two up to 2^32, so a percentile is within 12.5% of the
+ * true value. It takes 4 bytes of memory per bucket.
+ */
+#define LATENCY_HISTOGRAM_BUCKETS 240
+
+/**
+ * Histogram of latencies (in any unit, microseconds for instance)
+ * with log-linear buckets: recording is constant time, and the
+ * percentiles are read from the buckets.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    void record(const uint32_t& latency);
+    void clear();
+    uint32_t getCount();
+    uint32_t getMin();
+    uint32_t getMax();
+    /**
+     * Returns the latency below which <i>perMille</i> thousandths of
+     * the records fall (500 for the median, 999 for the 99.9th
+     * percentile): the upper bound of its bucket, at most getMax()
+     */
+    uint32_t getPercentile(const uint16_t& perMille);
+private:
+    static uint8_t getBucket(const uint32_t& latency);
+    static uint32_t getBucketLimit(const uint8_t& bucket);
+
+    uint32_t _counts[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t _count;
+    uint32_t _min;
+    uint32_t _max;
+};
+
+/*
+ * XBeeGroup settings: radios in a group, requests queued per radio,
+ * requests per radio waiting for their status (a radio takes no more
+ * from the queues until one of their statuses arrives), and
+ * milliseconds without status before a request is given up.
+ * Every queued request takes MAX_CMD_DATA_SIZE+3 bytes of memory.
+ */
+#define XBEE_GROUP_MAX_RADIOS 4
+#define XBEE_GROUP_QUEUE_SIZE 4
+#define XBEE_GROUP_MAX_IN_FLIGHT 2
+#define XBEE_GROUP_TX_TIMEOUT 3000
+
+/**
+ * Drives several radios (each an XBee on its own serial port) as one.
+ * <p/>
+ * send(...) queues a request on the radio that best reaches its
+ * destination (see XBee::getReachability(...)) with the fewest
+ * requests queued or in flight; poll() hands the queued requests to
+ * the radios, and a radio whose queue is empty steals from the tail
+ * of the longest queue of the others, so no radio idles while
+ * another one is backlogged.
+ * A request a radio refuses (its destination held down as unreachable,
+ * see XBee::setUnreachableCache(...)) moves to another radio that may
+ * reach it, or is dropped and counted by getRefused(...).
+ * readPacket() merges the frames of the radios into one stream, in
+ * the order they were read, whatever radio they come from: getApiFrame() and getRadio() tell the frame
+ * and the radio it came from. A radio has room for its next request
+ * when the status of one it sent comes back (same frame id).
+ * <p/>
+ * The radios are not copied, they must outlive the group.
+ */
+class XBeeGroup {
+public:
+    XBeeGroup();
+    /**
+     * Adds a radio, returns its index or -1 if the group is full
+     */
+    int8_t add(XBee& radio);
+    uint8_t getSize();
+    XBee& getRadio(const uint8_t& radio);
+    /**
+     * Queues <i>request</i> (it is copied) on the best radio.
+     * Returns false if no radio can reach its destination, every
+     * queue is full, or the request is longer than MAX_CMD_DATA_SIZE.
+     */
+    bool send(XBeeApiFrame& request);
+    /**
+     * Queues <i>request</i> on <i>radio</i>, it is never stolen by
+     * another radio (for instance for local AT commands)
+     */
+    bool send(const uint8_t& radio, XBeeApiFrame& request);
+    /**
+     * Sends the queued requests the radios have room for
+     */
+    void poll();
+    /**
+     * Reads every radio without a frame waiting, then hands out the
+     * frame that arrived first; returns its radio, or -1 if none has
+     * a frame
+     */
+    int8_t readPacket();
+    /**
+     * Returns the frame of the last readPacket()
+     */
+    XBeeApiFrame& getApiFrame();
+    /**
+     * Returns the radio of the last readPacket()
+     */
+    uint8_t getRadio();
+
+    uint8_t getQueueDepth(const uint8_t& radio);
+    uint8_t getInFlight(const uint8_t& radio);
+    uint32_t getSent(const uint8_t& radio);
+    /**
+     * Returns the requests queued on <i>radio</i> that it refused and
+     * no other radio could take, they are dropped
+     */
+    uint32_t getRefused(const uint8_t& radio);
+    /**
+     * Returns the requests sent by another radio than the one they
+     * were queued on
+     */
+    uint32_t getStolen();
+private:
+    struct TxEntry {
+        uint8_t cmdId;
+        uint8_t cmdDataLength;
+        bool pinned;
+        uint8_t cmdData[MAX_CMD_DATA_SIZE];
+    };
+
+    int8_t pickRadio(const uint8_t& cmdId, const uint8_t* cmdData, const int8_t& except);
+    bool enqueue(const uint8_t& radio, XBeeApiFrame& request, const bool& pinned);
+    bool steal(const uint8_t& radio);
+    bool sendEntry(const uint8_t& radio, TxEntry& entry);
+    void refuse(const uint8_t& radio, TxEntry& entry);
+    void receiveStatus(const uint8_t& radio, XBeeApiFrame& frame);
+    uint8_t getReachability(const uint8_t& radio, const uint8_t& cmdId, const uint8_t* cmdData);
+
+    XBee* _radios[XBEE_GROUP_MAX_RADIOS];
+    uint8_t _size;
+
+    // ring of requests per radio
+    TxEntry _queue[XBEE_GROUP_MAX_RADIOS][XBEE_GROUP_QUEUE_SIZE];
+    uint8_t _queueHead[XBEE_GROUP_MAX_RADIOS];
+    uint8_t _queueDepth[XBEE_GROUP_MAX_RADIOS];
+
+    // frame id (0 for a free slot), status cmdId and millis() of the
+    // send of the requests waiting for their status, per radio
+    uint8_t _inFlightFrameIds[XBEE_GROUP_MAX_RADIOS][XBEE_GROUP_MAX_IN_FLIGHT];
+    uint8_t _inFlightStatusIds[XBEE_GROUP_MAX_RADIOS][XBEE_GROUP_MAX_IN_FLIGHT];
+    uint32_t _inFlightSince[XBEE_GROUP_MAX_RADIOS][XBEE_GROUP_MAX_IN_FLIGHT];
+    uint8_t _inFlight[XBEE_GROUP_MAX_RADIOS];
+
+    uint32_t _sent[XBEE_GROUP_MAX_RADIOS];
+    uint32_t _refused[XBEE_GROUP_MAX_RADIOS];
+    uint32_t _stolen;
+
+    // the frame read from each radio and not handed out yet, and the
+    // value of _readCount when it was read
+    bool _received[XBEE_GROUP_MAX_RADIOS];
+    uint32_t _receivedAt[XBEE_GROUP_MAX_RADIOS];
+    uint32_t _readCount;
+    uint8_t _lastRead;
+};
+
+#ifdef XBEENG_POSIX
+#include <stddef.h>
+
+/*
+ * SampleExport files are made of fixed-size segments: a page with
+ * the segment header, then the columns of SAMPLE_EXPORT_SEGMENT_ROWS
+ * rows. With a multiple of SAMPLE_EXPORT_PAGE_SIZE rows every column
+ * starts on a page. A segment takes 4096 + 4096*(14 + 2*channels)
+ * bytes, 124 KiB with 8 channels.
+ */
+#define SAMPLE_EXPORT_SEGMENT_ROWS 4096
+#define SAMPLE_EXPORT_PAGE_SIZE 4096
+#define SAMPLE_EXPORT_MAX_CHANNELS 16
+#define SAMPLE_EXPORT_MAGIC "XBNGCOL1"
+
+/**
+ * Header of a SampleExport segment, in host byte order. It is the
+ * index of the segment: the timestamps of its rows are between
+ * minTimestamp and maxTimestamp.
+ */
+struct SampleExportHeader {
+    char magic[8];
+    // rows written, updated after the row
+    uint32_t rows;
+    uint32_t capacity;
+    uint32_t channels;
+    uint32_t reserved;
+    uint64_t minTimestamp;
+    uint64_t maxTimestamp;
+};
+
+/**
+ * Returns the node index of a source address, for
+ * SampleExportWriter::append(IoSampleColumns&, ...); Rx16DataSample
+ * rows come as address64 0:address16
+ */
+typedef uint32_t (*SampleExportNodeIndex)(const uint32_t& address64Msb,
+    const uint32_t& address64Lsb, void* context);
+
+/**
+ * Appends samples to a columnar file (POSIX hosts only), through one
+ * memory-mapped segment at a time. Each segment has a column per
+ * field: timestamps (uint64_t), node indexes (uint32_t), channel
+ * masks (uint16_t) and one uint16_t column per channel, 0 where the
+ * channel was not sampled.
+ * <p/>
+ * The timestamps and node indexes are up to the caller, for instance
+ * milliseconds since the epoch and the index of the address in a
+ * table of its own. The file is in host byte order.
+ */
+class SampleExportWriter {
+public:
+    SampleExportWriter();
+    ~SampleExportWriter();
+    /**
+     * Opens or creates <i>path</i> and maps its last segment;
+     * returns false if the file cannot be mapped, or was written
+     * with another number of channels
+     */
+    bool open(const char* path, const uint8_t& channels);
+    /**
+     * Appends one row: <i>values</i> is indexed by channel, and only
+     * the channels of <i>mask</i> are read. Returns false if the
+     * next segment cannot be mapped.
+     */
+    bool append(const uint64_t& timestamp, const uint32_t& node,
+        const uint16_t& mask, const uint16_t* values);
+    /**
+     * Appends every row of <i>samples</i> with its analog channels,
+     * under the node index <i>nodeIndex</i> gives to the source
+     * address of the row (called again only when the address
+     * changes); returns the number of rows appended
+     */
+    uint16_t append(IoSampleColumns& samples, const uint64_t& timestamp,
+        SampleExportNodeIndex nodeIndex, void* context);
+    /**
+     * Flushes the mapped segment to the file
+     */
+    bool sync();
+    void close();
+    bool isOpen();
+    uint32_t getSegments();
+private:
+    bool mapSegment(const uint32_t& segment);
+    void unmapSegment();
+
+    int _fd;
+    uint8_t _channels;
+    size_t _segmentSize;
+    uint32_t _segment;
+    uint8_t* _base;
+    SampleExportHeader* _header;
+    uint64_t* _timestamps;
+    uint32_t* _nodes;
+    uint16_t* _masks;
+    uint16_t* _values;
+};
+
+/**
+ * Maps a file written by SampleExportWriter read-only, and returns
+ * its columns segment by segment, for scans without copies.
+ * Range queries skip the segments out of range with findSegment(...).
+ */
+class SampleExportReader {
+public:
+    SampleExportReader();
+    ~SampleExportReader();
+    bool open(const char* path);
+    void close();
+    uint32_t getSegments();
+    uint8_t getChannels();
+    /**
+     * Returns the header of a segment, nullptr if out of range
+     */
+    const SampleExportHeader* getHeader(const uint32_t& segment);
+    uint32_t getRows(const uint32_t& segment);
+    /**
+     * Returns the first segment from <i>segment</i> on with rows
+     * between <i>from</i> and <i>to</i> (inclusive), or -1
+     */
+    int32_t findSegment(const uint32_t& segment, const uint64_t& from, const uint64_t& to);
+
+    const uint64_t* getTimestamps(const uint32_t& segment);
+    const uint32_t* getNodes(const uint32_t& segment);
+    const uint16_t* getMasks(const uint32_t& segment);
+    const uint16_t* getChannel(const uint32_t& segment, const uint8_t& channel);
+private:
+    const uint8_t* getColumn(const uint32_t& segment, const size_t& offset);
+
+    const uint8_t* _base;
+    size_t _size;
+    size_t _segmentSize;
+    uint32_t _segments;
+    uint32_t _capacity;
+    uint8_t _channels;
+};
+
+/*
+ * Bytes a SerialPort reads from its tty at once. It should hold
+ * what arrives between two readPacket() calls; what does not fit
+ * waits in the kernel.
+ */
+#define SERIAL_PORT_BUFFER_SIZE 4096
+
+/**
+ * Serial port of a POSIX host (termios), to run XBee on a Linux
+ * gateway with xbee.begin(port), or as XBeeOn<SerialPort>.
+ * <p/>
+ * The tty is opened non-blocking in raw mode, 8N1, with optional
+ * RTS/CTS flow control. available() drains what the kernel holds
+ * into an internal buffer with one read(2) when the buffer is
+ * empty, and read() takes the bytes from the buffer; a frame is
+ * written with one write(2).
+ */
+class SerialPort final : public WaitableStream {
+public:
+    SerialPort();
+    ~SerialPort();
+    /**
+     * Opens the tty <i>path</i> (for instance /dev/ttyUSB0) at
+     * <i>baud</i> bits per second; returns false if it cannot be
+     * opened or the baud rate is not supported
+     */
+    bool open(const char* path, const uint32_t& baud);
+    bool open(const char* path, const uint32_t& baud, const bool& rtsCts);
+    void close();
+    bool isOpen();
+    /**
+     * Returns the file descriptor of the tty, -1 if closed
+     */
+    int getFd();
+
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buffer, size_t size);
+    /**
+     * Waits until everything written is transmitted
+     */
+    void flush();
+    /**
+     * Blocks in poll(2) until the tty is readable or <i>deadline</i>
+     * has passed; false also if the tty is closed or hung up
+     */
+    bool waitAvailable(const uint64_t& deadline);
+    /**
+     * Low-latency mode for USB-serial adapters (Linux): sets
+     * ASYNC_LOW_LATENCY on the open tty, which the FTDI and CP210x
+     * drivers take as a 1 ms latency timer instead of 16 ms, and the
+     * tty layer as a hint to push the bytes at once. Returns false
+     * if the driver does not support it.
+     * VMIN and VTIME stay 0: the tty is non-blocking, so poll(2)
+     * already wakes up on the first byte.
+     */
+    bool setLowLatency(const bool& lowLatency);
+    /**
+     * Makes waitAvailable(...) spin on read(2) for up to <i>spin</i>
+     * nanoseconds before blocking in poll(2), trading a core for the
+     * wake-up latency; 0 (the default) blocks at once
+     */
+    void setBusyPoll(const uint64_t& spin);
+private:
+    uint8_t _buffer[SERIAL_PORT_BUFFER_SIZE];
+    uint16_t _head;
+    uint16_t _tail;
+    int _fd;
+    uint64_t _busyPoll;
+};
+
+#ifdef XBEENG_LINUX
+/*
+ * XBeeEventLoop settings: radios and timers of a loop, and frames a
+ * radio dispatches per wake-up before the others get their turn.
+ */
+#define EVENT_LOOP_MAX_RADIOS 16
+#define EVENT_LOOP_MAX_TIMERS 16
+#define EVENT_LOOP_FRAMES_PER_WAKE 8
+
+/**
+ * Called by XBeeEventLoop for every frame read by <i>xbee</i>; the
+ * frame is overwritten by the next one.
+ */
+typedef void (*EventLoopFrameCallback)(XBee& xbee, XBeeApiFrame& frame, void* context);
+/**
+ * Called by XBeeEventLoop when a timer expires
+ */
+typedef void (*EventLoopTimerCallback)(void* context);
+
+/**
+ * Drives many radios and timers from one thread, with one epoll(7)
+ * instance (Linux).
+ * <p/>
+ * Each radio is an XBee reading a file descriptor, such as that of
+ * its SerialPort. When the descriptor is readable the loop parses
+ * the bytes with readPacket() and hands every frame to the callback
+ * of the radio, at most EVENT_LOOP_FRAMES_PER_WAKE frames before
+ * going on with the other radios.
+ * <p/>
+ * The timers share one timerfd armed at the earliest deadline, so
+ * the retries and timeouts of the library (OtaUpdater::poll(),
+ * XBeeGroup::poll(), ...) run on time without any polling: call
+ * them from periodic timers.
+ */
+class XBeeEventLoop {
+public:
+    XBeeEventLoop();
+    ~XBeeEventLoop();
+    /**
+     * Returns false if epoll or the timerfd cannot be created
+     */
+    bool isOpen();
+    /**
+     * Adds a radio reading <i>fd</i> (for instance SerialPort::getFd());
+     * returns false if the loop is full or the fd cannot be watched.
+     * The XBee is not copied, it must outlive the loop or be removed.
+     */
+    bool addRadio(XBee& xbee, const int& fd, EventLoopFrameCallback callback, void* context);
+    void removeRadio(XBee& xbee);
+    /**
+     * Calls <i>callback</i> after <i>delay</i> nanoseconds, then
+     * every <i>period</i> nanoseconds (0 for once). Returns the timer,
+     * or -1 if every timer is taken.
+     */
+    int8_t addTimer(const uint64_t& delay, const uint64_t& period,
+        EventLoopTimerCallback callback, void* context);
+    void cancelTimer(const int8_t& timer);
+    /**
+     * Waits for the radios and timers until one is ready or until
+     * <i>deadline</i> (see getMonotonicTime(), UINT64_MAX for none),
+     * and dispatches them; returns false if epoll fails
+     */
+    bool runOnce(const uint64_t& deadline);
+    /**
+     * Dispatches the radios and timers until stop() is called
+     */
+    void run();
+    void stop();
+
+    /**
+     * Returns the frames dispatched, and the frames read with errors
+     */
+    uint32_t getFrames();
+    uint32_t getErrors();
+private:
+    void readRadio(const uint8_t& radio);
+    void runTimers();
+    void armTimers();
+
+    int _epollFd;
+    int _timerFd;
+    bool _running;
+
+    XBee* _radios[EVENT_LOOP_MAX_RADIOS];
+    int _radioFds[EVENT_LOOP_MAX_RADIOS];
+    EventLoopFrameCallback _frameCallbacks[EVENT_LOOP_MAX_RADIOS];
+    void* _frameContexts[EVENT_LOOP_MAX_RADIOS];
+    // radios stopped at EVENT_LOOP_FRAMES_PER_WAKE: their bytes may
+    // wait in the buffer of their stream, where epoll cannot see them
+    bool _pending[EVENT_LOOP_MAX_RADIOS];
+    uint8_t _pendingCount;
+
+    // 0 deadline marks a free timer
+    uint64_t _deadlines[EVENT_LOOP_MAX_TIMERS];
+    uint64_t _periods[EVENT_LOOP_MAX_TIMERS];
+    EventLoopTimerCallback _timerCallbacks[EVENT_LOOP_MAX_TIMERS];
+    void* _timerContexts[EVENT_LOOP_MAX_TIMERS];
+    // deadline the timerfd is armed at, 0 if disarmed
+    uint64_t _armedAt;
+
+    uint32_t _frames;
+    uint32_t _errors;
+};
+
+/*
+ * XBeeReaderThread settings: frames queued between the reader thread
+ * and the application, a power of two (every frame takes
+ * MAX_CMD_DATA_SIZE+4 bytes of memory), and nanoseconds the reader
+ * thread takes at most to notice stop().
+ */
+#define READER_QUEUE_SIZE 64
+#define READER_STOP_WAIT 100000000
+
+/**
+ * Reads an XBee from a thread of its own (Linux): the thread drains
+ * the serial port as soon as bytes come, parses the frames and
+ * publishes them in a wait-free single-producer single-consumer
+ * ring, so the tty buffer cannot overflow while the application is
+ * busy. The application takes the frames with readPacket(...), from
+ * one thread, without locks.
+ * <p/>
+ * The XBee should read a WaitableStream (a SerialPort), otherwise
+ * the reader thread spins. While the thread runs the XBee must not
+ * be read by anyone else; it may still send, from any thread, or
+ * through an XBeeWriterThread.
+ * When the ring is full the new frames are dropped and counted.
+ * <p/>
+ * getFd() is an eventfd readable when frames are queued, to wait in
+ * poll(2) or epoll(7) along with other descriptors.
+ */
+class XBeeReaderThread {
+public:
+    XBeeReaderThread(XBee& xbee);
+    /**
+     * Stops the thread
+     */
+    ~XBeeReaderThread();
+    /**
+     * Starts the thread; returns false if it cannot be started
+     */
+    bool start();
+    /**
+     * Stops the thread and waits for it, the queued frames are kept
+     */
+    void stop();
+    bool isRunning();
+    /**
+     * Takes the next frame into getApiFrame(); returns false if none
+     * is queued
+     */
+    bool readPacket();
+    /**
+     * Waits a maximum of <i>timeout</i> milliseconds for a frame
+     */
+    bool readPacket(const uint32_t& timeout);
+    /**
+     * Waits for a frame until <i>deadline</i> (see getMonotonicTime(),
+     * UINT64_MAX for none)
+     */
+    bool readPacketBefore(const uint64_t& deadline);
+    /**
+     * Returns the frame taken by the last readPacket(...)
+     */
+    XBeeApiFrame& getApiFrame();
+    int getFd();
+    /**
+     * Returns the frames dropped because the ring was full
+     */
+    uint32_t getDropped();
+private:
+    struct QueuedFrame {
+        uint8_t cmdId;
+        uint8_t checksum;
+        uint16_t frameDataLength;
+        uint8_t cmdData[MAX_CMD_DATA_SIZE];
+    };
+
+    static void* runThread(void* reader);
+    void run();
+    void push(XBeeApiFrame& frame);
+
+    XBee* _xbee;
+    pthread_t _thread;
+    bool _running;
+    int _eventFd;
+
+    QueuedFrame _queue[READER_QUEUE_SIZE];
+    // written by the reader thread (_head) and the application (_tail)
+    uint32_t _head;
+    uint32_t _tail;
+    uint32_t _dropped;
+
+    XBeeApiFrame _response;
+    uint8_t _responseCmdData[MAX_CMD_DATA_SIZE];
+};
+
+/*
+ * XBeeWriterThread settings: frames queued for the writer thread, a
+ * power of two (every frame takes MAX_CMD_DATA_SIZE+16 bytes of
+ * memory), and bytes written to the serial port at once, at least
+ * WRITER_FRAME_BYTES (an escaped frame at its largest, behind the
+ * escaped CreateSourceRoute sent before it).
+ */
+#define WRITER_QUEUE_SIZE 64
+#define WRITER_BATCH_SIZE 1024
+#define WRITER_FRAME_BYTES (2*(MAX_CMD_DATA_SIZE+5)+1 + 2*(MAX_SOURCE_ROUTE_LENGTH+5)+1)
+
+/**
+ * Transmit queue of an XBee for many threads (Linux): the threads
+ * queue their frames with send(...) or trySend(...), a lock-free
+ * bounded multi-producer queue, and a writer thread of its own
+ * routes and encodes them (XBee::sendTo(...)) into batches written
+ * with one write to the serial port, so no thread waits on another
+ * one's bytes.
+ * <p/>
+ * When the queue is full send(...) waits for room and trySend(...)
+ * fails. getDepth() and getMaxDepth() tell how full the queue is,
+ * and getWaitTimes(...) how long the frames waited in it.
+ * <p/>
+ * <i>serial</i> must be the port the XBee writes to. Nothing else
+ * may send through the XBee while the thread runs; it may be read,
+ * for instance by an XBeeReaderThread.
+ */
+class XBeeWriterThread {
+public:
+    XBeeWriterThread(XBee& xbee, Stream& serial);
+    /**
+     * Stops the thread
+     */
+    ~XBeeWriterThread();
+    bool start();
+    /**
+     * Writes the queued frames, then stops the thread and waits for it
+     */
+    void stop();
+    bool isRunning();
+    /**
+     * Queues a copy of <i>request</i>, waiting while the queue is
+     * full; returns false if the writer cannot be waited for, or if
+     * <i>request</i> is empty or has more than MAX_CMD_DATA_SIZE bytes
+     * of command data (counted as rejected)
+     */
+    bool send(XBeeApiFrame& request);
+    /**
+     * Queues a copy of <i>request</i>; returns false if the queue is
+     * full, or if <i>request</i> is empty or has more than
+     * MAX_CMD_DATA_SIZE bytes of command data (both counted as
+     * rejected)
+     */
+    bool trySend(XBeeApiFrame& request);
+
+    /**
+     * Returns the frames queued and not written yet
+     */
+    uint32_t getDepth();
+    uint32_t getMaxDepth();
+    /**
+     * Returns the frames written, and those refused by send(...) or
+     * trySend(...) or by the XBee (unreachable destinations)
+     */
+    uint32_t getSent();
+    uint32_t getRejected();
+    /**
+     * Copies the microseconds the written frames waited in the queue
+     */
+    void getWaitTimes(LatencyHistogram& waitTimes);
+private:
+    struct QueuedFrame {
+        // turn of the slot (see push and pop)
+        uint32_t sequence;
+        uint8_t cmdId;
+        uint8_t checksum;
+        uint16_t frameDataLength;
+        uint64_t queuedAt;
+        uint8_t cmdData[MAX_CMD_DATA_SIZE];
+    };
+    // what the frames are encoded into
+    struct Batch {
+        uint8_t buffer[WRITER_BATCH_SIZE];
+        size_t length;
+        Stream* serial;
+        size_t write(const uint8_t* data, size_t size);
+        void flush() {}
+    };
+
+    bool fits(XBeeApiFrame& request);
+    bool push(XBeeApiFrame& request);
+    bool pop();
+    static void* runThread(void* writer);
+    void run();
+    void writeBatch();
+    void signal(const int& fd);
+
+    XBee* _xbee;
+    Stream* _serial;
+    pthread_t _thread;
+    bool _running;
+
+    QueuedFrame _queue[WRITER_QUEUE_SIZE];
+    uint32_t _pushAt;
+    uint32_t _popAt;
+
+    // the writer sleeps on _itemsFd, the blocked send(...) on _roomFd
+    int _itemsFd;
+    int _roomFd;
+    bool _writerAsleep;
+    uint32_t _blocked;
+
+    Batch _batch;
+
+    uint32_t _maxDepth;
+    uint32_t _sent;
+    uint32_t _rejected;
+    LatencyHistogram _waitTimes;
+    pthread_mutex_t _waitTimesMutex;
+};
+#endif
+#endif
+
+#ifdef XBEENG_COROUTINES
+#define EXCHANGE_DEFAULT_TIMEOUT 5000
+
+/**
+ * Coroutine for the conversations of XBeeExchanges: it runs as soon as
+ * it is called, up to its first co_await, and frees itself when it
+ * returns. Nothing owns or awaits it.
+ * <p/>
+ * XBeeTask readRssi(XBeeExchanges& exchanges) {
+ *     XBeeExchanges::Exchange db = exchanges.query("DB");
+ *     AtCommandResponse& response = static_cast<AtCommandResponse&>(co_await db);
+ *     ...
+ * }
+ */
+struct XBeeTask {
+    struct promise_type {
+        XBeeTask get_return_object() { return XBeeTask(); }
+        std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+        std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+        void return_void() {}
+        // the library has no exceptions
+        void unhandled_exception() { abort(); }
+    };
+};
+
+/**
+ * Request/response exchanges with one radio as C++20 awaitables:
+ * co_await on query(...) or transmit(...) sends the request and
+ * suspends the coroutine, without blocking, until the response with
+ * its frame id (AtCommandResponse, TxStatus, RemoteAtCommandResponse,
+ * ...) is handed to process(...), for instance from the callback of
+ * an XBeeEventLoop. The coroutine then resumes inside process(...)
+ * with the response.
+ * <p/>
+ * Every exchange in flight has its own frame id, taken from
+ * EXCHANGE_FIRST_FRAME_ID to 255, so at most EXCHANGE_FRAME_IDS are in
+ * flight at once; the others wait (in the order of their co_await) for
+ * a frame id and are sent when a response frees one. The frames the
+ * application sends itself on the same radio must use the frame ids
+ * below EXCHANGE_FIRST_FRAME_ID (or 0), otherwise their responses may
+ * be taken for those of an exchange. Exchanges live in the frames of
+ * their coroutines, the waiting list is linked through them: thousands
+ * of conversations cost no more than their coroutine frames.
+ * <p/>
+ * poll() ends the exchanges sent more than getTimeout() milliseconds
+ * ago: their frame is not ready and its error code is
+ * RESPONSE_TIMEOUT. A request the radio refuses (see XBee::send(...))
+ * or one longer than MAX_CMD_DATA_SIZE ends at once with
+ * REQUEST_NOT_SENT.
+ * <p/>
+ * The frames of the radio that are not responses to an exchange are
+ * left to the application: process(...) returns false for them.
+ * Compiled with C++20 only (XBEENG_COROUTINES); its code is in this
+ * header, so the library itself may be built with an older standard.
+ */
+class XBeeExchanges {
+public:
+    /**
+     * Awaitable of one exchange. co_await returns the response, which
+     * lives as long as the Exchange: name the Exchange to keep the
+     * response past the statement of the co_await.
+     */
+    class Exchange {
+    public:
+        Exchange(XBeeExchanges& exchanges, XBeeApiFrame& request);
+        Exchange(XBeeExchanges& exchanges, const char (&cmd)[3], const uint8_t* param, const uint16_t& paramLength);
+        Exchange(const Exchange&) = delete;
+        ~Exchange();
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> handle);
+        XBeeApiFrame& await_resume();
+    private:
+        friend class XBeeExchanges;
+        enum State : uint8_t { CREATED, WAITING, IN_FLIGHT, DONE };
+
+        XBeeExchanges* _exchanges;
+        std::coroutine_handle<> _handle;
+        // next in the list of the exchanges waiting for a frame id
+        Exchange* _next;
+        uint32_t _sentAt;
+        State _state;
+        uint8_t _frameId;
+        // the request before it is sent, the response after
+        XBeeApiFrame _frame;
+        uint8_t _cmdData[MAX_CMD_DATA_SIZE];
+    };
+
+    /**
+     * The radio is not copied, it must outlive the exchanges
+     */
+    XBeeExchanges(XBee& xbee);
+
+    /**
+     * Local AT command <i>cmd</i>, its response is an AtCommandResponse
+     */
+    Exchange query(const char (&cmd)[3]);
+    Exchange query(const char (&cmd)[3], const uint8_t* param, const uint16_t& paramLength);
+    /**
+     * Any request with a frame id (TxRequest, RemoteAtCommand, ...);
+     * it is copied and its frame id is replaced. The response is the
+     * status frame of the request (TxStatus, TxStatusResponse,
+     * RemoteAtCommandResponse, ...)
+     */
+    Exchange transmit(XBeeApiFrame& request);
+
+    /**
+     * Hands a frame of the radio to the exchanges; returns true if it
+     * was the response of one, which has been resumed
+     */
+    bool process(XBeeApiFrame& frame);
+    /**
+     * Ends the exchanges that timed out
+     */
+    void poll();
+
+    uint32_t getTimeout();
+    void setTimeout(const uint32_t& timeout);
+    uint8_t getInFlight();
+    uint16_t getWaiting();
+    uint32_t getCompleted();
+    uint32_t getTimedOut();
+private:
+    static uint8_t getResponseId(const uint8_t& requestId);
+
+    bool start(Exchange& exchange);
+    bool send(Exchange& exchange);
+    void sendWaiting();
+    void finish(Exchange& exchange, const uint8_t& errorCode);
+    void cancel(Exchange& exchange);
+
+    XBee* _xbee;
+    uint32_t _timeout;
+
+    // exchange of each frame id, from EXCHANGE_FIRST_FRAME_ID
+    Exchange* _inFlight[EXCHANGE_FRAME_IDS];
+    uint8_t _inFlightCount;
+    uint8_t _nextFrameId;
+
+    Exchange* _waitingHead;
+    Exchange* _waitingTail;
+    uint16_t _waitingCount;
+
+    uint32_t _completed;
+    uint32_t _timedOut;
+};
+
+inline
+XBeeExchanges::Exchange::Exchange(XBeeExchanges& exchanges, XBeeApiFrame& request):
+    _exchanges(&exchanges), _next(nullptr), _sentAt(0), _state(CREATED), _frameId(0) {
+    _frame.setCmdData(_cmdData);
+    _frame.setCmdId(request.getCmdId());
+    if (request.getCmdDataLength() > MAX_CMD_DATA_SIZE || !request.has<FrameIdDescriptionSchema::frameId>()) {
+        _frame.setCmdDataLength(0);
+        return;
+    }
+    _frame.setCmdDataLength(request.getCmdDataLength());
+    memcpy(_cmdData, request.getCmdData(), request.getCmdDataLength());
+}
+
+inline
+XBeeExchanges::Exchange::Exchange(XBeeExchanges& exchanges, const char (&cmd)[3],
+    const uint8_t* param, const uint16_t& paramLength):
+    _exchanges(&exchanges), _next(nullptr), _sentAt(0), _state(CREATED), _frameId(0) {
+    _frame.setCmdData(_cmdData);
+    _frame.setCmdId(AT_COMMAND);
+    if (AT_COMMAND_HEAD + paramLength > MAX_CMD_DATA_SIZE) {
+        _frame.setCmdDataLength(0);
+        return;
+    }
+    _frame.setCmdDataLength(AT_COMMAND_HEAD + paramLength);
+    _cmdData[AtCommandSchema::cmd::index] = cmd[0];
+    _cmdData[AtCommandSchema::cmd::index+1] = cmd[1];
+    if (paramLength > 0) memcpy(&(_cmdData[AtCommandSchema::param::index]), param, paramLength);
+}
+
+inline
+XBeeExchanges::Exchange::~Exchange() {
+    // a coroutine destroyed while it awaits
+    if (_state == WAITING || _state == IN_FLIGHT) _exchanges->cancel(*this);
+    // the buffer is not on the heap
+    _frame.setCmdData(nullptr);
+}
+
+inline bool
+XBeeExchanges::Exchange::await_ready() { return false; }
+
+inline bool
+XBeeExchanges::Exchange::await_suspend(std::coroutine_handle<> handle) {
+    _handle = handle;
+    return _exchanges->start(*this);
+}
+
+inline XBeeApiFrame&
+XBeeExchanges::Exchange::await_resume() { return _frame; }
+
+inline
+XBeeExchanges::XBeeExchanges(XBee& xbee):
+    _xbee(&xbee), _timeout(EXCHANGE_DEFAULT_TIMEOUT), _inFlightCount(0), _nextFrameId(EXCHANGE_FIRST_FRAME_ID),
+    _waitingHead(nullptr), _waitingTail(nullptr), _waitingCount(0),
+    _completed(0), _timedOut(0) {
+    for (uint16_t i = 0; i < EXCHANGE_FRAME_IDS; i++) _inFlight[i] = nullptr;
+}
+
+inline XBeeExchanges::Exchange
+XBeeExchanges::query(const char (&cmd)[3]) { return Exchange(*this, cmd, nullptr, 0); }
+inline XBeeExchanges::Exchange
+XBeeExchanges::query(const char (&cmd)[3], const uint8_t* param, const uint16_t& paramLength) {
+    return Exchange(*this, cmd, param, paramLength);
+}
+inline XBeeExchanges::Exchange
+XBeeExchanges::transmit(XBeeApiFrame& request) { return Exchange(*this, request); }
+
+inline uint32_t
+XBeeExchanges::getTimeout() { return _timeout; }
+inline void
+XBeeExchanges::setTimeout(const uint32_t& timeout) { _timeout = timeout; }
+inline uint8_t
+XBeeExchanges::getInFlight() { return _inFlightCount; }
+inline uint16_t
+XBeeExchanges::getWaiting() { return _waitingCount; }
+inline uint32_t
+XBeeExchanges::getCompleted() { return _completed; }
+inline uint32_t
+XBeeExchanges::getTimedOut() { return _timedOut; }
+
+inline uint8_t
+XBeeExchanges::getResponseId(const uint8_t& requestId) {
+    switch (requestId) {
+    case AT_COMMAND:
+    case AT_QUEUE_COMMAND:
+        return AT_COMMAND_RESPONSE;
+    case REMOTE_AT_COMMAND:
+        return REMOTE_AT_COMMAND_RESPONSE;
+    case TX_64_REQUEST:
+    case TX_16_REQUEST:
+        return TX_STATUS_RESPONSE;
+    case TX_REQUEST:
+    case EXPLICIT_TX_REQUEST:
+        return TX_STATUS;
+    case REGISTER_JOINING_DEVICE:
+        return REGISTER_JOINING_DEVICE_STATUS;
+    default:
+        // no response
+        return 0;
+    }
+}
+
+inline bool
+XBeeExchanges::start(Exchange& exchange) {
+    if (exchange._frame.getCmdDataLength() == 0 || getResponseId(exchange._frame.getCmdId()) == 0) {
+        exchange._state = Exchange::DONE;
+        exchange._frame.setReady(false);
+        exchange._frame.setErrorCode(REQUEST_NOT_SENT);
+        return false;
+    }
+
+    // first come, first sent
+    if (_inFlightCount == EXCHANGE_FRAME_IDS || _waitingHead != nullptr) {
+        exchange._state = Exchange::WAITING;
+        exchange._next = nullptr;
+        if (_waitingTail == nullptr) _waitingHead = &exchange;
+        else _waitingTail->_next = &exchange;
+        _waitingTail = &exchange;
+        _waitingCount++;
+        return true;
+    }
+    // not sent, go on at once
+    return send(exchange);
+}
+
+inline bool
+XBeeExchanges::send(Exchange& exchange) {
+    // the frame id least recently used, so a late response to an
+    // exchange that timed out does not end the next one
+    while (_inFlight[_nextFrameId - EXCHANGE_FIRST_FRAME_ID] != nullptr) {
+        _nextFrameId = _nextFrameId == 255 ? EXCHANGE_FIRST_FRAME_ID : _nextFrameId + 1;
+    }
+    uint8_t frameId = _nextFrameId;
+    _nextFrameId = _nextFrameId == 255 ? EXCHANGE_FIRST_FRAME_ID : _nextFrameId + 1;
+
+    exchange._frameId = frameId;
+    exchange._frame.set<FrameIdDescriptionSchema::frameId>(frameId);
+    exchange._frame.setChecksum();
+    if (!_xbee->send(exchange._frame)) {
+        exchange._state = Exchange::DONE;
+        exchange._frame.setReady(false);
+        exchange._frame.setErrorCode(REQUEST_NOT_SENT);
+        return false;
+    }
+    exchange._state = Exchange::IN_FLIGHT;
+    exchange._sentAt = millis();
+    _inFlight[frameId - EXCHANGE_FIRST_FRAME_ID] = &exchange;
+    _inFlightCount++;
+    return true;
+}
+
+inline void
+XBeeExchanges::sendWaiting() {
+    while (_waitingHead != nullptr && _inFlightCount < EXCHANGE_FRAME_IDS) {
+        Exchange& exchange = *_waitingHead;
+        _waitingHead = exchange._next;
+        if (_waitingHead == nullptr) _waitingTail = nullptr;
+        _waitingCount--;
+
+        // refused: resume it with the error
+        if (!send(exchange)) exchange._handle.resume();
+    }
+}
+
+inline bool
+XBeeExchanges::process(XBeeApiFrame& frame) {
+    if (!frame.isReady() || frame.hasErrors() || !frame.has<FrameIdDescriptionSchema::frameId>() ||
+        frame.getCmdDataLength() > MAX_CMD_DATA_SIZE) return false;
+
+    // the frames of the application have the frame ids below
+    uint8_t frameId = frame.get<FrameIdDescriptionSchema::frameId>();
+    if (frameId < EXCHANGE_FIRST_FRAME_ID) return false;
+    Exchange* exchange = _inFlight[frameId - EXCHANGE_FIRST_FRAME_ID];
+    if (exchange == nullptr || getResponseId(exchange->_frame.getCmdId()) != frame.getCmdId()) return false;
+
+    _inFlight[frameId - EXCHANGE_FIRST_FRAME_ID] = nullptr;
+    _inFlightCount--;
+    exchange->_state = Exchange::DONE;
+    exchange->_frame.setCmdId(frame.getCmdId());
+    exchange->_frame.setCmdDataLength(frame.getCmdDataLength());
+    memcpy(exchange->_cmdData, frame.getCmdData(), frame.getCmdDataLength());
+    exchange->_frame.setChecksum(frame.getChecksum());
+    exchange->_frame.setErrorCode(NO_ERROR);
+    exchange->_frame.setReady(true);
+    _completed++;
+
+    // the exchange may be gone once its coroutine resumed
+    exchange->_handle.resume();
+    sendWaiting();
+    return true;
+}
+
+inline void
+XBeeExchanges::finish(Exchange& exchange, const uint8_t& errorCode) {
+    _inFlight[exchange._frameId - EXCHANGE_FIRST_FRAME_ID] = nullptr;
+    _inFlightCount--;
+    exchange._state = Exchange::DONE;
+    exchange._frame.setReady(false);
+    exchange._frame.setErrorCode(errorCode);
+    exchange._handle.resume();
+}
+
+inline void
+XBeeExchanges::poll() {
+    uint32_t now = millis();
+    for (uint16_t i = 0; i < EXCHANGE_FRAME_IDS; i++) {
+        Exchange* exchange = _inFlight[i];
+        if (exchange == nullptr || now - exchange->_sentAt < _timeout) continue;
+        _timedOut++;
+        finish(*exchange, RESPONSE_TIMEOUT);
+    }
+    sendWaiting();
+}
+
+inline void
+XBeeExchanges::cancel(Exchange& exchange) {
+    if (exchange._state == Exchange::IN_FLIGHT) {
+        _inFlight[exchange._frameId - EXCHANGE_FIRST_FRAME_ID] = nullptr;
+        _inFlightCount--;
+    } else {
+        Exchange* previous = nullptr;
+        for (Exchange* e = _waitingHead; e != nullptr; previous = e, e = e->_next) {
+            if (e != &exchange) continue;
+            if (previous == nullptr) _waitingHead = e->_next;
+            else previous->_next = e->_next;
+            if (_waitingTail == e) _waitingTail = previous;
+            _waitingCount--;
+            break;
+        }
+    }
+    exchange._state = Exchange::DONE;
+}
+#endif
+
 #endif //XBeeNG_h
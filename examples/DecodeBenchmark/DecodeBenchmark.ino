@@ -0,0 +1,85 @@
+/**
+ * Measures the cost of decoding received frames: every field of an
+ * RxResponse (0x90), a TxStatus (0x8B) and a RouteInformation (0x8D)
+ * is read, as the receive loop of an application would, and the
+ * average time per frame is printed every few seconds.
+ * <p/>
+ * The frames are decoded from memory, the radio is not used.
+ */
+
+#include <XBeeNG.h>
+
+#define ITERATIONS 10000UL
+
+// cmdData of the frames (all bytes after the cmdID)
+uint8_t rxResponseData[] = {
+    0x00, 0x13, 0xA2, 0x00, 0x40, 0x3E, 0x0F, 0x30, 0x12, 0x34, 0x01, 'h', 'e', 'l', 'l', 'o' };
+uint8_t txStatusData[] = { 0x01, 0x12, 0x34, 0x00, 0x00, 0x00 };
+uint8_t routeInformationData[] = {
+    0x11, 0x2A, 0x00, 0x01, 0x02, 0x03, 0x00, 0x00, 0x00,
+    0x00, 0x13, 0xA2, 0x00, 0x40, 0x3E, 0x0F, 0x30,
+    0x00, 0x13, 0xA2, 0x00, 0x40, 0x3E, 0x0F, 0x31,
+    0x00, 0x13, 0xA2, 0x00, 0x40, 0x3E, 0x0F, 0x32,
+    0x00, 0x13, 0xA2, 0x00, 0x40, 0x3E, 0x0F, 0x33 };
+
+XBeeApiFrame frame;
+// keeps the reads from being optimized away
+volatile uint32_t sink;
+
+void setFrame(const uint8_t& cmdId, uint8_t* cmdData, const uint16_t& cmdDataLength) {
+    frame.setCmdId(cmdId);
+    frame.setCmdDataLength(cmdDataLength);
+    frame.setCmdData(cmdData);
+}
+
+uint32_t decodeRxResponse() {
+    RxResponse* pt = static_cast<RxResponse*>(&frame);
+    uint32_t sum = pt->getAddress64Msb() ^ pt->getAddress64Lsb() ^ pt->getAddress16();
+    sum += pt->getOptions();
+    uint8_t* data = pt->getData();
+    uint16_t dataLength = pt->getDataLength();
+    for (uint16_t i = 0; i < dataLength; i++) sum += data[i];
+    return sum;
+}
+
+uint32_t decodeTxStatus() {
+    TxStatus* pt = static_cast<TxStatus*>(&frame);
+    return pt->getFrameId() + pt->getAddress16() + pt->getRetryCount() +
+        pt->getDeliveryStatus() + pt->getDiscoveryStatus();
+}
+
+uint32_t decodeRouteInformation() {
+    RouteInformation* pt = static_cast<RouteInformation*>(&frame);
+    return pt->getSourceEvent() + pt->getLength() + pt->getTimestamp() +
+        pt->getAckTimoutCount() +
+        (pt->getDestinationAddress64Msb() ^ pt->getDestinationAddress64Lsb()) +
+        (pt->getSourceAddress64Msb() ^ pt->getSourceAddress64Lsb()) +
+        (pt->getResponderAddress64Msb() ^ pt->getResponderAddress64Lsb()) +
+        (pt->getReceiverAddress64Msb() ^ pt->getReceiverAddress64Lsb());
+}
+
+void setup() {
+    Serial.begin(9600);
+}
+
+void loop() {
+    uint32_t sum = 0;
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        setFrame(RX_RESPONSE, rxResponseData, sizeof(rxResponseData));
+        sum += decodeRxResponse();
+        setFrame(TX_STATUS, txStatusData, sizeof(txStatusData));
+        sum += decodeTxStatus();
+        setFrame(ROUTE_INFORMATION, routeInformationData, sizeof(routeInformationData));
+        sum += decodeRouteInformation();
+    }
+    uint32_t elapsed = micros() - start;
+    sink = sum;
+    // the buffers are not on the heap
+    frame.setCmdData(nullptr);
+
+    Serial.print(F("ns per frame: "));
+    Serial.println((uint32_t)((1000ULL*elapsed)/(3*ITERATIONS)));
+
+    delay(5000);
+}
@@ -0,0 +1,75 @@
+/**
+ * Runs many conversations with one radio from one thread: each one is
+ * a coroutine that queries the firmware version (VR) of the radio a
+ * few times with co_await, XBeeExchanges resuming it when the response
+ * comes in through the XBeeEventLoop. The counters are printed when
+ * the conversations are over.
+ * <p/>
+ * Build it with make (it needs a C++20 compiler), and run it as
+ * <pre>
+ * build/HostCoroutines 9600 /dev/ttyUSB0 1000
+ * </pre>
+ */
+
+#include <XBeeNG.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROUNDS 4
+
+SerialPort port;
+XBee xbee;
+XBeeEventLoop eventLoop;
+XBeeExchanges exchanges(xbee);
+
+uint32_t conversations;
+uint32_t finished;
+uint32_t failed;
+
+XBeeTask converse() {
+    for (uint8_t round = 0; round < ROUNDS; round++) {
+        XBeeExchanges::Exchange vr = exchanges.query("VR");
+        AtCommandResponse& response = static_cast<AtCommandResponse&>(co_await vr);
+        if (!response.isReady() || response.getStatus() != AT_OK) failed++;
+    }
+    if (++finished == conversations) eventLoop.stop();
+}
+
+void processFrame(XBee&, XBeeApiFrame& frame, void*) {
+    exchanges.process(frame);
+}
+
+void pollExchanges(void*) {
+    exchanges.poll();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s baud device conversations\n", argv[0]);
+        return 1;
+    }
+    uint32_t baud = strtoul(argv[1], nullptr, 10);
+    conversations = strtoul(argv[3], nullptr, 10);
+
+    if (!port.open(argv[2], baud)) {
+        fprintf(stderr, "cannot open %s at %u bauds\n", argv[2], (unsigned) baud);
+        return 1;
+    }
+    xbee.begin(port);
+    eventLoop.addRadio(xbee, port.getFd(), processFrame, nullptr);
+    eventLoop.addTimer(100000000, 100000000, pollExchanges, nullptr);
+
+    uint64_t startedAt = getMonotonicTime();
+    for (uint32_t i = 0; i < conversations; i++) converse();
+    if (conversations > 0) eventLoop.run();
+
+    Serial.print(F("Exchanges: "));
+    Serial.print((unsigned long) exchanges.getCompleted());
+    Serial.print(F(" Timed out: "));
+    Serial.print((unsigned long) exchanges.getTimedOut());
+    Serial.print(F(" Failed: "));
+    Serial.print((unsigned long) failed);
+    Serial.print(F(" Time (ms): "));
+    Serial.println((unsigned long) ((getMonotonicTime() - startedAt) / 1000000));
+}
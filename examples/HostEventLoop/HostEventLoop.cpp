@@ -0,0 +1,55 @@
+/**
+ * Serves several radios from one thread with an XBeeEventLoop: every
+ * frame received is printed with the radio it came from, and the
+ * frame counters are printed every second by a timer.
+ * <p/>
+ * Build it with make, and run it as
+ * <pre>
+ * build/HostEventLoop 9600 /dev/ttyUSB0 /dev/ttyUSB1 ...
+ * </pre>
+ */
+
+#include <XBeeNG.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+SerialPort ports[EVENT_LOOP_MAX_RADIOS];
+XBee radios[EVENT_LOOP_MAX_RADIOS];
+XBeeEventLoop eventLoop;
+
+void printFrame(XBee&, XBeeApiFrame& frame, void* context) {
+    Serial.print(F("Radio "));
+    Serial.print((const char*) context);
+    Serial.print(F(": "));
+    frame.printSummary(Serial);
+    Serial.println();
+}
+
+void printCounters(void*) {
+    Serial.print(F("Frames: "));
+    Serial.print((unsigned long) eventLoop.getFrames());
+    Serial.print(F(" Errors: "));
+    Serial.println((unsigned long) eventLoop.getErrors());
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s baud device...\n", argv[0]);
+        return 1;
+    }
+    uint32_t baud = strtoul(argv[1], nullptr, 10);
+
+    for (int i = 2; i < argc && i - 2 < EVENT_LOOP_MAX_RADIOS; i++) {
+        SerialPort& port = ports[i - 2];
+        if (!port.open(argv[i], baud)) {
+            fprintf(stderr, "cannot open %s at %u bauds\n", argv[i], (unsigned) baud);
+            return 1;
+        }
+        radios[i - 2].begin(port);
+        eventLoop.addRadio(radios[i - 2], port.getFd(), printFrame, argv[i]);
+    }
+    eventLoop.addTimer(1000000000, 1000000000, printCounters, nullptr);
+
+    eventLoop.run();
+}
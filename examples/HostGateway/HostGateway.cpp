@@ -0,0 +1,47 @@
+/**
+ * Runs XBee on a Linux (or macOS) host: the radio is on a serial
+ * port, and every frame received is printed on the standard output.
+ * It asks the radio for its node identifier (NI) first.
+ * <p/>
+ * Build it with make, and run it as
+ * <pre>
+ * build/HostGateway /dev/ttyUSB0 9600
+ * </pre>
+ * adding rtscts as third argument for RTS/CTS flow control.
+ */
+
+#include <XBeeNG.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SerialPort port;
+XBee xbee;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s device [baud] [rtscts]\n", argv[0]);
+        return 1;
+    }
+    uint32_t baud = argc > 2 ? strtoul(argv[2], nullptr, 10) : 9600;
+    bool rtsCts = argc > 3 && strcmp(argv[3], "rtscts") == 0;
+
+    if (!port.open(argv[1], baud, rtsCts)) {
+        fprintf(stderr, "cannot open %s at %u bauds\n", argv[1], (unsigned) baud);
+        return 1;
+    }
+    xbee.begin(port);
+
+    AtCommand ni(1, "NI");
+    xbee.send(ni);
+
+    for (;;) {
+        if (xbee.readPacket(1000)) {
+            xbee.getApiFrame().printSummary(Serial);
+        } else if (xbee.getApiFrame().hasErrors()) {
+            Serial.print(F("Error: "));
+            Serial.println(xbee.getApiFrame().getErrorCode());
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/**
+ * Measures the latency of the frames coming from a radio on a
+ * serial port, to compare the SerialPort settings on given hardware:
+ * it sends local AT queries (VR) one after the other, and records
+ * the time from each send to its AtCommandResponse. The way out is
+ * the same with every setting, so the differences come from the way
+ * in (adapter latency timer, tty layer, wake-up).
+ * <p/>
+ * Build it with make, and run it as
+ * <pre>
+ * build/LatencyProbe /dev/ttyUSB0 115200 [lowlatency] [busypoll=us] [count=n]
+ * </pre>
+ * It prints the percentiles in microseconds.
+ */
+
+#include <XBeeNG.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SerialPort port;
+XBee xbee;
+LatencyHistogram histogram;
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s device baud [lowlatency] [busypoll=us] [count=n]\n", argv[0]);
+        return 1;
+    }
+    uint32_t baud = strtoul(argv[2], nullptr, 10);
+    bool lowLatency = false;
+    uint64_t busyPoll = 0;
+    uint32_t count = 1000;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "lowlatency") == 0) lowLatency = true;
+        else if (strncmp(argv[i], "busypoll=", 9) == 0) busyPoll = strtoull(argv[i] + 9, nullptr, 10)*1000;
+        else if (strncmp(argv[i], "count=", 6) == 0) count = strtoul(argv[i] + 6, nullptr, 10);
+    }
+
+    if (!port.open(argv[1], baud)) {
+        fprintf(stderr, "cannot open %s at %u bauds\n", argv[1], (unsigned) baud);
+        return 1;
+    }
+    if (lowLatency && !port.setLowLatency(true)) {
+        fprintf(stderr, "%s does not support the low-latency mode\n", argv[1]);
+    }
+    port.setBusyPoll(busyPoll);
+    xbee.begin(port);
+
+    uint32_t lost = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t frameId = i % 255 + 1;
+        AtCommand query(frameId, "VR");
+
+        uint64_t sentAt = getMonotonicTime();
+        xbee.send(query);
+
+        // the answer to this query, others (late ones) are skipped
+        uint64_t deadline = sentAt + 1000000000;
+        bool answered = false;
+        while (!answered && xbee.readPacketBefore(deadline)) {
+            XBeeApiFrame& frame = xbee.getApiFrame();
+            answered = frame.getCmdId() == AT_COMMAND_RESPONSE &&
+                static_cast<AtCommandResponse&>(frame).getFrameId() == frameId;
+        }
+        if (answered) histogram.record((getMonotonicTime() - sentAt)/1000);
+        else lost++;
+    }
+
+    printf("%s lowlatency=%s busypoll=%uus\n", argv[1], lowLatency ? "on" : "off",
+        (unsigned)(busyPoll/1000));
+    printf("answers %u lost %u\n", (unsigned) histogram.getCount(), (unsigned) lost);
+    printf("min %u p50 %u p90 %u p99 %u p99.9 %u max %u us\n",
+        (unsigned) histogram.getMin(),
+        (unsigned) histogram.getPercentile(500), (unsigned) histogram.getPercentile(900),
+        (unsigned) histogram.getPercentile(990), (unsigned) histogram.getPercentile(999),
+        (unsigned) histogram.getMax());
+    return 0;
+}
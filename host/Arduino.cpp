@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2014 Luis Saavedra. All rights reserved.
+ *
+ * This file is part of XBeeNG.
+ *
+ * XBeeNG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBeeNG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBeeNG.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Arduino.h"
+
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Microseconds of the monotonic clock since the first call
+ */
+static uint64_t
+getElapsedMicros() {
+    static uint64_t origin = 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t us = (uint64_t) now.tv_sec*1000000 + now.tv_nsec/1000;
+    if (origin == 0) origin = us;
+    return us - origin;
+}
+
+unsigned long
+millis() { return (unsigned long)(uint32_t)(getElapsedMicros()/1000); }
+unsigned long
+micros() { return (unsigned long)(uint32_t) getElapsedMicros(); }
+
+void
+delay(unsigned long ms) {
+    struct timespec wait;
+    wait.tv_sec = ms/1000;
+    wait.tv_nsec = (long)(ms%1000)*1000000;
+    while (nanosleep(&wait, &wait) == -1 && errno == EINTR);
+}
+void
+delayMicroseconds(unsigned int us) {
+    struct timespec wait;
+    wait.tv_sec = us/1000000;
+    wait.tv_nsec = (long)(us%1000000)*1000;
+    while (nanosleep(&wait, &wait) == -1 && errno == EINTR);
+}
+
+size_t
+Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+size_t
+Print::write(const char* str) {
+    if (str == nullptr) return 0;
+    return write((const uint8_t*) str, strlen(str));
+}
+
+size_t
+Print::print(const __FlashStringHelper* str) { return write((const char*) str); }
+size_t
+Print::print(const char* str) { return write(str); }
+size_t
+Print::print(char c) { return write((uint8_t) c); }
+size_t
+Print::print(unsigned char n, int base) { return printNumber(n, base); }
+size_t
+Print::print(int n, int base) { return print((long) n, base); }
+size_t
+Print::print(unsigned int n, int base) { return printNumber(n, base); }
+size_t
+Print::print(long n, int base) {
+    if (base == DEC && n < 0) return print('-') + printNumber(-(unsigned long) n, base);
+    return printNumber(n, base);
+}
+size_t
+Print::print(unsigned long n, int base) { return printNumber(n, base); }
+
+size_t
+Print::println() { return write((const uint8_t*) "\r\n", 2); }
+size_t
+Print::println(const __FlashStringHelper* str) { return print(str) + println(); }
+size_t
+Print::println(const char* str) { return print(str) + println(); }
+size_t
+Print::println(char c) { return print(c) + println(); }
+size_t
+Print::println(unsigned char n, int base) { return print(n, base) + println(); }
+size_t
+Print::println(int n, int base) { return print(n, base) + println(); }
+size_t
+Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t
+Print::println(long n, int base) { return print(n, base) + println(); }
+size_t
+Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+
+size_t
+Print::printNumber(unsigned long n, int base) {
+    // digits from the end, base 2 at worst
+    char digits[8*sizeof(unsigned long) + 1];
+    char* p = &(digits[sizeof(digits) - 1]);
+    *p = '\0';
+
+    if (base < 2) base = DEC;
+    do {
+        uint8_t digit = n % base;
+        n /= base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    } while (n > 0);
+
+    return write(p);
+}
+
+HardwareSerial::HardwareSerial() { _peeked = -1; }
+
+void
+HardwareSerial::begin(unsigned long baud) { (void) baud; }
+void
+HardwareSerial::end() {}
+
+int
+HardwareSerial::available() {
+    if (_peeked >= 0) return 1;
+    int n = 0;
+    if (ioctl(STDIN_FILENO, FIONREAD, &n) == -1) return 0;
+    return n;
+}
+int
+HardwareSerial::read() {
+    if (_peeked >= 0) {
+        int c = _peeked;
+        _peeked = -1;
+        return c;
+    }
+    uint8_t c;
+    if (::read(STDIN_FILENO, &c, 1) != 1) return -1;
+    return c;
+}
+int
+HardwareSerial::peek() {
+    if (_peeked < 0) _peeked = read();
+    return _peeked;
+}
+size_t
+HardwareSerial::write(uint8_t b) { return write(&b, 1); }
+size_t
+HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (n < size) {
+        ssize_t written = ::write(STDOUT_FILENO, buffer + n, size - n);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        n += written;
+    }
+    return n;
+}
+
+HardwareSerial Serial;
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2014 Luis Saavedra. All rights reserved.
+ *
+ * This file is part of XBeeNG.
+ *
+ * XBeeNG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBeeNG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBeeNG.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The part of the Arduino core that XBeeNG uses, for host builds
+ * (Linux, macOS): Print, Stream, F(), millis() and friends, and a
+ * Serial on the standard input and output.
+ * XBeeNG.h includes it when ARDUINO is not defined.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// strings stay in memory, there is no flash to keep them in
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+#define PROGMEM
+
+/**
+ * Milliseconds and microseconds of the monotonic clock since the
+ * program started, wrapping around like on a board
+ */
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str);
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper* str);
+    size_t print(const char* str);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+
+    size_t println();
+    size_t println(const __FlashStringHelper* str);
+    size_t println(const char* str);
+    size_t println(char c);
+    size_t println(unsigned char n, int base = DEC);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+private:
+    size_t printNumber(unsigned long n, int base);
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+/**
+ * Serial of the host: reads the standard input, writes the standard
+ * output. The radios are on a SerialPort (see XBeeNG.h).
+ */
+class HardwareSerial : public Stream {
+public:
+    HardwareSerial();
+    void begin(unsigned long baud);
+    void end();
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buffer, size_t size);
+    using Print::write;
+    operator bool() { return true; }
+private:
+    int _peeked;
+};
+
+extern HardwareSerial Serial;
+
+#endif //Arduino_h
@@ -0,0 +1,34 @@
+/**
+ * Copyright (c) 2014 Luis Saavedra. All rights reserved.
+ *
+ * This file is part of XBeeNG.
+ *
+ * XBeeNG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBeeNG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBeeNG.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Entry point of the sketches built for the host: setup() once,
+ * then loop() forever, like on a board.
+ */
+
+#include "Arduino.h"
+
+void setup();
+void loop();
+
+int
+main() {
+    setup();
+    for (;;) loop();
+}